@@ -39,6 +39,14 @@ if(USE_LMDB)
   endif()
 endif()
 
+# ---[ liburing
+if(USE_IO_URING)
+  find_package(URing REQUIRED)
+  include_directories(SYSTEM ${URING_INCLUDE_DIR})
+  list(APPEND Caffe_LINKER_LIBS ${URING_LIBRARIES})
+  add_definitions(-DUSE_IO_URING)
+endif()
+
 # ---[ LevelDB
 if(USE_LEVELDB)
   find_package(LevelDB REQUIRED)
@@ -0,0 +1,15 @@
+# Try to find the liburing library and headers
+#  URING_FOUND - system has liburing
+#  URING_INCLUDE_DIR - the liburing include directory
+#  URING_LIBRARIES - Libraries needed to use liburing
+
+find_path(URING_INCLUDE_DIR NAMES liburing.h PATHS "$ENV{URING_DIR}/include")
+find_library(URING_LIBRARIES NAMES uring PATHS "$ENV{URING_DIR}/lib")
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(URing DEFAULT_MSG URING_INCLUDE_DIR URING_LIBRARIES)
+
+if(URING_FOUND)
+  message(STATUS "Found liburing (include: ${URING_INCLUDE_DIR}, library: ${URING_LIBRARIES})")
+  mark_as_advanced(URING_INCLUDE_DIR URING_LIBRARIES)
+endif()
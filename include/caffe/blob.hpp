@@ -8,6 +8,7 @@
 #include "caffe/common.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/syncedmem.hpp"
+#include "caffe/util/row_set.hpp"
 
 const int kMaxBlobAxes = 32;
 
@@ -265,10 +266,23 @@ class Blob {
 
   bool ShapeEquals(const BlobProto& other);
 
+  /**
+   * @brief Tracks the rows (slices along the first axis) in which the diff
+   *        may be nonzero -- useful for parameters like embedding tables, of
+   *        which a batch touches only a few rows.
+   *
+   * Code writing to the diff must then Add() every row it writes to
+   * diff_rows(), or MarkAll(). Update() on the CPU only touches those rows.
+   * ShareDiff() shares the row set along with the diff.
+   */
+  void set_sparse_diff(bool sparse);
+  inline RowSet* diff_rows() const { return diff_rows_.get(); }
+
  protected:
   shared_ptr<SyncedMemory> data_;
   shared_ptr<SyncedMemory> diff_;
   shared_ptr<SyncedMemory> shape_data_;
+  shared_ptr<RowSet> diff_rows_;
   vector<int> shape_;
   int count_;
   int capacity_;
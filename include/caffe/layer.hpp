@@ -316,6 +316,17 @@ class Layer {
     param_propagate_down_[param_id] = value;
   }
 
+  /**
+   * @brief Returns true if the param blob at param_id is fixed by the layer
+   *        itself, as a frozen embedding table is.
+   *
+   * A fixed param keeps its place among the layer's blobs, so that param
+   * specs and trained nets line up with those of the layer unfrozen, but
+   * the net never learns it nor copies trained weights into it, and saved
+   * nets record its shape only.
+   */
+  virtual inline bool FixedParam(const int param_id) const { return false; }
+
 
  protected:
   /** The protobuf that stores the layer parameters */
@@ -509,7 +520,14 @@ void Layer<Dtype>::ToProto(LayerParameter* param, bool write_diff) {
   param->CopyFrom(layer_param_);
   param->clear_blobs();
   for (int i = 0; i < blobs_.size(); ++i) {
-    blobs_[i]->ToProto(param->add_blobs(), write_diff);
+    if (FixedParam(i)) {
+      BlobShape* shape = param->add_blobs()->mutable_shape();
+      for (int j = 0; j < blobs_[i]->num_axes(); ++j) {
+        shape->add_dim(blobs_[i]->shape(j));
+      }
+    } else {
+      blobs_[i]->ToProto(param->add_blobs(), write_diff);
+    }
   }
 }
 
@@ -7,6 +7,7 @@
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/im2col.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -30,16 +31,23 @@ class BaseConvolutionLayer : public Layer<Dtype> {
 
  protected:
   // Helper functions that abstract away the column buffer and gemm arguments.
-  // The last argument in forward_cpu_gemm is so that we can skip the im2col if
-  // we just called weight_cpu_gemm with the same input.
+  // The skip_im2col argument in forward_cpu_gemm is so that we can skip the
+  // im2col if we just called weight_cpu_gemm with the same input. worker_id
+  // picks the column buffer, so that each of the workers_ can run an image.
   void forward_cpu_gemm(const Dtype* input, const Dtype* weights,
-      Dtype* output, bool skip_im2col = false);
+      Dtype* output, bool skip_im2col = false, int worker_id = 0);
   void forward_cpu_bias(Dtype* output, const Dtype* bias);
   void backward_cpu_gemm(const Dtype* input, const Dtype* weights,
-      Dtype* output);
+      Dtype* output, int worker_id = 0);
   void weight_cpu_gemm(const Dtype* input, const Dtype* output, Dtype*
-      weights);
+      weights, int worker_id = 0);
   void backward_cpu_bias(Dtype* bias, const Dtype* input);
+  // The batch_gemm versions of forward_cpu_gemm (with forward_cpu_bias when
+  // bias is not NULL) and weight_cpu_gemm, over all num_ images at once.
+  void forward_cpu_batch(const Dtype* input, const Dtype* weights,
+      const Dtype* bias, Dtype* output);
+  void weight_cpu_batch(const Dtype* input, const Dtype* output,
+      Dtype* weights);
 
 #ifndef CPU_ONLY
   void forward_gpu_gemm(const Dtype* col_input, const Dtype* weights,
@@ -91,22 +99,37 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   int num_output_;
   bool bias_term_;
   bool is_1x1_;
+  // Whether the kernel spans the whole (unpadded) input width with stride 1
+  // along the height, e.g. a text convolution over word embeddings. The CPU
+  // gemms then read the input in place, without im2col.
+  bool is_full_width_;
   bool force_nd_im2col_;
+  // Threads sharing the images of the CPU passes; NULL for a single one.
+  shared_ptr<ThreadPool> workers_;
+  // Images per chunk of the batch_gemm passes; 0 when they are off.
+  int batch_gemm_images_;
 
  private:
   // wrap im2col/col2im so we don't have to remember the (long) argument lists
   inline void conv_im2col_cpu(const Dtype* data, Dtype* col_buff) {
+    conv_im2col_cpu(data, col_buff, conv_out_spatial_dim_);
+  }
+  // Starts the rows of col_buff col_stride values apart.
+  inline void conv_im2col_cpu(const Dtype* data, Dtype* col_buff,
+      const int col_stride) {
     if (!force_nd_im2col_ && num_spatial_axes_ == 2) {
       im2col_cpu(data, conv_in_channels_,
           conv_input_shape_.cpu_data()[1], conv_input_shape_.cpu_data()[2],
           kernel_shape_.cpu_data()[0], kernel_shape_.cpu_data()[1],
           pad_.cpu_data()[0], pad_.cpu_data()[1],
           stride_.cpu_data()[0], stride_.cpu_data()[1],
-          dilation_.cpu_data()[0], dilation_.cpu_data()[1], col_buff);
+          dilation_.cpu_data()[0], dilation_.cpu_data()[1], col_buff,
+          col_stride);
     } else {
       im2col_nd_cpu(data, num_spatial_axes_, conv_input_shape_.cpu_data(),
           col_buffer_shape_.data(), kernel_shape_.cpu_data(),
-          pad_.cpu_data(), stride_.cpu_data(), dilation_.cpu_data(), col_buff);
+          pad_.cpu_data(), stride_.cpu_data(), dilation_.cpu_data(), col_buff,
+          col_stride);
     }
   }
   inline void conv_col2im_cpu(const Dtype* col_buff, Dtype* data) {
@@ -165,7 +188,34 @@ class BaseConvolutionLayer : public Layer<Dtype> {
   int col_offset_;
   int output_offset_;
 
+  // The gemms of the is_full_width_ case, one per input channel and kernel
+  // row: that row of the filters times the input rows it meets, which are
+  // a contiguous window of the input.
+  void full_width_forward(const Dtype* input, const Dtype* weights,
+      Dtype* output);
+  void full_width_backward(const Dtype* output, const Dtype* weights,
+      Dtype* input);
+  void full_width_weight(const Dtype* input, const Dtype* output,
+      Dtype* weights);
+
+  inline Blob<Dtype>* col_buffer(int worker_id) {
+    return worker_id == 0 ? &col_buffer_ :
+        worker_col_buffers_[worker_id - 1].get();
+  }
+
   Blob<Dtype> col_buffer_;
+  // Column buffers of workers 1, 2, ...; worker 0 uses col_buffer_.
+  vector<shared_ptr<Blob<Dtype> > > worker_col_buffers_;
+  // Fills the batch_col_buffer_ with the columns of images [first,
+  // first + num), the columns of image first + b starting at column
+  // b * conv_out_spatial_dim_. im2col writes them in place; 1x1 images,
+  // which are their own columns, are copied.
+  void batch_im2col_cpu(const Dtype* input, int first, int num);
+  // The columns and the outputs of a chunk of batch_gemm images, rows of
+  // batch_gemm_images_ * conv_out_spatial_dim_ values.
+  Blob<Dtype> batch_col_buffer_;
+  Blob<Dtype> batch_output_buffer_;
+  Blob<Dtype> batch_bias_multiplier_;
   Blob<Dtype> bias_multiplier_;
 };
 
@@ -10,6 +10,8 @@
 #include "caffe/proto/caffe.pb.h"
 #include "caffe/util/blocking_queue.hpp"
 
+namespace boost { class mutex; }
+
 namespace caffe {
 
 /**
@@ -49,8 +51,38 @@ template <typename Dtype>
 class Batch {
  public:
   Blob<Dtype> data_, label_;
+  // Per-item number of real tokens, for layers that emit it as top[2].
+  Blob<Dtype> length_;
+};
+
+/// @brief What a prefetching data layer did since its stats were reset.
+struct PrefetchStats {
+  // Forward calls, and how many of them found no batch ready.
+  int forwards;
+  int starved;
+  // Time Forward spent waiting for the prefetch thread.
+  double wait_ms;
+  // Mean number of batches ready when Forward was called.
+  float mean_ready;
+  // Percentiles of the load_batch latency over the last loads.
+  int loads;
+  float load_ms_p50, load_ms_p90, load_ms_p99;
+  // Number of batches prefetched ahead at most, the one the tops hold
+  // aside.
+  int depth;
 };
 
+/**
+ * @brief Provides base for data layers that assemble batches on a prefetch
+ *        thread.
+ *
+ * Forward hands the next prefetched batch to the top blobs without copying
+ * it: the tops share the memory of the batch, which is only returned to the
+ * prefetch thread at the following Forward. The queue therefore holds one
+ * batch more than the data_param.prefetch_batches assembled ahead. When
+ * data_param.max_prefetch is above prefetch_batches, every Forward that has
+ * to wait for a batch adds one, up to max_prefetch.
+ */
 template <typename Dtype>
 class BasePrefetchingDataLayer :
     public BaseDataLayer<Dtype>, public InternalThread {
@@ -67,16 +99,39 @@ class BasePrefetchingDataLayer :
   virtual void Forward_gpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
 
-  // Prefetches batches (asynchronously if to GPU memory)
-  static const int PREFETCH_COUNT = 3;
+  /// @brief Counters since the last ResetPrefetchStats(), for finding out
+  ///        whether training waits for data. May be read while another
+  ///        thread runs Forward.
+  PrefetchStats prefetch_stats() const;
+  void ResetPrefetchStats();
 
  protected:
   virtual void InternalThreadEntry();
   virtual void load_batch(Batch<Dtype>* batch) = 0;
 
-  Batch<Dtype> prefetch_[PREFETCH_COUNT];
+  // Shares the memory of the next full batch with the tops, and recycles
+  // the one they held.
+  void TakeNextBatch(const vector<Blob<Dtype>*>& top);
+  // Adds a batch shaped like prefetch_current_ to the free ones.
+  void AddBatch();
+
+  // Prefetches batches (asynchronously if to GPU memory)
+  vector<shared_ptr<Batch<Dtype> > > prefetch_;
   BlockingQueue<Batch<Dtype>*> prefetch_free_;
   BlockingQueue<Batch<Dtype>*> prefetch_full_;
+  // The batch whose memory the tops share, NULL before the first Forward.
+  Batch<Dtype>* prefetch_current_;
+  int max_prefetch_;
+
+  // Counters of prefetch_stats(), under stats_mutex_ as is the growth of
+  // prefetch_. The prefetch thread records the load latencies, in a ring of
+  // the last ones.
+  int forwards_, starved_, loads_;
+  double wait_ms_;
+  size_t ready_sum_;
+  vector<float> load_ms_;
+  int load_ms_next_;
+  shared_ptr<boost::mutex> stats_mutex_;
 
   Blob<Dtype> transformed_data_;
 };
@@ -60,6 +60,15 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
    *  - bias_term (\b optional, default true). Whether to have a bias.
    *  - engine: convolution has CAFFE (matrix multiplication) and CUDNN (library
    *    kernels + stream parallelism) engines.
+   *  - num_workers (\b optional, default 1). The number of threads the CPU
+   *  passes spread the images of a batch over. The weight gradient is summed
+   *  from per-thread partial gradients in a fixed order, so that it does not
+   *  depend on the thread timing.
+   *  - batch_gemm (\b optional, default false). Whether the forward pass and
+   *  the weight gradient run one gemm per group over a chunk of images at a
+   *  time, the chunk's buffers staying within batch_gemm_max_bytes. Pays off
+   *  for small output maps, where the gemm of a single image is too thin.
+   *  The gradient w.r.t. the bottom is still computed image by image.
    */
   explicit ConvolutionLayer(const LayerParameter& param)
       : BaseConvolutionLayer<Dtype>(param) {}
@@ -77,6 +86,23 @@ class ConvolutionLayer : public BaseConvolutionLayer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual inline bool reverse_dimensions() { return false; }
   virtual void compute_output_shape();
+
+  // The CPU passes over the images assigned to worker_id: images worker_id,
+  // worker_id + num_workers, ...; run on every worker.
+  void forward_images(const Dtype* bottom_data, const Dtype* weight,
+      const Dtype* bias, Dtype* top_data, int worker_id);
+  // A NULL weight_diff or bottom_diff skips that gradient.
+  void backward_images(const Dtype* top_diff, const Dtype* bottom_data,
+      const Dtype* weight, Dtype* weight_diff, Dtype* partial_diffs,
+      Dtype* bottom_diff, int worker_id);
+  // Adds the partial weight diffs of workers 1, 2, ... to weight_diff, in
+  // that order, over the slice of the weights assigned to worker_id.
+  void reduce_weight_diff(const Dtype* partial_diffs, Dtype* weight_diff,
+      int worker_id);
+
+  // Weight diffs of the images of workers 1, 2, ...; worker 0 accumulates
+  // into the weight diff itself.
+  Blob<Dtype> worker_weight_diff_;
 };
 
 }  // namespace caffe
@@ -6,6 +6,9 @@
 #include "caffe/blob.hpp"
 #include "caffe/layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/embedding_dict.hpp"
+#include "caffe/util/row_copy.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -14,13 +17,21 @@ namespace caffe {
  *        Equivalent to an InnerProductLayer with one-hot vectors as input, but
  *        for efficiency the input is the "hot" index of each column itself.
  *
+ * The table is initialized from dic_source. It is the first blob and the
+ * bias, if any, the second, frozen or not, so that param specs and trained
+ * nets apply alike. A frozen table is a fixed param (Layer::FixedParam):
+ * it is not learned, trained nets do not overwrite it and saved nets record
+ * its shape only; every frozen layer of the process reads the same copy of
+ * it. A frozen quantized dict (fp16 or int8) stays quantized in memory and
+ * only the looked-up rows are dequantized; the blob then holds no data.
+ *
  * TODO(dox): thorough documentation for Forward, Backward, and proto params.
  */
 template <typename Dtype>
 class DictEmbedLayer : public Layer<Dtype> {
  public:
   explicit DictEmbedLayer(const LayerParameter& param)
-      : Layer<Dtype>(param) {}
+      : Layer<Dtype>(param), frozen_(param.dict_embed_param().frozen()) {}
   virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top);
   virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
@@ -29,6 +40,9 @@ class DictEmbedLayer : public Layer<Dtype> {
   virtual inline const char* type() const { return "DictEmbed"; }
   virtual inline int ExactNumBottomBlobs() const { return 1; }
   virtual inline int ExactNumTopBlobs() const { return 1; }
+  virtual inline bool FixedParam(const int param_id) const {
+    return frozen_ && param_id == 0;
+  }
 
  protected:
   virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
@@ -39,12 +53,23 @@ class DictEmbedLayer : public Layer<Dtype> {
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
   virtual void Backward_gpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
+  // Gathers the rows of the lookups assigned to worker_id from weight, or
+  // from the quantized dict_ when it is NULL, adding bias when it is not
+  // NULL; run on every worker.
+  void gather_rows(const Dtype* bottom_data, const Dtype* weight,
+      const Dtype* bias, Dtype* top_data, int worker_id);
 
   int M_;
   int K_;
   int N_;
   bool bias_term_;
   Blob<Dtype> bias_multiplier_;
+  // Copy-on-write mapping of a binary dic_source backing blobs_[0], or the
+  // shared table backing it when frozen.
+  shared_ptr<EmbeddingDict> dict_;
+  const bool frozen_;
+  RowCopier<Dtype> copy_row_;
+  shared_ptr<ThreadPool> workers_;
 };
 
 }  // namespace caffe
@@ -12,12 +12,21 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/sample_permutation.hpp"
+#include "caffe/util/text_corpus.hpp"
+#include "caffe/util/text_stream.hpp"
+#include "caffe/util/thread_pool.hpp"
+#include "caffe/util/vocab_remap.hpp"
 
 namespace caffe {
 
 /**
  * @brief Provides data to the Net from text files.
  *
+ * top[0] holds the token indices of each sample, top[1] its label and the
+ * optional top[2] the number of real tokens in each row of top[0]. With
+ * bucket_boundaries set, the height of top[0] changes from batch to batch.
+ *
  * TODO(dox): thorough documentation for Forward and proto params.
  */
 template <typename Dtype>
@@ -35,21 +44,47 @@ class DictIndexDataLayer : public BasePrefetchingDataLayer<Dtype> {
 
   virtual inline const char* type() const { return "DictIndexData"; }
   virtual inline int ExactNumBottomBlobs() const { return 0; }
-  virtual inline int ExactNumTopBlobs() const { return 2; }
+  virtual inline int MinTopBlobs() const { return 2; }
+  virtual inline int MaxTopBlobs() const { return 3; }
  protected:
-  shared_ptr<Caffe::RNG> prefetch_rng_;
-  virtual void ShuffleText();
   virtual void load_batch(Batch<Dtype>* batch);
 
   //void crop(string, Dtype *, int crop_height_, int crop_width_);
-  void crop(string, Dtype *);
-  struct textinfo{
-    int label;
-    string content;
-  };
-  vector<textinfo> text_info_;
-  int current_row_;
-  int data_count;
+  void crop(const int32_t* tokens, int length, int height, Dtype* data_out);
+  // Fills the batch items assigned to worker_id, run on every worker.
+  void load_items(Dtype* data, Dtype* label, Dtype* length, int worker_id);
+  // Index of the length bucket a sample of the given length falls into.
+  int bucket(int length) const;
+  // A sample id indexes corpus_, or stream_ when reading shards.
+  inline int sample_label(int id) const {
+    return stream_ ? stream_->sample(id).label : corpus_.label(id);
+  }
+  inline int sample_length(int id) const {
+    return stream_ ? stream_->sample(id).tokens.size() : corpus_.length(id);
+  }
+  inline const int32_t* sample_tokens(int id) const {
+    if (!stream_) {
+      return corpus_.tokens(id);
+    }
+    const vector<int32_t>& tokens = stream_->sample(id).tokens;
+    return tokens.empty() ? NULL : &tokens[0];
+  }
+  TextCorpus corpus_;
+  // New index of every word read, when the dict rows were renumbered.
+  VocabRemap vocab_remap_;
+  shared_ptr<ShuffleBuffer<TextSample> > stream_;
+  // Order in which corpus samples are visited; shuffled every epoch.
+  shared_ptr<SamplePermutation> order_;
+  // Samples of the batch being assembled, picked serially before the
+  // workers fill their disjoint item slots.
+  vector<int> batch_samples_;
+  // Samples drawn in order and waiting until their bucket has batch_size_
+  // of them. Without bucket_boundaries there is a single bucket of height
+  // crop_height_, so batches follow order_ exactly.
+  vector<int> bucket_heights_;
+  vector<vector<int> > bucket_pending_;
+  int batch_height_;
+  shared_ptr<ThreadPool> workers_;
 
   size_t batch_size_;
   int num_words_, channel_, crop_height_, crop_width_;
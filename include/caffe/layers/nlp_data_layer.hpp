@@ -1,6 +1,7 @@
 #ifndef CAFFE_IMAGE_DATA_LAYER_HPP_
 #define CAFFE_IMAGE_DATA_LAYER_HPP_
 
+#include <fstream>  // NOLINT(readability/streams)
 #include <string>
 #include <utility>
 #include <vector>
@@ -11,6 +12,11 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/async_reader.hpp"
+#include "caffe/util/sample_pack.hpp"
+#include "caffe/util/sample_permutation.hpp"
+#include "caffe/util/shuffle_buffer.hpp"
+#include "caffe/util/thread_pool.hpp"
 
 namespace caffe {
 
@@ -36,17 +42,48 @@ class NlpDataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual inline int ExactNumBottomBlobs() const { return 0; }
   virtual inline int ExactNumTopBlobs() const { return 2; }
  protected:
-  shared_ptr<Caffe::RNG> prefetch_rng_;
-  virtual void ShuffleImages();
   virtual void load_batch(Batch<Dtype>* batch);
 
   void crop(string, Dtype *, int crop_height_, int crop_width_);
+  // Fills the batch items assigned to worker_id, run on every worker.
+  void load_items(Dtype* data, Dtype* label, int worker_id);
   struct nlpinfo{
     int label;
     string filename;
   };
+  // Reads the label and list files of each shard in order, one sample at a
+  // time, starting over after the last shard.
+  class ShardReader : public SampleReader<nlpinfo> {
+   public:
+    ShardReader(const string& shard_list, const string& image_prefix);
+    virtual void Read(nlpinfo* sample);
+
+   protected:
+    void OpenShard(int shard);
+
+    vector<std::pair<string, string> > shards_;
+    string image_prefix_;
+    int shard_;
+    int remaining_;
+    std::ifstream label_file_, data_file_;
+  };
+  // A sample id indexes nlp_info_, or stream_ when reading shards.
+  inline const nlpinfo& sample(int id) const {
+    return stream_ ? stream_->sample(id) : nlp_info_[id];
+  }
+  // Read once and never reordered; order_ holds the visiting order.
   vector<nlpinfo> nlp_info_;
-  int current_row_;
+  shared_ptr<SamplePermutation> order_;
+  // Replaces nlp_info_ when shard_source is set.
+  shared_ptr<ShuffleBuffer<nlpinfo> > stream_;
+  // Replaces nlp_info_ and the per-sample files when pack_source is set.
+  shared_ptr<SamplePack> pack_;
+  // Reads the per-sample files of a batch when io_depth is set.
+  shared_ptr<AsyncReader> reader_;
+  // Samples of the batch being assembled, picked serially before the
+  // workers fill their disjoint item slots.
+  vector<int> batch_ids_;
+  shared_ptr<ThreadPool> workers_;
   int data_count;
 
   size_t batch_size_;
@@ -12,6 +12,14 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/embedding_dict.hpp"
+#include "caffe/util/row_copy.hpp"
+#include "caffe/util/sample_permutation.hpp"
+#include "caffe/util/text_corpus.hpp"
+#include "caffe/util/text_stream.hpp"
+#include "caffe/util/thread_pool.hpp"
+#include "caffe/util/vocab_hash.hpp"
+#include "caffe/util/vocab_remap.hpp"
 
 namespace caffe {
 
@@ -24,7 +32,7 @@ template <typename Dtype>
 class TextDataLayer : public BasePrefetchingDataLayer<Dtype> {
  public:
   explicit TextDataLayer(const LayerParameter& param)
-      : BasePrefetchingDataLayer<Dtype>(param) {}
+      : BasePrefetchingDataLayer<Dtype>(param), raw_text_(false) {}
 
   virtual ~TextDataLayer();
   virtual void DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
@@ -37,18 +45,50 @@ class TextDataLayer : public BasePrefetchingDataLayer<Dtype> {
   virtual inline int ExactNumBottomBlobs() const { return 0; }
   virtual inline int ExactNumTopBlobs() const { return 2; }
  protected:
-  shared_ptr<Caffe::RNG> prefetch_rng_;
-  virtual void ShuffleText();
   virtual void load_batch(Batch<Dtype>* batch);
 
   //void crop(string, Dtype *, int crop_height_, int crop_width_);
-  void crop(string, Dtype *);
-  struct textinfo{
-    int label;
-    string content;
-  };
-  vector<textinfo> text_info_;
-  int current_row_;
+  void crop(const int32_t* tokens, int length, Dtype* data_out,
+      Caffe::RNG* rng);
+  // Fills the batch items assigned to worker_id, run on every worker.
+  void load_items(Dtype* data, Dtype* label, int worker_id);
+  // A sample id indexes corpus_, or stream_ when reading shards.
+  inline int sample_label(int id) const {
+    if (stream_) {
+      return stream_->sample(id).label;
+    }
+    return raw_text_ ? raw_corpus_.label(id) : corpus_.label(id);
+  }
+  inline int sample_length(int id) const {
+    return stream_ ? stream_->sample(id).tokens.size() : corpus_.length(id);
+  }
+  inline const int32_t* sample_tokens(int id) const {
+    if (!stream_) {
+      return corpus_.tokens(id);
+    }
+    const vector<int32_t>& tokens = stream_->sample(id).tokens;
+    return tokens.empty() ? NULL : &tokens[0];
+  }
+  TextCorpus corpus_;
+  // New index of every word read, when the dict rows were renumbered.
+  VocabRemap vocab_remap_;
+  // With vocab_source, samples are raw text that each worker tokenizes
+  // into its own buffer.
+  bool raw_text_;
+  RawTextCorpus raw_corpus_;
+  VocabHash vocab_;
+  int32_t unknown_word_;
+  vector<vector<int32_t> > worker_tokens_;
+  shared_ptr<ShuffleBuffer<TextSample> > stream_;
+  // Order in which corpus samples are visited; shuffled every epoch.
+  shared_ptr<SamplePermutation> order_;
+  // Samples of the batch being assembled, picked serially before the
+  // workers fill their disjoint item slots.
+  vector<int> batch_samples_;
+  shared_ptr<ThreadPool> workers_;
+  // One crop offset stream per worker, so that a given seed and worker
+  // count always produce the same batches.
+  vector<shared_ptr<Caffe::RNG> > worker_rngs_;
   int data_count;
 
   size_t batch_size_;
@@ -56,7 +96,14 @@ class TextDataLayer : public BasePrefetchingDataLayer<Dtype> {
   bool shuffle_;
   bool flip_;
 
+  // Word vectors shared by every layer of the process, or converted into
+  // vec_dict when the dict is not stored as Dtype. dict_data_ is NULL for a
+  // quantized dict, whose rows are dequantized as they are looked up.
+  const Dtype* dict_data_;
+  int dict_rows_;
+  shared_ptr<EmbeddingDict> dict_;
   vector<Dtype> vec_dict;
+  RowCopier<Dtype> copy_row_;
 };
 }  // namespace caffe
 
@@ -0,0 +1,100 @@
+#ifndef CAFFE_WINOGRAD_CONV_LAYER_HPP_
+#define CAFFE_WINOGRAD_CONV_LAYER_HPP_
+
+#include <vector>
+
+#include "caffe/blob.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+
+#include "caffe/layers/conv_layer.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Convolves 3x3, stride 1 filters with Winograd's minimal filtering
+ *        algorithm F(m x m, 3 x 3) on the CPU (engine: WINOGRAD).
+ *
+ * The output is computed in m x m tiles (m = winograd_tile, 2 or 4), each
+ * from an (m + 2) x (m + 2) tile of the input. With the input tiles and the
+ * filters taken to the Winograd domain, a tile costs (m + 2)^2 multiplies
+ * per input and output channel instead of 9 m^2: 2.25x fewer for m = 2, 4x
+ * fewer for m = 4. Summed over the input channels, the elementwise products
+ * of each of the (m + 2)^2 positions are one gemm over all tiles. F(4x4)
+ * rounds more than F(2x2), with errors around 1e-5 of the output scale in
+ * single precision against 1e-6.
+ *
+ * The backward passes run the transposes of the same linear maps, so that
+ * the gradients are those of the computed output. The transformed filters
+ * are kept, and recomputed only when the weights differ from the ones they
+ * were computed from.
+ *
+ * Other shapes (kernels other than 3x3, strides, dilations, non-2D inputs)
+ * fall back to ConvolutionLayer, as does the GPU.
+ */
+template <typename Dtype>
+class WinogradConvolutionLayer : public ConvolutionLayer<Dtype> {
+ public:
+  explicit WinogradConvolutionLayer(const LayerParameter& param)
+      : ConvolutionLayer<Dtype>(param) {}
+  virtual void LayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  virtual void Reshape(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+
+ protected:
+  virtual void Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top);
+  virtual void Backward_cpu(const vector<Blob<Dtype>*>& top,
+      const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom);
+
+  // Recomputes transformed_weights_ if the weights changed.
+  void transform_weights();
+  // Takes the input tiles of one image to the Winograd domain, in
+  // input_tiles_.
+  void transform_input(const Dtype* input);
+  // The outputs of one image from the products in product_tiles_.
+  void transform_output(Dtype* output);
+  // The products of the transformed filters and input tiles of one image.
+  void multiply_tiles();
+  // The backward counterparts: product_tiles_ from the top diff of an
+  // image, the transformed filter diffs, and the input tile diffs.
+  void transform_output_diff(const Dtype* output_diff);
+  void accumulate_weight_diff();
+  void multiply_tiles_diff();
+  void transform_input_diff(Dtype* input_diff);
+
+  // Whether the shape is supported; Forward and Backward fall back to
+  // ConvolutionLayer otherwise.
+  bool winograd_;
+  int tile_;
+  int alpha_;
+  int tiles_h_;
+  int tiles_w_;
+  int num_tiles_;
+  int height_;
+  int width_;
+  int height_out_;
+  int width_out_;
+  int pad_h_;
+  int pad_w_;
+  int in_channels_;
+  int out_channels_;
+  // The transforms B^T (alpha x alpha), G (alpha x 3) and A^T (m x alpha).
+  vector<Dtype> input_transform_;
+  vector<Dtype> filter_transform_;
+  vector<Dtype> output_transform_;
+  // alpha^2 matrices of out_channels_ x (in_channels_ / group_).
+  Blob<Dtype> transformed_weights_;
+  Blob<Dtype> transformed_weight_diff_;
+  // The weights transformed_weights_ was computed from.
+  vector<Dtype> transformed_from_;
+  // alpha^2 matrices of in_channels_ x num_tiles_.
+  Blob<Dtype> input_tiles_;
+  // alpha^2 matrices of out_channels_ x num_tiles_.
+  Blob<Dtype> product_tiles_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_WINOGRAD_CONV_LAYER_HPP_
@@ -294,7 +294,8 @@ class Net {
    * learnable_param_ids_.size() == params_.size(),
    * and learnable_params_[learnable_param_ids_[i]] == params_[i].get()
    * if and only if params_[i] is an "owner"; otherwise, params_[i] is a sharer
-   * and learnable_params_[learnable_param_ids_[i]] gives its owner.
+   * and learnable_params_[learnable_param_ids_[i]] gives its owner. Params
+   * their layers fix (Layer::FixedParam) are not learnable and map to -1.
    */
   vector<int> learnable_param_ids_;
   /// the learning rate multipliers for learnable_params_
@@ -11,6 +11,17 @@ namespace caffe {
 /**
  * @brief Optimizes the parameters of a Net using
  *        stochastic gradient descent (SGD) with momentum.
+ *
+ * In CPU mode, parameters with a row-sparse diff (see Blob::diff_rows(),
+ * and sparse_gradient of the Embed and DictEmbed layers) are updated
+ * lazily: only the rows touched by the batch are regularized, pushed
+ * through momentum and updated. The steps a row skipped, with a zero
+ * gradient, are applied in closed form when it is next touched, and to all
+ * rows before testing, snapshotting and at the end of Solve(); in between,
+ * the train net reads untouched rows as of their last update. The skipped
+ * steps are all taken at the learning rate of the iteration that catches
+ * them up, so with an lr_policy other than "fixed" the lazy update only
+ * approximates the dense one.
  */
 template <typename Dtype>
 class SGDSolver : public Solver<Dtype> {
@@ -31,6 +42,15 @@ class SGDSolver : public Solver<Dtype> {
   virtual void Regularize(int param_id);
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
   virtual void ClipGradients();
+  // Whether ComputeUpdateValue() is the plain momentum update, which
+  // SparseUpdate() can apply row by row.
+  virtual inline bool SupportsSparseUpdate() const { return true; }
+  // Normalize(), Regularize() and ComputeUpdateValue() for the touched rows
+  // of a row-sparse param only.
+  void SparseUpdate(int param_id, Dtype rate);
+  // Applies the steps a lazily updated row skipped up to iter_.
+  void CatchUpRow(int param_id, int row, Dtype rate);
+  virtual void CatchUpParams();
   virtual void SnapshotSolverState(const string& model_filename);
   virtual void SnapshotSolverStateToBinaryProto(const string& model_filename);
   virtual void SnapshotSolverStateToHDF5(const string& model_filename);
@@ -41,6 +61,12 @@ class SGDSolver : public Solver<Dtype> {
   // temp maintains other information that might be needed in computation
   //   of gradients/updates and is not needed in snapshots
   vector<shared_ptr<Blob<Dtype> > > history_, update_, temp_;
+  // For lazily updated params, the first iteration not yet applied to each
+  // row; empty for the others.
+  vector<vector<int> > row_iters_;
+  // The learning rate of the last update, at which CatchUpParams() applies
+  // the skipped steps.
+  Dtype last_rate_;
 
   DISABLE_COPY_AND_ASSIGN(SGDSolver);
 };
@@ -53,6 +79,7 @@ class NesterovSolver : public SGDSolver<Dtype> {
   explicit NesterovSolver(const string& param_file)
       : SGDSolver<Dtype>(param_file) {}
   virtual inline const char* type() const { return "Nesterov"; }
+  virtual inline bool SupportsSparseUpdate() const { return false; }
 
  protected:
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
@@ -68,6 +95,7 @@ class AdaGradSolver : public SGDSolver<Dtype> {
   explicit AdaGradSolver(const string& param_file)
       : SGDSolver<Dtype>(param_file) { constructor_sanity_check(); }
   virtual inline const char* type() const { return "AdaGrad"; }
+  virtual inline bool SupportsSparseUpdate() const { return false; }
 
  protected:
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
@@ -88,6 +116,7 @@ class RMSPropSolver : public SGDSolver<Dtype> {
   explicit RMSPropSolver(const string& param_file)
       : SGDSolver<Dtype>(param_file) { constructor_sanity_check(); }
   virtual inline const char* type() const { return "RMSProp"; }
+  virtual inline bool SupportsSparseUpdate() const { return false; }
 
  protected:
   virtual void ComputeUpdateValue(int param_id, Dtype rate);
@@ -111,6 +140,7 @@ class AdaDeltaSolver : public SGDSolver<Dtype> {
   explicit AdaDeltaSolver(const string& param_file)
       : SGDSolver<Dtype>(param_file) { AdaDeltaPreSolve(); }
   virtual inline const char* type() const { return "AdaDelta"; }
+  virtual inline bool SupportsSparseUpdate() const { return false; }
 
  protected:
   void AdaDeltaPreSolve();
@@ -135,6 +165,7 @@ class AdamSolver : public SGDSolver<Dtype> {
   explicit AdamSolver(const string& param_file)
       : SGDSolver<Dtype>(param_file) { AdamPreSolve(); }
   virtual inline const char* type() const { return "Adam"; }
+  virtual inline bool SupportsSparseUpdate() const { return false; }
 
  protected:
   void AdamPreSolve();
@@ -100,6 +100,9 @@ class Solver {
   string SnapshotFilename(const string extension);
   string SnapshotToBinaryProto();
   string SnapshotToHDF5();
+  // Brings the params of a solver that updates them lazily up to date, as
+  // they would be after iter_ dense updates.
+  virtual void CatchUpParams() {}
   // The test routine
   void TestAll();
   void Test(const int test_net_id = 0);
@@ -107,6 +110,8 @@ class Solver {
   virtual void RestoreSolverStateFromHDF5(const string& state_file) = 0;
   virtual void RestoreSolverStateFromBinaryProto(const string& state_file) = 0;
   void DisplayOutputBlobs(const int net_id);
+  // Logs and resets the prefetch stats of the train net's data layers.
+  void DisplayPrefetchStats();
   void UpdateSmoothedLoss(Dtype loss, int start_iter, int average_loss);
 
   SolverParameter param_;
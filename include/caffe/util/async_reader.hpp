@@ -0,0 +1,59 @@
+#ifndef CAFFE_UTIL_ASYNC_READER_HPP_
+#define CAFFE_UTIL_ASYNC_READER_HPP_
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Reads many whole files into memory with many requests in flight.
+ *
+ * Reads are queued with Add() and issued together by Wait(), which keeps
+ * up to depth of them outstanding so that the storage queue stays deep.
+ * When built with USE_IO_URING and the kernel supports it, the reads go
+ * through an io_uring; otherwise depth threads issue blocking preads.
+ */
+class AsyncReader {
+ public:
+  explicit AsyncReader(int depth);
+  ~AsyncReader();
+
+  /// @brief Queues a read of the first size bytes of filename into dst.
+  void Add(const string& filename, void* dst, size_t size);
+  /// @brief Issues the queued reads and returns once all of them are done.
+  void Wait();
+
+  inline int depth() const { return depth_; }
+  inline bool uses_io_uring() const { return ring_ != NULL; }
+
+ protected:
+  struct Request {
+    string filename;
+    char* dst;
+    size_t size;
+  };
+  // Fallback: worker w reads requests w, w + depth, ...
+  void ReadRequests(int worker_id);
+  void WaitRing();
+
+  /**
+   Keep liburing out of this header, as thread_pool.hpp does for
+   boost/thread.hpp.
+   */
+  class Ring;
+
+  const int depth_;
+  vector<Request> requests_;
+  Ring* ring_;
+  shared_ptr<ThreadPool> pool_;
+
+  DISABLE_COPY_AND_ASSIGN(AsyncReader);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_ASYNC_READER_HPP_
@@ -0,0 +1,108 @@
+#ifndef CAFFE_UTIL_EMBEDDING_DICT_HPP_
+#define CAFFE_UTIL_EMBEDDING_DICT_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/mapped_file.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A word embedding table stored as a binary file and memory-mapped.
+ *
+ * Binary layout (native endianness):
+ *   EmbeddingDictHeader
+ *   FLOAT, DOUBLE, FLOAT16: rows x dim values of the dtype, row-major.
+ *   INT8: rows x (float scale, float offset), then rows x dim int8 codes;
+ *         value = scale * code + offset, with one scale and offset per row.
+ *
+ * The quantized dtypes are read by dequantizing the rows that are looked up,
+ * see CopyRow(); tools/quantize_embedding_dict writes them.
+ *
+ * Opening a dictionary costs the same regardless of its size, and every
+ * process and layer mapping the same file shares one physical copy through
+ * the page cache. tools/convert_embedding_dict converts the whitespace
+ * separated text dictionaries into this format. GetShared() also accepts
+ * text dictionaries, which it parses once per process.
+ */
+struct EmbeddingDictHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t dtype;
+  uint64_t rows;
+  uint64_t dim;
+};
+
+class EmbeddingDict {
+ public:
+  enum Type { FLOAT = 0, DOUBLE = 1, FLOAT16 = 2, INT8 = 3 };
+
+  /**
+   * @brief Maps filename. A writable mapping is private copy-on-write memory
+   *        that can back a learnable blob.
+   */
+  explicit EmbeddingDict(const string& filename, bool writable = false);
+
+  /**
+   * @brief Returns the read-only table of filename shared by every caller
+   *        in this process.
+   *
+   * A binary dict is mapped. A text dict is parsed into float rows of dim
+   * values; dim is ignored for binary dicts, which record their own.
+   */
+  static shared_ptr<EmbeddingDict> GetShared(const string& filename,
+      int dim = 0);
+  static bool IsBinary(const string& filename);
+  template <typename Dtype>
+  static void Write(const string& filename, int rows, int dim,
+      const Dtype* data);
+  /// @brief Writes a float table stored as dtype, quantizing it if need be.
+  static void Write(const string& filename, int rows, int dim,
+      const float* data, Type dtype);
+  /**
+   * @brief Writes this table with row i moved to new_index[i], storing each
+   *        row as it is stored here: quantized rows keep their codes, and
+   *        INT8 rows their scale and offset.
+   */
+  void WritePermuted(const string& filename,
+      const vector<int32_t>& new_index) const;
+
+  inline int rows() const { return rows_; }
+  inline int dim() const { return dim_; }
+  inline Type dtype() const { return dtype_; }
+  inline bool quantized() const { return dtype_ == FLOAT16 || dtype_ == INT8; }
+
+  /// @brief The table itself if it is stored as Dtype, NULL otherwise.
+  template <typename Dtype>
+  const Dtype* data() const;
+  template <typename Dtype>
+  Dtype* mutable_data();
+  /// @brief Copies the table into out, converting it to Dtype.
+  template <typename Dtype>
+  void CopyTo(Dtype* out) const;
+  /// @brief Copies row into out, converting it to Dtype.
+  template <typename Dtype>
+  void CopyRow(int row, Dtype* out) const;
+
+ private:
+  EmbeddingDict() : table_(NULL), rows_(0), dim_(0), dtype_(FLOAT) {}
+  void LoadText(const string& filename, int dim);
+
+  MappedFile file_;
+  // Storage of a text dict; binary dicts live in file_.
+  vector<float> text_table_;
+  const char* table_;
+  int rows_;
+  int dim_;
+  Type dtype_;
+
+  DISABLE_COPY_AND_ASSIGN(EmbeddingDict);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_EMBEDDING_DICT_HPP_
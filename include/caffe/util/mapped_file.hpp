@@ -0,0 +1,49 @@
+#ifndef CAFFE_UTIL_MAPPED_FILE_HPP_
+#define CAFFE_UTIL_MAPPED_FILE_HPP_
+
+#include <string>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A private memory mapping of a whole file.
+ *
+ * The pages are backed by the page cache and shared between every process
+ * and layer that maps the same file. A writable mapping is copy-on-write:
+ * a page is only duplicated once it is written, and writes never reach the
+ * file.
+ */
+class MappedFile {
+ public:
+  MappedFile() : data_(NULL), size_(0), writable_(false) {}
+  explicit MappedFile(const string& filename, bool writable = false)
+      : data_(NULL), size_(0), writable_(false) {
+    Open(filename, writable);
+  }
+  ~MappedFile() { Close(); }
+
+  void Open(const string& filename, bool writable = false);
+  void Close();
+
+  inline const char* data() const { return data_; }
+  inline char* mutable_data() {
+    CHECK(writable_) << filename_ << " is mapped read-only";
+    return const_cast<char*>(data_);
+  }
+  inline size_t size() const { return size_; }
+  inline const string& filename() const { return filename_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+  bool writable_;
+  string filename_;
+
+  DISABLE_COPY_AND_ASSIGN(MappedFile);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_MAPPED_FILE_HPP_
@@ -0,0 +1,104 @@
+#ifndef CAFFE_UTIL_NEURON_KERNELS_HPP_
+#define CAFFE_UTIL_NEURON_KERNELS_HPP_
+
+namespace caffe {
+
+/**
+ * @brief Elementwise kernels of the CPU neuron layers.
+ *
+ * The float kernels have SSE2, AVX2 (with FMA) and AVX-512F versions, built
+ * with function-level target attributes so that no compiler flag is needed,
+ * and the widest one the CPU supports is chosen once from CPUID. Other CPUs
+ * and compilers, and the double kernels, run plain loops over <cmath>.
+ *
+ * The SIMD versions approximate exp, tanh and log with polynomials (after
+ * Cephes). Their largest errors over a dense sweep of the float range,
+ * against the correctly rounded results, are
+ *   - 1 ulp for caffe_cpu_fast_exp, with denormal results where they should
+ *     be and 0 below log(2^-150),
+ *   - 1 ulp for caffe_cpu_tanh,
+ *   - 2 ulp for caffe_cpu_sigmoid and caffe_cpu_bnll,
+ *   - 1e-7 absolute for caffe_cpu_elu, where exp(x) - 1 cancels near 0.
+ * The SIMD versions differ from each other only by FMA rounding. NaNs
+ * propagate. Every kernel may run in place.
+ */
+
+/// @brief y = max(x, 0) + negative_slope * min(x, 0)
+template <typename Dtype>
+void caffe_cpu_relu(const int n, const Dtype* x, const Dtype negative_slope,
+    Dtype* y);
+/// @brief dx = dy * (x > 0 ? 1 : negative_slope); 0 where x is NaN.
+template <typename Dtype>
+void caffe_cpu_relu_backward(const int n, const Dtype* x, const Dtype* dy,
+    const Dtype negative_slope, Dtype* dx);
+
+/// @brief y = 1 / (1 + exp(-x))
+template <typename Dtype>
+void caffe_cpu_sigmoid(const int n, const Dtype* x, Dtype* y);
+/// @brief dx = dy * y * (1 - y), from the output y.
+template <typename Dtype>
+void caffe_cpu_sigmoid_backward(const int n, const Dtype* y, const Dtype* dy,
+    Dtype* dx);
+
+/// @brief y = tanh(x)
+template <typename Dtype>
+void caffe_cpu_tanh(const int n, const Dtype* x, Dtype* y);
+/// @brief dx = dy * (1 - y^2), from the output y.
+template <typename Dtype>
+void caffe_cpu_tanh_backward(const int n, const Dtype* y, const Dtype* dy,
+    Dtype* dx);
+
+/// @brief y = max(x, 0) + alpha * (exp(min(x, 0)) - 1)
+template <typename Dtype>
+void caffe_cpu_elu(const int n, const Dtype* x, const Dtype alpha, Dtype* y);
+/// @brief dx = dy * (x > 0 ? 1 : alpha + y)
+template <typename Dtype>
+void caffe_cpu_elu_backward(const int n, const Dtype* x, const Dtype* y,
+    const Dtype* dy, const Dtype alpha, Dtype* dx);
+
+/// @brief y = log(1 + exp(x))
+template <typename Dtype>
+void caffe_cpu_bnll(const int n, const Dtype* x, Dtype* y);
+/// @brief dx = dy * sigmoid(x)
+template <typename Dtype>
+void caffe_cpu_bnll_backward(const int n, const Dtype* x, const Dtype* dy,
+    Dtype* dx);
+
+/// @brief y = exp(x)
+template <typename Dtype>
+void caffe_cpu_fast_exp(const int n, const Dtype* x, Dtype* y);
+
+/**
+ * @brief y = (shift + scale * x)^power
+ *
+ * Powers 1, 2 and 0.5 are vectorized; other powers call std::pow on the
+ * vectorized base.
+ */
+template <typename Dtype>
+void caffe_cpu_power(const int n, const Dtype* x, const Dtype scale,
+    const Dtype shift, const Dtype power, Dtype* y);
+
+/// @brief The instruction sets the float kernels are built for.
+enum SimdLevel {
+  SIMD_SCALAR = 0,
+  SIMD_SSE2 = 1,
+  SIMD_AVX2 = 2,
+  SIMD_AVX512 = 3
+};
+
+/// @brief The widest instruction set this CPU supports.
+SimdLevel max_simd_level();
+/// @brief The instruction set the float kernels run, max_simd_level() unless
+///        set otherwise.
+SimdLevel simd_level();
+/**
+ * @brief Runs the float kernels with the given instruction set, which the
+ *        CPU must support; for tests and benchmarks. Not to be called while
+ *        kernels are running.
+ */
+void set_simd_level(SimdLevel level);
+const char* simd_level_name(SimdLevel level);
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_NEURON_KERNELS_HPP_
@@ -0,0 +1,302 @@
+// The float neuron kernels, written against a small vector interface:
+//   Vec, Mask, kWidth, Load, Store, Set, Add, Sub, Mul, Div, Sqrt,
+//   MulAdd(a, b, c) = a * b + c, Max, Min (which return b when either is
+//   NaN), Less, Greater, LessEqual, IsNaN, Select(m, a, b) = m ? a : b, Abs,
+//   CopySign, Floor, Pow2 (2^n for integral n in [-126, 127]) and Frexp.
+// neuron_kernels.cpp includes this file once per instruction set, inside a
+// namespace that defines the interface and with that instruction set
+// enabled; it is not a header of its own.
+// NOLINT(build/header_guard)
+
+// Map the kernels over n values, running the tail through one padded vector
+// so that it gets the same rounding as the rest.
+template <typename Op>
+void Map1(const int n, const float* a, float* y, const Op& op) {
+  int i = 0;
+  for (; i + kWidth <= n; i += kWidth) {
+    Store(y + i, op(Load(a + i)));
+  }
+  if (i < n) {
+    float in_a[kWidth] = {0}, out[kWidth];
+    std::copy(a + i, a + n, in_a);
+    Store(out, op(Load(in_a)));
+    std::copy(out, out + (n - i), y + i);
+  }
+}
+
+template <typename Op>
+void Map2(const int n, const float* a, const float* b, float* y,
+    const Op& op) {
+  int i = 0;
+  for (; i + kWidth <= n; i += kWidth) {
+    Store(y + i, op(Load(a + i), Load(b + i)));
+  }
+  if (i < n) {
+    float in_a[kWidth] = {0}, in_b[kWidth] = {0}, out[kWidth];
+    std::copy(a + i, a + n, in_a);
+    std::copy(b + i, b + n, in_b);
+    Store(out, op(Load(in_a), Load(in_b)));
+    std::copy(out, out + (n - i), y + i);
+  }
+}
+
+template <typename Op>
+void Map3(const int n, const float* a, const float* b, const float* c,
+    float* y, const Op& op) {
+  int i = 0;
+  for (; i + kWidth <= n; i += kWidth) {
+    Store(y + i, op(Load(a + i), Load(b + i), Load(c + i)));
+  }
+  if (i < n) {
+    float in_a[kWidth] = {0}, in_b[kWidth] = {0}, in_c[kWidth] = {0};
+    float out[kWidth];
+    std::copy(a + i, a + n, in_a);
+    std::copy(b + i, b + n, in_b);
+    std::copy(c + i, c + n, in_c);
+    Store(out, op(Load(in_a), Load(in_b), Load(in_c)));
+    std::copy(out, out + (n - i), y + i);
+  }
+}
+
+// Cephes expf: x = k ln2 + r with |r| <= ln2 / 2, ln2 split in two so that
+// k ln2 is exact, and a degree 7 polynomial for exp(r). 2^k is applied in
+// two halves so that both overflow and denormal results come out right.
+inline Vec ExpV(Vec x) {
+  const Vec input = x;
+  x = Min(Max(x, Set(kExpMin)), Set(kExpMax));
+  const Vec k = Floor(MulAdd(x, Set(1.44269504088896341f), Set(0.5f)));
+  x = Sub(x, Mul(k, Set(0.693359375f)));
+  x = Sub(x, Mul(k, Set(-2.12194440e-4f)));
+  Vec y = Set(1.9875691500e-4f);
+  y = MulAdd(y, x, Set(1.3981999507e-3f));
+  y = MulAdd(y, x, Set(8.3334519073e-3f));
+  y = MulAdd(y, x, Set(4.1665795894e-2f));
+  y = MulAdd(y, x, Set(1.6666665459e-1f));
+  y = MulAdd(y, x, Set(5.0000001201e-1f));
+  y = MulAdd(y, Mul(x, x), Add(x, Set(1.f)));
+  const Vec k_half = Floor(Mul(k, Set(0.5f)));
+  y = Mul(Mul(y, Pow2(k_half)), Pow2(Sub(k, k_half)));
+  y = Select(Greater(input, Set(kExpMax)), Set(kInfinity), y);
+  y = Select(Less(input, Set(kExpMin)), Set(0.f), y);
+  return Select(IsNaN(input), input, y);
+}
+
+// Cephes logf, for positive normal x: x = m 2^e with m in [sqrt(1/2),
+// sqrt(2)), and a degree 9 polynomial for log(m).
+inline Vec LogV(Vec x) {
+  Vec e;
+  Vec m = Frexp(x, &e);
+  const Mask small = Less(m, Set(0.707106781186547524f));
+  e = Sub(e, Select(small, Set(1.f), Set(0.f)));
+  m = Sub(Add(m, Select(small, m, Set(0.f))), Set(1.f));
+  const Vec z = Mul(m, m);
+  Vec y = Set(7.0376836292e-2f);
+  y = MulAdd(y, m, Set(-1.1514610310e-1f));
+  y = MulAdd(y, m, Set(1.1676998740e-1f));
+  y = MulAdd(y, m, Set(-1.2420140846e-1f));
+  y = MulAdd(y, m, Set(1.4249322787e-1f));
+  y = MulAdd(y, m, Set(-1.6668057665e-1f));
+  y = MulAdd(y, m, Set(2.0000714765e-1f));
+  y = MulAdd(y, m, Set(-2.4999993993e-1f));
+  y = MulAdd(y, m, Set(3.3333331174e-1f));
+  y = Mul(Mul(y, m), z);
+  y = MulAdd(e, Set(-2.12194440e-4f), y);
+  y = MulAdd(z, Set(-0.5f), y);
+  return MulAdd(e, Set(0.693359375f), Add(m, y));
+}
+
+// 1 / (1 + exp(-x)), or exp(x) / (1 + exp(x)) for negative x so that exp
+// does not overflow where the result is denormal.
+inline Vec SigmoidV(Vec x) {
+  const Vec one = Set(1.f);
+  const Vec t = ExpV(Sub(Set(0.f), Abs(x)));
+  return Div(Select(Less(x, Set(0.f)), t, one), Add(one, t));
+}
+
+// Cephes tanhf: an odd polynomial below 0.625, where 1 - 2 / (exp(2x) + 1)
+// would cancel, and that formula above.
+inline Vec TanHV(Vec x) {
+  const Vec one = Set(1.f);
+  const Vec ax = Abs(x);
+  const Vec z = Mul(x, x);
+  Vec p = Set(-5.70498872745e-3f);
+  p = MulAdd(p, z, Set(2.06390887954e-2f));
+  p = MulAdd(p, z, Set(-5.37397155531e-2f));
+  p = MulAdd(p, z, Set(1.33314422036e-1f));
+  p = MulAdd(p, z, Set(-3.33332819422e-1f));
+  const Vec small = MulAdd(Mul(p, z), x, x);
+  const Vec t = ExpV(Add(ax, ax));
+  const Vec large = CopySign(Sub(one, Div(Set(2.f), Add(t, one))), x);
+  return Select(Less(ax, Set(0.625f)), small, large);
+}
+
+// log(1 + exp(x)) = max(x, 0) + log1p(exp(-|x|)), with log1p(t) computed as
+// log(u) t / (u - 1) for u = 1 + t (Goldberg), exact where u rounds to 1.
+inline Vec BnllV(Vec x) {
+  const Vec one = Set(1.f);
+  const Vec t = ExpV(Sub(Set(0.f), Abs(x)));
+  const Vec u = Add(one, t);
+  const Vec log1p = Select(Greater(u, one),
+      Mul(LogV(u), Div(t, Sub(u, one))), t);
+  return Add(Max(Set(0.f), x), log1p);
+}
+
+struct ReluOp {
+  explicit ReluOp(float slope) : slope(Set(slope)) {}
+  Vec operator()(Vec x) const {
+    const Vec zero = Set(0.f);
+    return MulAdd(slope, Min(zero, x), Max(zero, x));
+  }
+  Vec slope;
+};
+
+struct ReluBackwardOp {
+  explicit ReluBackwardOp(float slope) : slope(Set(slope)) {}
+  Vec operator()(Vec x, Vec dy) const {
+    const Vec zero = Set(0.f);
+    return Select(Greater(x, zero), dy,
+        Select(LessEqual(x, zero), Mul(slope, dy), zero));
+  }
+  Vec slope;
+};
+
+struct SigmoidOp {
+  Vec operator()(Vec x) const { return SigmoidV(x); }
+};
+
+struct SigmoidBackwardOp {
+  Vec operator()(Vec y, Vec dy) const {
+    return Mul(Mul(dy, y), Sub(Set(1.f), y));
+  }
+};
+
+struct TanHOp {
+  Vec operator()(Vec x) const { return TanHV(x); }
+};
+
+struct TanHBackwardOp {
+  Vec operator()(Vec y, Vec dy) const {
+    return Mul(dy, Sub(Set(1.f), Mul(y, y)));
+  }
+};
+
+struct EluOp {
+  explicit EluOp(float alpha) : alpha(Set(alpha)) {}
+  Vec operator()(Vec x) const {
+    const Vec zero = Set(0.f);
+    return MulAdd(alpha, Sub(ExpV(Min(zero, x)), Set(1.f)), Max(zero, x));
+  }
+  Vec alpha;
+};
+
+struct EluBackwardOp {
+  explicit EluBackwardOp(float alpha) : alpha(Set(alpha)) {}
+  Vec operator()(Vec x, Vec y, Vec dy) const {
+    const Vec zero = Set(0.f);
+    return Select(Greater(x, zero), dy,
+        Select(LessEqual(x, zero), Mul(Add(alpha, y), dy), zero));
+  }
+  Vec alpha;
+};
+
+struct BnllOp {
+  Vec operator()(Vec x) const { return BnllV(x); }
+};
+
+struct BnllBackwardOp {
+  Vec operator()(Vec x, Vec dy) const { return Mul(dy, SigmoidV(x)); }
+};
+
+struct ExpOp {
+  Vec operator()(Vec x) const { return ExpV(x); }
+};
+
+struct AffineOp {
+  AffineOp(float scale, float shift) : scale(Set(scale)), shift(Set(shift)) {}
+  Vec operator()(Vec x) const { return MulAdd(x, scale, shift); }
+  Vec scale;
+  Vec shift;
+};
+
+struct AffineSquareOp {
+  AffineSquareOp(float scale, float shift)
+      : scale(Set(scale)), shift(Set(shift)) {}
+  Vec operator()(Vec x) const {
+    const Vec b = MulAdd(x, scale, shift);
+    return Mul(b, b);
+  }
+  Vec scale;
+  Vec shift;
+};
+
+struct AffineSqrtOp {
+  AffineSqrtOp(float scale, float shift)
+      : scale(Set(scale)), shift(Set(shift)) {}
+  Vec operator()(Vec x) const { return Sqrt(MulAdd(x, scale, shift)); }
+  Vec scale;
+  Vec shift;
+};
+
+void Relu(const int n, const float* x, const float negative_slope,
+    float* y) {
+  Map1(n, x, y, ReluOp(negative_slope));
+}
+
+void ReluBackward(const int n, const float* x, const float* dy,
+    const float negative_slope, float* dx) {
+  Map2(n, x, dy, dx, ReluBackwardOp(negative_slope));
+}
+
+void Sigmoid(const int n, const float* x, float* y) {
+  Map1(n, x, y, SigmoidOp());
+}
+
+void SigmoidBackward(const int n, const float* y, const float* dy,
+    float* dx) {
+  Map2(n, y, dy, dx, SigmoidBackwardOp());
+}
+
+void TanH(const int n, const float* x, float* y) {
+  Map1(n, x, y, TanHOp());
+}
+
+void TanHBackward(const int n, const float* y, const float* dy, float* dx) {
+  Map2(n, y, dy, dx, TanHBackwardOp());
+}
+
+void Elu(const int n, const float* x, const float alpha, float* y) {
+  Map1(n, x, y, EluOp(alpha));
+}
+
+void EluBackward(const int n, const float* x, const float* y,
+    const float* dy, const float alpha, float* dx) {
+  Map3(n, x, y, dy, dx, EluBackwardOp(alpha));
+}
+
+void Bnll(const int n, const float* x, float* y) {
+  Map1(n, x, y, BnllOp());
+}
+
+void BnllBackward(const int n, const float* x, const float* dy, float* dx) {
+  Map2(n, x, dy, dx, BnllBackwardOp());
+}
+
+void Exp(const int n, const float* x, float* y) {
+  Map1(n, x, y, ExpOp());
+}
+
+void Power(const int n, const float* x, const float scale, const float shift,
+    const float power, float* y) {
+  if (power == 2.f) {
+    Map1(n, x, y, AffineSquareOp(scale, shift));
+  } else if (power == 0.5f) {
+    Map1(n, x, y, AffineSqrtOp(scale, shift));
+  } else {
+    Map1(n, x, y, AffineOp(scale, shift));
+    if (power != 1.f) {
+      for (int i = 0; i < n; ++i) {
+        y[i] = std::pow(y[i], power);
+      }
+    }
+  }
+}
@@ -0,0 +1,66 @@
+#ifndef CAFFE_UTIL_ROW_COPY_HPP_
+#define CAFFE_UTIL_ROW_COPY_HPP_
+
+#include <cstring>
+
+namespace caffe {
+
+/**
+ * @brief Copies rows of a fixed width, e.g. embedding rows during a gather.
+ *
+ * A gather copies many short rows, for which a memcpy call costs about as
+ * much as the copy itself. The copy function is picked once per width: the
+ * common embedding widths get a loop whose trip count is a compile-time
+ * constant, which the compiler fully unrolls into vector loads and stores;
+ * any other width falls back to memcpy.
+ */
+template <typename Dtype>
+class RowCopier {
+ public:
+  RowCopier() : copy_(&CopyAny), width_(0) {}
+  explicit RowCopier(int width) : copy_(Select(width)), width_(width) {}
+
+  /// @brief Copies width() values from src to dst; the rows must not overlap.
+  inline void operator()(const Dtype* src, Dtype* dst) const {
+    copy_(src, dst, width_);
+  }
+  inline int width() const { return width_; }
+  /// @brief Whether width has a specialized copy.
+  static bool IsSpecialized(int width) { return Select(width) != &CopyAny; }
+
+ private:
+  typedef void (*CopyFunc)(const Dtype*, Dtype*, int);
+
+  template <int kWidth>
+  static void CopyFixed(const Dtype* __restrict__ src,
+      Dtype* __restrict__ dst, int) {
+    for (int i = 0; i < kWidth; ++i) {
+      dst[i] = src[i];
+    }
+  }
+  static void CopyAny(const Dtype* src, Dtype* dst, int width) {
+    memcpy(dst, src, sizeof(Dtype) * width);
+  }
+  static CopyFunc Select(int width) {
+    switch (width) {
+    case 50: return &CopyFixed<50>;
+    case 64: return &CopyFixed<64>;
+    case 100: return &CopyFixed<100>;
+    case 128: return &CopyFixed<128>;
+    case 200: return &CopyFixed<200>;
+    case 256: return &CopyFixed<256>;
+    case 300: return &CopyFixed<300>;
+    case 512: return &CopyFixed<512>;
+    case 768: return &CopyFixed<768>;
+    case 1024: return &CopyFixed<1024>;
+    default: return &CopyAny;
+    }
+  }
+
+  CopyFunc copy_;
+  int width_;
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_ROW_COPY_HPP_
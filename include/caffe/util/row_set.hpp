@@ -0,0 +1,56 @@
+#ifndef CAFFE_UTIL_ROW_SET_HPP_
+#define CAFFE_UTIL_ROW_SET_HPP_
+
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace caffe {
+
+/**
+ * @brief The rows of a parameter whose gradient may be nonzero, for
+ *        parameters like embedding tables of which a batch touches only a
+ *        few rows.
+ *
+ * Adding a row and clearing the set both cost in the number of rows added,
+ * not in the size of the table. MarkAll() turns the set dense, for code that
+ * has written the whole gradient.
+ */
+class RowSet {
+ public:
+  explicit RowSet(int num_rows) : marked_(num_rows, false), all_(false) {}
+
+  inline void Add(int row) {
+    DCHECK_GE(row, 0);
+    DCHECK_LT(row, marked_.size());
+    if (!marked_[row]) {
+      marked_[row] = true;
+      rows_.push_back(row);
+    }
+  }
+  inline void MarkAll() { all_ = true; }
+  void Clear() {
+    for (int i = 0; i < rows_.size(); ++i) {
+      marked_[rows_[i]] = false;
+    }
+    rows_.clear();
+    all_ = false;
+  }
+
+  /// @brief The rows added since the last Clear(), in the order added.
+  inline const vector<int>& rows() const { return rows_; }
+  /// @brief Whether any row may be nonzero, regardless of rows().
+  inline bool all() const { return all_; }
+  inline int num_rows() const { return marked_.size(); }
+
+ private:
+  vector<bool> marked_;
+  vector<int> rows_;
+  bool all_;
+
+  DISABLE_COPY_AND_ASSIGN(RowSet);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_ROW_SET_HPP_
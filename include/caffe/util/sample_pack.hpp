@@ -0,0 +1,66 @@
+#ifndef CAFFE_UTIL_SAMPLE_PACK_HPP_
+#define CAFFE_UTIL_SAMPLE_PACK_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/mapped_file.hpp"
+
+namespace caffe {
+
+/**
+ * @brief Many small per-sample files concatenated into one container, with
+ *        one label per sample, as written by tools/pack_nlp_data.
+ *
+ * Every sample starts on an alignment boundary so that it can be read
+ * directly, without going through a per-file open.
+ *
+ * Binary layout (native endianness):
+ *   SamplePackHeader
+ *   int32  labels[num_samples]   (padded to a multiple of 8 bytes)
+ *   uint64 offsets[num_samples]  (from data_offset, multiples of alignment)
+ *   uint64 sizes[num_samples]    (bytes of each sample)
+ *   padding up to data_offset, then the samples
+ */
+struct SamplePackHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t alignment;
+  uint64_t num_samples;
+  uint64_t data_offset;
+};
+
+class SamplePack {
+ public:
+  SamplePack() : labels_(NULL), offsets_(NULL), sizes_(NULL), data_(NULL),
+      num_samples_(0) {}
+
+  void Open(const string& filename);
+
+  inline int num_samples() const { return num_samples_; }
+  inline int label(int i) const { return labels_[i]; }
+  inline const char* data(int i) const { return data_ + offsets_[i]; }
+  inline size_t size(int i) const { return sizes_[i]; }
+  inline const MappedFile& file() const { return file_; }
+
+  /// @brief Packs the given files, in order, with their labels.
+  static void Write(const string& filename, const vector<int>& labels,
+      const vector<string>& files, int alignment = 4096);
+
+ private:
+  const int32_t* labels_;
+  const uint64_t* offsets_;
+  const uint64_t* sizes_;
+  const char* data_;
+  int num_samples_;
+  MappedFile file_;
+
+  DISABLE_COPY_AND_ASSIGN(SamplePack);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_SAMPLE_PACK_HPP_
@@ -0,0 +1,65 @@
+#ifndef CAFFE_UTIL_SAMPLE_PERMUTATION_HPP_
+#define CAFFE_UTIL_SAMPLE_PERMUTATION_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace boost { class thread; }
+
+namespace caffe {
+
+/**
+ * @brief The order in which a data layer visits its samples, epoch after
+ *        epoch.
+ *
+ * Samples stay where they are stored; only this array of indices is
+ * shuffled. With shuffling on, the permutation of the next epoch is
+ * computed in a background thread while the current one is consumed, so
+ * moving to a new epoch in Next() is a swap rather than a full shuffle.
+ *
+ * With world_size > 1, each of world_size processes visits its shard of the
+ * samples, those congruent to its rank (numbered from 0 within the shard as
+ * TextCorpus does). The shards are fixed, so together they visit every
+ * sample once per epoch whatever the seeds; each process shuffles its own
+ * shard every epoch, drawing the order from seed, the epoch and its rank
+ * alone, so that a run of processes given one seed can be reproduced.
+ */
+class SamplePermutation {
+ public:
+  /// @param size the number of samples of all the shards together
+  SamplePermutation(int size, bool shuffle, unsigned int seed, int rank = 0,
+      int world_size = 1);
+  ~SamplePermutation();
+
+  /// @brief Returns the next sample index, wrapping to a new epoch.
+  uint32_t Next();
+
+  inline int size() const { return current_.size(); }
+  inline int epoch() const { return epoch_; }
+
+ protected:
+  void ShuffleNext();
+  // Shuffles the shard for epoch.
+  void PermuteShard(int epoch, vector<uint32_t>* order) const;
+  void StartNext();
+  void Join();
+
+  vector<uint32_t> current_;
+  vector<uint32_t> next_;
+  int position_;
+  int epoch_;
+  const bool shuffle_;
+  const int total_, rank_, world_size_;
+  const unsigned int seed_;
+  shared_ptr<Caffe::RNG> rng_;
+  shared_ptr<boost::thread> thread_;
+
+  DISABLE_COPY_AND_ASSIGN(SamplePermutation);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_SAMPLE_PERMUTATION_HPP_
@@ -0,0 +1,88 @@
+#ifndef CAFFE_UTIL_SHUFFLE_BUFFER_HPP_
+#define CAFFE_UTIL_SHUFFLE_BUFFER_HPP_
+
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/rng.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A sequential source of samples, e.g. a list of shards read one
+ *        after the other. Read() wraps around at the end of the data.
+ */
+template <typename Sample>
+class SampleReader {
+ public:
+  virtual ~SampleReader() {}
+  virtual void Read(Sample* sample) = 0;
+};
+
+/**
+ * @brief Shuffles a sequential stream of samples through a bounded buffer.
+ *
+ * The buffer holds up to capacity samples read ahead from the reader. Each
+ * Next() takes one of them uniformly at random and replaces it with the
+ * next sample read, so memory use depends on the capacity only, not on the
+ * size of the data. A capacity of 1 keeps the order of the reader.
+ *
+ * Samples are handed out as slot ids which stay valid until Release(), so
+ * that a batch can be held while its items are assembled.
+ */
+template <typename Sample>
+class ShuffleBuffer {
+ public:
+  // Takes ownership of reader.
+  ShuffleBuffer(SampleReader<Sample>* reader, int capacity, unsigned int seed)
+      : reader_(reader), capacity_(capacity), rng_(new Caffe::RNG(seed)) {
+    CHECK_GT(capacity_, 0);
+    buffer_.reserve(capacity_);
+  }
+
+  int Next() {
+    while (buffer_.size() < static_cast<size_t>(capacity_)) {
+      buffer_.push_back(ReadSlot());
+    }
+    caffe::rng_t* rng = static_cast<caffe::rng_t*>(rng_->generator());
+    const int i = (*rng)() % capacity_;
+    const int id = buffer_[i];
+    buffer_[i] = ReadSlot();
+    return id;
+  }
+
+  void Release(int id) {
+    DCHECK_LT(id, slots_.size());
+    free_.push_back(id);
+  }
+
+  inline const Sample& sample(int id) const { return *slots_[id]; }
+
+ protected:
+  int ReadSlot() {
+    int id;
+    if (free_.empty()) {
+      id = slots_.size();
+      slots_.push_back(shared_ptr<Sample>(new Sample()));
+    } else {
+      id = free_.back();
+      free_.pop_back();
+    }
+    reader_->Read(slots_[id].get());
+    return id;
+  }
+
+  shared_ptr<SampleReader<Sample> > reader_;
+  const int capacity_;
+  shared_ptr<Caffe::RNG> rng_;
+  // Samples are recycled through free_ so that their storage is reused.
+  vector<shared_ptr<Sample> > slots_;
+  vector<int> free_;
+  vector<int> buffer_;
+
+  DISABLE_COPY_AND_ASSIGN(ShuffleBuffer);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_SHUFFLE_BUFFER_HPP_
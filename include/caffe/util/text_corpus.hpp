@@ -0,0 +1,142 @@
+#ifndef CAFFE_UTIL_TEXT_CORPUS_HPP_
+#define CAFFE_UTIL_TEXT_CORPUS_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/mapped_file.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A pre-tokenized text corpus: one label and one span of int32 word
+ *        indices per sample.
+ *
+ * The corpus is either memory-mapped from the binary format written by
+ * tools/convert_text_corpus, in which case token spans point straight into
+ * the mapping, or parsed once from the label/content text files used by
+ * TextDataLayer and DictIndexDataLayer.
+ *
+ * Binary layout (native endianness):
+ *   TextCorpusHeader
+ *   int32  labels[num_samples]       (padded to a multiple of 8 bytes)
+ *   uint64 offsets[num_samples + 1]  (token offsets of each sample)
+ *   int32  tokens[num_tokens]
+ */
+struct TextCorpusHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t num_samples;
+  uint64_t num_tokens;
+};
+
+/// @brief Appends the space-separated word indices of a content line.
+void ParseTextTokens(const string& line, vector<int32_t>* tokens);
+
+class TextCorpus {
+ public:
+  TextCorpus() : labels_(NULL), offsets_(NULL), tokens_(NULL),
+      num_samples_(0), total_samples_(0), num_tokens_(0), first_(0),
+      stride_(1) {}
+
+  /**
+   * @brief Maps a binary corpus written by Save().
+   *
+   * With world_size > 1 only the shard of the given rank is visible: the
+   * samples rank, rank + world_size, rank + 2 * world_size, ... of the file,
+   * renumbered from 0. The same holds for LoadText().
+   */
+  void Open(const string& filename, int rank = 0, int world_size = 1);
+  /**
+   * @brief Parses the text format: label_source starts with the number of
+   *        samples followed by one label per sample, data_source holds one
+   *        line of space-separated word indices per sample.
+   *
+   * Only the lines of the shard of rank are tokenized and kept.
+   */
+  void LoadText(const string& label_source, const string& data_source,
+      int rank = 0, int world_size = 1);
+  void Save(const string& filename) const;
+  /**
+   * @brief Replaces every word index w by new_index[w]. The tokens of a
+   *        mapped corpus are copied first; the file is left untouched.
+   */
+  void RemapTokens(const vector<int32_t>& new_index);
+
+  /// @brief The number of samples of the shard.
+  inline int num_samples() const { return num_samples_; }
+  /// @brief The number of samples of all the shards together.
+  inline int total_samples() const { return total_samples_; }
+  /// @brief The number of tokens stored, the whole file's when mapped.
+  inline uint64_t num_tokens() const { return num_tokens_; }
+  inline int label(int i) const { return labels_[stored(i)]; }
+  inline const int32_t* tokens(int i) const {
+    return tokens_ + offsets_[stored(i)];
+  }
+  inline int length(int i) const {
+    const int j = stored(i);
+    return static_cast<int>(offsets_[j + 1] - offsets_[j]);
+  }
+  inline bool mapped() const { return file_.data() != NULL; }
+
+  static bool IsBinary(const string& filename);
+
+ private:
+  // Index in the stored arrays of sample i of the shard. A parsed shard
+  // stores only its own samples, a mapped one the whole file.
+  inline int stored(int i) const { return first_ + i * stride_; }
+
+  const int32_t* labels_;
+  const uint64_t* offsets_;
+  const int32_t* tokens_;
+  int num_samples_;
+  int total_samples_;
+  uint64_t num_tokens_;
+  int first_, stride_;
+
+  // Backing storage: either the mapping or the parsed text.
+  MappedFile file_;
+  vector<int32_t> own_labels_;
+  vector<uint64_t> own_offsets_;
+  vector<int32_t> own_tokens_;
+
+  DISABLE_COPY_AND_ASSIGN(TextCorpus);
+};
+
+/**
+ * @brief Untokenized text samples: the label file of TextCorpus::LoadText
+ *        and a mapped data file holding one line of UTF-8 text per sample.
+ *
+ * Only the line boundaries of the shard of rank are indexed; the text is
+ * tokenized by whoever reads it, e.g. with VocabHash::Tokenize().
+ */
+class RawTextCorpus {
+ public:
+  RawTextCorpus() : total_samples_(0) {}
+
+  void Open(const string& label_source, const string& data_source,
+      int rank = 0, int world_size = 1);
+
+  inline int num_samples() const { return labels_.size(); }
+  inline int total_samples() const { return total_samples_; }
+  inline int label(int i) const { return labels_[i]; }
+  inline const char* text(int i) const { return file_.data() + begins_[i]; }
+  inline size_t text_length(int i) const { return lengths_[i]; }
+
+ private:
+  MappedFile file_;
+  vector<int32_t> labels_;
+  vector<uint64_t> begins_;
+  vector<uint32_t> lengths_;
+  int total_samples_;
+
+  DISABLE_COPY_AND_ASSIGN(RawTextCorpus);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_TEXT_CORPUS_HPP_
@@ -0,0 +1,60 @@
+#ifndef CAFFE_UTIL_TEXT_STREAM_HPP_
+#define CAFFE_UTIL_TEXT_STREAM_HPP_
+
+#include <stdint.h>
+
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/shuffle_buffer.hpp"
+#include "caffe/util/text_corpus.hpp"
+
+namespace caffe {
+
+struct TextSample {
+  int label;
+  vector<int32_t> tokens;
+};
+
+/**
+ * @brief Reads text samples shard by shard, without loading a corpus.
+ *
+ * The shard list has one shard per line: either the path of a binary corpus
+ * written by tools/convert_text_corpus, or a "LABEL_FILE DATA_FILE" pair in
+ * the text format of TextCorpus::LoadText. Text shards are parsed line by
+ * line and binary ones are mapped one at a time, so only the current shard
+ * is open. After the last shard the reader starts over from the first.
+ *
+ * With world_size > 1 the reader of rank reads only the shards rank,
+ * rank + world_size, ... of the list, so that world_size processes split
+ * the shards between them.
+ */
+class TextShardReader : public SampleReader<TextSample> {
+ public:
+  explicit TextShardReader(const string& shard_list, int rank = 0,
+      int world_size = 1);
+
+  virtual void Read(TextSample* sample);
+
+  inline int num_shards() const { return shards_.size(); }
+
+ protected:
+  void OpenShard(int shard);
+
+  // The label and data files of each shard; data is empty for binary ones.
+  vector<std::pair<string, string> > shards_;
+  int shard_;
+  // Samples left in the current shard.
+  int remaining_;
+  shared_ptr<TextCorpus> corpus_;
+  std::ifstream label_file_, data_file_;
+  string line_;
+
+  DISABLE_COPY_AND_ASSIGN(TextShardReader);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_TEXT_STREAM_HPP_
@@ -0,0 +1,52 @@
+#ifndef CAFFE_UTIL_THREAD_POOL_HPP_
+#define CAFFE_UTIL_THREAD_POOL_HPP_
+
+#include <boost/function.hpp>
+#include <vector>
+
+#include "caffe/common.hpp"
+
+namespace boost { class thread; }
+
+namespace caffe {
+
+/**
+ * @brief A fixed set of worker threads that run one task at a time.
+ *
+ * Run() executes task(worker_id) once on every worker, with the calling
+ * thread acting as worker 0, and returns when all of them are done. Tasks
+ * split their work by worker_id, e.g. worker w takes items w, w + n, ...,
+ * so that the assignment of work to workers is deterministic.
+ */
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  void Run(const boost::function<void(int)>& task);
+
+  inline int num_threads() const { return num_threads_; }
+
+ protected:
+  /**
+   Move synchronization fields out instead of including boost/thread.hpp
+   to avoid a boost/NVCC issues (#1009, #1010) on OSX.
+   */
+  class sync;
+
+  void entry(int worker_id);
+
+  const int num_threads_;
+  vector<shared_ptr<boost::thread> > threads_;
+  shared_ptr<sync> sync_;
+  boost::function<void(int)> task_;
+  size_t generation_;
+  int pending_;
+  bool stop_;
+
+DISABLE_COPY_AND_ASSIGN(ThreadPool);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_THREAD_POOL_HPP_
@@ -0,0 +1,76 @@
+#ifndef CAFFE_UTIL_VOCAB_HASH_HPP_
+#define CAFFE_UTIL_VOCAB_HASH_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/mapped_file.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A vocabulary compiled into an open-addressing hash table, mapped
+ *        from the file written by tools/compile_vocabulary.
+ *
+ * Looking a word up hashes its bytes, then probes linearly from the slot the
+ * hash picks; slots keep 32 bits of the hash, so that only a matching slot
+ * costs a string comparison. The table is at most half full.
+ *
+ * Binary layout (native endianness):
+ *   VocabHashHeader
+ *   VocabHashSlot slots[num_slots]  (num_slots is a power of two)
+ *   char          words[word_bytes] (the words, not terminated)
+ */
+struct VocabHashHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t num_words;
+  uint64_t num_slots;
+  uint64_t word_bytes;
+};
+
+struct VocabHashSlot {
+  uint32_t hash;
+  int32_t id;  // -1 for an empty slot
+  uint32_t offset;
+  uint32_t length;
+};
+
+class VocabHash {
+ public:
+  VocabHash() : slots_(NULL), words_(NULL), num_words_(0), mask_(0) {}
+
+  /// @brief Maps filename, checking every slot so that a corrupt file fails
+  ///        here rather than in Find().
+  void Open(const string& filename);
+  /// @brief Writes words as a table mapping words[i] to i.
+  static void Write(const string& filename, const vector<string>& words);
+
+  /// @brief The id of the word, or -1 if it is not in the vocabulary.
+  int32_t Find(const char* word, size_t length) const;
+  /**
+   * @brief Appends the ids of the whitespace-separated words of a UTF-8
+   *        text. A word not in the vocabulary becomes unknown_id, or is
+   *        dropped if unknown_id is negative.
+   */
+  void Tokenize(const char* text, size_t length, int32_t unknown_id,
+      vector<int32_t>* ids) const;
+
+  inline int num_words() const { return num_words_; }
+
+ private:
+  MappedFile file_;
+  const VocabHashSlot* slots_;
+  const char* words_;
+  int num_words_;
+  uint64_t mask_;
+
+  DISABLE_COPY_AND_ASSIGN(VocabHash);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_VOCAB_HASH_HPP_
@@ -0,0 +1,54 @@
+#ifndef CAFFE_UTIL_VOCAB_REMAP_HPP_
+#define CAFFE_UTIL_VOCAB_REMAP_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "caffe/common.hpp"
+#include "caffe/util/text_corpus.hpp"
+
+namespace caffe {
+
+/**
+ * @brief A renumbering of the vocabulary: the new index of every word.
+ *
+ * tools/remap_vocabulary numbers the words by decreasing corpus frequency,
+ * so that the rows of the frequent words sit together at the start of the
+ * embedding table, and rewrites the corpus and the dict to match. Data
+ * layers reading samples that were not rewritten, e.g. text files or
+ * shards, apply the remap to every token with vocab_remap.
+ *
+ * The file holds one line per word, the new index of word i on line i.
+ */
+class VocabRemap {
+ public:
+  VocabRemap() {}
+
+  void Load(const string& filename);
+  void Save(const string& filename) const;
+  /**
+   * @brief Numbers the num_words words by decreasing number of occurrences
+   *        in corpus; words occurring equally often keep their order.
+   */
+  void ByFrequency(const TextCorpus& corpus, int num_words);
+
+  inline bool empty() const { return new_index_.empty(); }
+  inline int num_words() const { return new_index_.size(); }
+  inline int32_t operator()(int32_t word) const {
+    DCHECK_GE(word, 0);
+    DCHECK_LT(word, new_index_.size());
+    return new_index_[word];
+  }
+  inline const vector<int32_t>& new_index() const { return new_index_; }
+
+ private:
+  vector<int32_t> new_index_;
+
+  DISABLE_COPY_AND_ASSIGN(VocabRemap);
+};
+
+}  // namespace caffe
+
+#endif  // CAFFE_UTIL_VOCAB_REMAP_HPP_
@@ -40,6 +40,9 @@ void Blob<Dtype>::Reshape(const vector<int>& shape) {
     data_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
     diff_.reset(new SyncedMemory(capacity_ * sizeof(Dtype)));
   }
+  if (diff_rows_ && (shape_.empty() || diff_rows_->num_rows() != shape_[0])) {
+    set_sparse_diff(true);
+  }
 }
 
 template <typename Dtype>
@@ -142,6 +145,17 @@ template <typename Dtype>
 void Blob<Dtype>::ShareDiff(const Blob& other) {
   CHECK_EQ(count_, other.count());
   diff_ = other.diff();
+  diff_rows_ = other.diff_rows_;
+}
+
+template <typename Dtype>
+void Blob<Dtype>::set_sparse_diff(bool sparse) {
+  if (sparse) {
+    CHECK_GE(num_axes(), 1) << "A sparse diff needs rows.";
+    diff_rows_.reset(new RowSet(shape_[0]));
+  } else {
+    diff_rows_.reset();
+  }
 }
 
 // The "update" method is used for parameter blobs in a Net, which are stored
@@ -156,9 +170,21 @@ void Blob<Dtype>::Update() {
   switch (data_->head()) {
   case SyncedMemory::HEAD_AT_CPU:
     // perform computation on CPU
-    caffe_axpy<Dtype>(count_, Dtype(-1),
-        static_cast<const Dtype*>(diff_->cpu_data()),
-        static_cast<Dtype*>(data_->mutable_cpu_data()));
+    if (diff_rows_ && !diff_rows_->all()) {
+      // Only the listed rows of the diff can be nonzero.
+      const int dim = count(1);
+      const vector<int>& rows = diff_rows_->rows();
+      const Dtype* diff = static_cast<const Dtype*>(diff_->cpu_data());
+      Dtype* data = static_cast<Dtype*>(data_->mutable_cpu_data());
+      for (int i = 0; i < rows.size(); ++i) {
+        caffe_axpy<Dtype>(dim, Dtype(-1), diff + rows[i] * dim,
+            data + rows[i] * dim);
+      }
+    } else {
+      caffe_axpy<Dtype>(count_, Dtype(-1),
+          static_cast<const Dtype*>(diff_->cpu_data()),
+          static_cast<Dtype*>(data_->mutable_cpu_data()));
+    }
     break;
   case SyncedMemory::HEAD_AT_GPU:
   case SyncedMemory::SYNCED:
@@ -180,6 +180,15 @@ void BaseConvolutionLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
   weight_offset_ = conv_out_channels_ * kernel_dim_ / group_;
   // Propagate gradients to the parameters (as directed by backward pass).
   this->param_propagate_down_.resize(this->blobs_.size(), true);
+  const int num_workers = conv_param.num_workers();
+  CHECK_GT(num_workers, 0);
+  if (num_workers > 1) {
+    workers_.reset(new ThreadPool(num_workers));
+  }
+  worker_col_buffers_.resize(num_workers - 1);
+  for (int i = 0; i < worker_col_buffers_.size(); ++i) {
+    worker_col_buffers_[i].reset(new Blob<Dtype>());
+  }
 }
 
 template <typename Dtype>
@@ -226,9 +235,18 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
       conv_input_shape_data[i] = bottom[0]->shape(channel_axis_ + i);
     }
   }
+  is_full_width_ = false;
+  if (!reverse_dimensions() && !is_1x1_ && num_spatial_axes_ == 2) {
+    const int* kernel_shape_data = kernel_shape_.cpu_data();
+    const int* pad_data = pad_.cpu_data();
+    const int* dilation_data = dilation_.cpu_data();
+    is_full_width_ = kernel_shape_data[1] == conv_input_shape_data[2]
+        && stride_.cpu_data()[0] == 1 && pad_data[0] == 0 && pad_data[1] == 0
+        && dilation_data[0] == 1 && dilation_data[1] == 1;
+  }
   // The im2col result buffer will only hold one image at a time to avoid
-  // overly large memory usage. In the special case of 1x1 convolution
-  // it goes lazily unused to save memory.
+  // overly large memory usage. In the special cases of 1x1 and full-width
+  // convolution it goes lazily unused by the CPU passes to save memory.
   col_buffer_shape_.clear();
   col_buffer_shape_.push_back(kernel_dim_ * group_);
   for (int i = 0; i < num_spatial_axes_; ++i) {
@@ -239,6 +257,9 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
     }
   }
   col_buffer_.Reshape(col_buffer_shape_);
+  for (int i = 0; i < worker_col_buffers_.size(); ++i) {
+    worker_col_buffers_[i]->Reshape(col_buffer_shape_);
+  }
   bottom_dim_ = bottom[0]->count(channel_axis_);
   top_dim_ = top[0]->count(channel_axis_);
   num_kernels_im2col_ = conv_in_channels_ * conv_out_spatial_dim_;
@@ -251,17 +272,44 @@ void BaseConvolutionLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
     caffe_set(bias_multiplier_.count(), Dtype(1),
         bias_multiplier_.mutable_cpu_data());
   }
+  // The batch_gemm chunks take as many images as their buffers fit in the
+  // memory cap, and at least one.
+  const ConvolutionParameter& conv_param =
+      this->layer_param_.convolution_param();
+  batch_gemm_images_ = 0;
+  if (conv_param.batch_gemm() && !reverse_dimensions() && !is_full_width_) {
+    const uint64_t image_bytes = sizeof(Dtype) * conv_out_spatial_dim_
+        * uint64_t(kernel_dim_ * group_ + conv_out_channels_);
+    batch_gemm_images_ = std::max<uint64_t>(1, std::min<uint64_t>(num_,
+        conv_param.batch_gemm_max_bytes() / image_bytes));
+    const int batch_cols = batch_gemm_images_ * conv_out_spatial_dim_;
+    vector<int> batch_shape(2, batch_cols);
+    batch_shape[0] = kernel_dim_ * group_;
+    batch_col_buffer_.Reshape(batch_shape);
+    batch_shape[0] = conv_out_channels_;
+    batch_output_buffer_.Reshape(batch_shape);
+    if (bias_term_) {
+      batch_bias_multiplier_.Reshape(vector<int>(1, batch_cols));
+      caffe_set(batch_bias_multiplier_.count(), Dtype(1),
+          batch_bias_multiplier_.mutable_cpu_data());
+    }
+  }
 }
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::forward_cpu_gemm(const Dtype* input,
-    const Dtype* weights, Dtype* output, bool skip_im2col) {
+    const Dtype* weights, Dtype* output, bool skip_im2col, int worker_id) {
+  if (is_full_width_) {
+    full_width_forward(input, weights, output);
+    return;
+  }
   const Dtype* col_buff = input;
   if (!is_1x1_) {
+    Blob<Dtype>* buffer = col_buffer(worker_id);
     if (!skip_im2col) {
-      conv_im2col_cpu(input, col_buffer_.mutable_cpu_data());
+      conv_im2col_cpu(input, buffer->mutable_cpu_data());
     }
-    col_buff = col_buffer_.cpu_data();
+    col_buff = buffer->cpu_data();
   }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, conv_out_channels_ /
@@ -281,10 +329,14 @@ void BaseConvolutionLayer<Dtype>::forward_cpu_bias(Dtype* output,
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::backward_cpu_gemm(const Dtype* output,
-    const Dtype* weights, Dtype* input) {
-  Dtype* col_buff = col_buffer_.mutable_cpu_data();
-  if (is_1x1_) {
-    col_buff = input;
+    const Dtype* weights, Dtype* input, int worker_id) {
+  if (is_full_width_) {
+    full_width_backward(output, weights, input);
+    return;
+  }
+  Dtype* col_buff = input;
+  if (!is_1x1_) {
+    col_buff = col_buffer(worker_id)->mutable_cpu_data();
   }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasTrans, CblasNoTrans, kernel_dim_,
@@ -299,11 +351,16 @@ void BaseConvolutionLayer<Dtype>::backward_cpu_gemm(const Dtype* output,
 
 template <typename Dtype>
 void BaseConvolutionLayer<Dtype>::weight_cpu_gemm(const Dtype* input,
-    const Dtype* output, Dtype* weights) {
+    const Dtype* output, Dtype* weights, int worker_id) {
+  if (is_full_width_) {
+    full_width_weight(input, output, weights);
+    return;
+  }
   const Dtype* col_buff = input;
   if (!is_1x1_) {
-    conv_im2col_cpu(input, col_buffer_.mutable_cpu_data());
-    col_buff = col_buffer_.cpu_data();
+    Blob<Dtype>* buffer = col_buffer(worker_id);
+    conv_im2col_cpu(input, buffer->mutable_cpu_data());
+    col_buff = buffer->cpu_data();
   }
   for (int g = 0; g < group_; ++g) {
     caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, conv_out_channels_ / group_,
@@ -320,6 +377,156 @@ void BaseConvolutionLayer<Dtype>::backward_cpu_bias(Dtype* bias,
       input, bias_multiplier_.cpu_data(), 1., bias);
 }
 
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::batch_im2col_cpu(const Dtype* input,
+    int first, int num) {
+  const int spatial = conv_out_spatial_dim_;
+  const int ld = batch_gemm_images_ * spatial;
+  Dtype* batch_col = batch_col_buffer_.mutable_cpu_data();
+  for (int b = 0; b < num; ++b) {
+    const Dtype* image = input + (first + b) * bottom_dim_;
+    if (!is_1x1_) {
+      conv_im2col_cpu(image, batch_col + b * spatial, ld);
+      continue;
+    }
+    for (int k = 0; k < kernel_dim_ * group_; ++k) {
+      caffe_copy(spatial, image + k * spatial,
+          batch_col + k * ld + b * spatial);
+    }
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::forward_cpu_batch(const Dtype* input,
+    const Dtype* weights, const Dtype* bias, Dtype* output) {
+  const int spatial = conv_out_spatial_dim_;
+  const int ld = batch_gemm_images_ * spatial;
+  const int out_channels = conv_out_channels_ / group_;
+  for (int first = 0; first < num_; first += batch_gemm_images_) {
+    const int num = std::min(batch_gemm_images_, num_ - first);
+    batch_im2col_cpu(input, first, num);
+    const Dtype* batch_col = batch_col_buffer_.cpu_data();
+    Dtype* batch_output = batch_output_buffer_.mutable_cpu_data();
+    for (int g = 0; g < group_; ++g) {
+      caffe_cpu_strided_gemm<Dtype>(CblasNoTrans, CblasNoTrans, out_channels,
+          num * spatial, kernel_dim_, (Dtype)1., weights + weight_offset_ * g,
+          kernel_dim_, batch_col + kernel_dim_ * ld * g, ld, (Dtype)0.,
+          batch_output + out_channels * ld * g, ld);
+    }
+    if (bias) {
+      caffe_cpu_strided_gemm<Dtype>(CblasNoTrans, CblasNoTrans, num_output_,
+          num * spatial, 1, (Dtype)1., bias, 1,
+          batch_bias_multiplier_.cpu_data(), ld, (Dtype)1., batch_output, ld);
+    }
+    for (int b = 0; b < num; ++b) {
+      for (int c = 0; c < conv_out_channels_; ++c) {
+        caffe_copy(spatial, batch_output + c * ld + b * spatial,
+            output + (first + b) * top_dim_ + c * spatial);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::weight_cpu_batch(const Dtype* input,
+    const Dtype* output, Dtype* weights) {
+  const int spatial = conv_out_spatial_dim_;
+  const int ld = batch_gemm_images_ * spatial;
+  const int out_channels = conv_out_channels_ / group_;
+  for (int first = 0; first < num_; first += batch_gemm_images_) {
+    const int num = std::min(batch_gemm_images_, num_ - first);
+    batch_im2col_cpu(input, first, num);
+    Dtype* batch_output = batch_output_buffer_.mutable_cpu_data();
+    for (int b = 0; b < num; ++b) {
+      for (int c = 0; c < conv_out_channels_; ++c) {
+        caffe_copy(spatial, output + (first + b) * top_dim_ + c * spatial,
+            batch_output + c * ld + b * spatial);
+      }
+    }
+    const Dtype* batch_col = batch_col_buffer_.cpu_data();
+    for (int g = 0; g < group_; ++g) {
+      caffe_cpu_strided_gemm<Dtype>(CblasNoTrans, CblasTrans, out_channels,
+          kernel_dim_, num * spatial, (Dtype)1.,
+          batch_output + out_channels * ld * g, ld,
+          batch_col + kernel_dim_ * ld * g, ld, (Dtype)1.,
+          weights + weight_offset_ * g, kernel_dim_);
+    }
+  }
+}
+
+// In the is_full_width_ case, output row h of the filters is
+//   sum over channels c and kernel rows i of W_ci * X_c[h + i]^T,
+// where W_ci are the width-wide weights of channel c and kernel row i and
+// X_c[h + i] is input row h + i of channel c. For a fixed (c, i), the input
+// rows h + i of all outputs h are consecutive rows of the input, so each
+// term is a single gemm on the input as it lies in memory.
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::full_width_forward(const Dtype* input,
+    const Dtype* weights, Dtype* output) {
+  const int height = conv_input_shape_.cpu_data()[1];
+  const int width = conv_input_shape_.cpu_data()[2];
+  const int kernel_h = kernel_shape_.cpu_data()[0];
+  const int in_channels = conv_in_channels_ / group_;
+  for (int g = 0; g < group_; ++g) {
+    for (int c = 0; c < in_channels; ++c) {
+      const Dtype* channel = input + (g * in_channels + c) * height * width;
+      for (int i = 0; i < kernel_h; ++i) {
+        caffe_cpu_strided_gemm<Dtype>(CblasNoTrans, CblasTrans,
+            conv_out_channels_ / group_, conv_out_spatial_dim_, width,
+            (Dtype)1.,
+            weights + weight_offset_ * g + (c * kernel_h + i) * width,
+            kernel_dim_, channel + i * width, width,
+            (c == 0 && i == 0) ? (Dtype)0. : (Dtype)1.,
+            output + output_offset_ * g, conv_out_spatial_dim_);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::full_width_backward(const Dtype* output,
+    const Dtype* weights, Dtype* input) {
+  const int height = conv_input_shape_.cpu_data()[1];
+  const int width = conv_input_shape_.cpu_data()[2];
+  const int kernel_h = kernel_shape_.cpu_data()[0];
+  const int in_channels = conv_in_channels_ / group_;
+  caffe_set(conv_in_channels_ * height * width, Dtype(0), input);
+  for (int g = 0; g < group_; ++g) {
+    for (int c = 0; c < in_channels; ++c) {
+      Dtype* channel = input + (g * in_channels + c) * height * width;
+      for (int i = 0; i < kernel_h; ++i) {
+        caffe_cpu_strided_gemm<Dtype>(CblasTrans, CblasNoTrans,
+            conv_out_spatial_dim_, width, conv_out_channels_ / group_,
+            (Dtype)1., output + output_offset_ * g, conv_out_spatial_dim_,
+            weights + weight_offset_ * g + (c * kernel_h + i) * width,
+            kernel_dim_, (Dtype)1., channel + i * width, width);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void BaseConvolutionLayer<Dtype>::full_width_weight(const Dtype* input,
+    const Dtype* output, Dtype* weights) {
+  const int height = conv_input_shape_.cpu_data()[1];
+  const int width = conv_input_shape_.cpu_data()[2];
+  const int kernel_h = kernel_shape_.cpu_data()[0];
+  const int in_channels = conv_in_channels_ / group_;
+  for (int g = 0; g < group_; ++g) {
+    for (int c = 0; c < in_channels; ++c) {
+      const Dtype* channel = input + (g * in_channels + c) * height * width;
+      for (int i = 0; i < kernel_h; ++i) {
+        caffe_cpu_strided_gemm<Dtype>(CblasNoTrans, CblasNoTrans,
+            conv_out_channels_ / group_, width, conv_out_spatial_dim_,
+            (Dtype)1., output + output_offset_ * g, conv_out_spatial_dim_,
+            channel + i * width, width, (Dtype)1.,
+            weights + weight_offset_ * g + (c * kernel_h + i) * width,
+            kernel_dim_);
+      }
+    }
+  }
+}
+
 #ifndef CPU_ONLY
 
 template <typename Dtype>
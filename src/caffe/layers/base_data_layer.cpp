@@ -1,4 +1,5 @@
 #include <boost/thread.hpp>
+#include <algorithm>
 #include <vector>
 
 #include "caffe/blob.hpp"
@@ -7,10 +8,14 @@
 #include "caffe/layer.hpp"
 #include "caffe/layers/base_data_layer.hpp"
 #include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
 #include "caffe/util/blocking_queue.hpp"
 
 namespace caffe {
 
+// Number of the last load_batch latencies kept for the percentiles.
+static const int kLoadLatencyWindow = 1000;
+
 template <typename Dtype>
 BaseDataLayer<Dtype>::BaseDataLayer(const LayerParameter& param)
     : Layer<Dtype>(param),
@@ -36,10 +41,18 @@ template <typename Dtype>
 BasePrefetchingDataLayer<Dtype>::BasePrefetchingDataLayer(
     const LayerParameter& param)
     : BaseDataLayer<Dtype>(param),
-      prefetch_free_(), prefetch_full_() {
-  for (int i = 0; i < PREFETCH_COUNT; ++i) {
-    prefetch_free_.push(&prefetch_[i]);
+      prefetch_(param.data_param().prefetch_batches() + 1),
+      prefetch_free_(), prefetch_full_(), prefetch_current_(NULL),
+      stats_mutex_(new boost::mutex()) {
+  CHECK_GT(param.data_param().prefetch_batches(), 0)
+      << "prefetch_batches should be positive";
+  for (int i = 0; i < prefetch_.size(); ++i) {
+    prefetch_[i].reset(new Batch<Dtype>());
+    prefetch_free_.push(prefetch_[i].get());
   }
+  max_prefetch_ = std::max<int>(prefetch_.size(),
+      param.data_param().max_prefetch() + 1);
+  ResetPrefetchStats();
 }
 
 template <typename Dtype>
@@ -50,18 +63,18 @@ void BasePrefetchingDataLayer<Dtype>::LayerSetUp(
   // calls so that the prefetch thread does not accidentally make simultaneous
   // cudaMalloc calls when the main thread is running. In some GPUs this
   // seems to cause failures if we do not so.
-  for (int i = 0; i < PREFETCH_COUNT; ++i) {
-    prefetch_[i].data_.mutable_cpu_data();
+  for (int i = 0; i < prefetch_.size(); ++i) {
+    prefetch_[i]->data_.mutable_cpu_data();
     if (this->output_labels_) {
-      prefetch_[i].label_.mutable_cpu_data();
+      prefetch_[i]->label_.mutable_cpu_data();
     }
   }
 #ifndef CPU_ONLY
   if (Caffe::mode() == Caffe::GPU) {
-    for (int i = 0; i < PREFETCH_COUNT; ++i) {
-      prefetch_[i].data_.mutable_gpu_data();
+    for (int i = 0; i < prefetch_.size(); ++i) {
+      prefetch_[i]->data_.mutable_gpu_data();
       if (this->output_labels_) {
-        prefetch_[i].label_.mutable_gpu_data();
+        prefetch_[i]->label_.mutable_gpu_data();
       }
     }
   }
@@ -81,10 +94,23 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
   }
 #endif
 
+  CPUTimer timer;
   try {
     while (!must_stop()) {
       Batch<Dtype>* batch = prefetch_free_.pop();
+      timer.Start();
       load_batch(batch);
+      const float load_ms = timer.MicroSeconds() / 1000;
+      {
+        boost::mutex::scoped_lock lock(*stats_mutex_);
+        if (load_ms_.size() < kLoadLatencyWindow) {
+          load_ms_.push_back(load_ms);
+        } else {
+          load_ms_[load_ms_next_] = load_ms;
+        }
+        load_ms_next_ = (load_ms_next_ + 1) % kLoadLatencyWindow;
+        ++loads_;
+      }
 #ifndef CPU_ONLY
       if (Caffe::mode() == Caffe::GPU) {
         batch->data_.data().get()->async_gpu_push(stream);
@@ -104,24 +130,120 @@ void BasePrefetchingDataLayer<Dtype>::InternalThreadEntry() {
 }
 
 template <typename Dtype>
-void BasePrefetchingDataLayer<Dtype>::Forward_cpu(
-    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
-  Batch<Dtype>* batch = prefetch_full_.pop("Data layer prefetch queue empty");
-  // Reshape to loaded data.
-  top[0]->ReshapeLike(batch->data_);
-  // Copy the data
-  caffe_copy(batch->data_.count(), batch->data_.cpu_data(),
-             top[0]->mutable_cpu_data());
-  DLOG(INFO) << "Prefetch copied";
+void BasePrefetchingDataLayer<Dtype>::TakeNextBatch(
+    const vector<Blob<Dtype>*>& top) {
+  // The net is done with the batch of the previous Forward.
+  const bool first = !prefetch_current_;
+  if (prefetch_current_) {
+    prefetch_free_.push(prefetch_current_);
+  }
+  const size_t ready = prefetch_full_.size();
+  const bool starved = !prefetch_full_.try_pop(&prefetch_current_);
+  {
+    boost::mutex::scoped_lock lock(*stats_mutex_);
+    ++forwards_;
+    ready_sum_ += ready;
+    starved_ += starved;
+  }
+  if (starved) {
+    CPUTimer timer;
+    timer.Start();
+    prefetch_current_ = prefetch_full_.pop("Data layer prefetch queue empty");
+    const double wait_ms = timer.MicroSeconds() / 1000;
+    {
+      boost::mutex::scoped_lock lock(*stats_mutex_);
+      wait_ms_ += wait_ms;
+    }
+    // The first batch is always waited for, the thread has just started.
+    if (!first && prefetch_.size() < max_prefetch_) {
+      AddBatch();
+    }
+  }
+  // Reshape to loaded data and share it. Reshaping only allocates lazily,
+  // so the tops' own memory is never touched.
+  top[0]->ReshapeLike(prefetch_current_->data_);
+  top[0]->ShareData(prefetch_current_->data_);
   if (this->output_labels_) {
-    // Reshape to loaded labels.
-    top[1]->ReshapeLike(batch->label_);
-    // Copy the labels.
-    caffe_copy(batch->label_.count(), batch->label_.cpu_data(),
-        top[1]->mutable_cpu_data());
+    top[1]->ReshapeLike(prefetch_current_->label_);
+    top[1]->ShareData(prefetch_current_->label_);
+  }
+  if (top.size() > 2) {
+    top[2]->ReshapeLike(prefetch_current_->length_);
+    top[2]->ShareData(prefetch_current_->length_);
+  }
+}
+
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::AddBatch() {
+  shared_ptr<Batch<Dtype> > batch(new Batch<Dtype>());
+  batch->data_.ReshapeLike(prefetch_current_->data_);
+  batch->label_.ReshapeLike(prefetch_current_->label_);
+  batch->length_.ReshapeLike(prefetch_current_->length_);
+  // Allocated here for the same reason as in LayerSetUp.
+  batch->data_.mutable_cpu_data();
+  if (this->output_labels_) {
+    batch->label_.mutable_cpu_data();
+  }
+#ifndef CPU_ONLY
+  if (Caffe::mode() == Caffe::GPU) {
+    batch->data_.mutable_gpu_data();
+    if (this->output_labels_) {
+      batch->label_.mutable_gpu_data();
+    }
+  }
+#endif
+  {
+    // prefetch_stats() reads the depth.
+    boost::mutex::scoped_lock lock(*stats_mutex_);
+    prefetch_.push_back(batch);
   }
+  prefetch_free_.push(batch.get());
+  LOG(INFO) << this->layer_param_.name() << " waited for data, prefetching "
+      << prefetch_.size() - 1 << " batches ahead";
+}
 
-  prefetch_free_.push(batch);
+template <typename Dtype>
+PrefetchStats BasePrefetchingDataLayer<Dtype>::prefetch_stats() const {
+  PrefetchStats stats;
+  vector<float> load_ms;
+  {
+    boost::mutex::scoped_lock lock(*stats_mutex_);
+    stats.forwards = forwards_;
+    stats.starved = starved_;
+    stats.wait_ms = wait_ms_;
+    stats.mean_ready = forwards_ ? float(ready_sum_) / forwards_ : 0;
+    stats.depth = prefetch_.size() - 1;
+    stats.loads = loads_;
+    load_ms = load_ms_;
+  }
+  stats.load_ms_p50 = stats.load_ms_p90 = stats.load_ms_p99 = 0;
+  if (!load_ms.empty()) {
+    std::sort(load_ms.begin(), load_ms.end());
+    const int last = load_ms.size() - 1;
+    stats.load_ms_p50 = load_ms[last * 50 / 100];
+    stats.load_ms_p90 = load_ms[last * 90 / 100];
+    stats.load_ms_p99 = load_ms[last * 99 / 100];
+  }
+  return stats;
+}
+
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::ResetPrefetchStats() {
+  boost::mutex::scoped_lock lock(*stats_mutex_);
+  forwards_ = 0;
+  starved_ = 0;
+  wait_ms_ = 0;
+  ready_sum_ = 0;
+  loads_ = 0;
+  load_ms_.clear();
+  load_ms_next_ = 0;
+}
+
+template <typename Dtype>
+void BasePrefetchingDataLayer<Dtype>::Forward_cpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  TakeNextBatch(top);
+  DLOG(INFO) << "Prefetch shared";
 }
 
 #ifdef CPU_ONLY
@@ -1,6 +1,9 @@
+#include <boost/bind.hpp>
+#include <algorithm>
 #include <vector>
 
 #include "caffe/layers/conv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
 
 namespace caffe {
 
@@ -25,16 +28,30 @@ template <typename Dtype>
 void ConvolutionLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const Dtype* weight = this->blobs_[0]->cpu_data();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
   for (int i = 0; i < bottom.size(); ++i) {
     const Dtype* bottom_data = bottom[i]->cpu_data();
     Dtype* top_data = top[i]->mutable_cpu_data();
-    for (int n = 0; n < this->num_; ++n) {
-      this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
-          top_data + n * this->top_dim_);
-      if (this->bias_term_) {
-        const Dtype* bias = this->blobs_[1]->cpu_data();
-        this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
-      }
+    if (this->batch_gemm_images_ > 0) {
+      this->forward_cpu_batch(bottom_data, weight, bias, top_data);
+    } else if (this->workers_) {
+      this->workers_->Run(boost::bind(&ConvolutionLayer<Dtype>::forward_images,
+          this, bottom_data, weight, bias, top_data, _1));
+    } else {
+      forward_images(bottom_data, weight, bias, top_data, 0);
+    }
+  }
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::forward_images(const Dtype* bottom_data,
+    const Dtype* weight, const Dtype* bias, Dtype* top_data, int worker_id) {
+  const int num_workers = this->workers_ ? this->workers_->num_threads() : 1;
+  for (int n = worker_id; n < this->num_; n += num_workers) {
+    this->forward_cpu_gemm(bottom_data + n * this->bottom_dim_, weight,
+        top_data + n * this->top_dim_, false, worker_id);
+    if (bias) {
+      this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
     }
   }
 }
@@ -44,6 +61,15 @@ void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {
   const Dtype* weight = this->blobs_[0]->cpu_data();
   Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
+  Dtype* partial_diffs = NULL;
+  if (this->workers_ && this->param_propagate_down_[0]
+      && this->batch_gemm_images_ == 0) {
+    vector<int> shape(2);
+    shape[0] = this->workers_->num_threads() - 1;
+    shape[1] = this->blobs_[0]->count();
+    worker_weight_diff_.Reshape(shape);
+    partial_diffs = worker_weight_diff_.mutable_cpu_data();
+  }
   for (int i = 0; i < top.size(); ++i) {
     const Dtype* top_diff = top[i]->cpu_diff();
     const Dtype* bottom_data = bottom[i]->cpu_data();
@@ -56,22 +82,74 @@ void ConvolutionLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       }
     }
     if (this->param_propagate_down_[0] || propagate_down[i]) {
-      for (int n = 0; n < this->num_; ++n) {
-        // gradient w.r.t. weight. Note that we will accumulate diffs.
-        if (this->param_propagate_down_[0]) {
-          this->weight_cpu_gemm(bottom_data + n * this->bottom_dim_,
-              top_diff + n * this->top_dim_, weight_diff);
-        }
-        // gradient w.r.t. bottom data, if necessary.
-        if (propagate_down[i]) {
-          this->backward_cpu_gemm(top_diff + n * this->top_dim_, weight,
-              bottom_diff + n * this->bottom_dim_);
+      Dtype* image_weight_diff =
+          this->param_propagate_down_[0] ? weight_diff : NULL;
+      Dtype* image_bottom_diff = propagate_down[i] ? bottom_diff : NULL;
+      if (this->batch_gemm_images_ > 0 && image_weight_diff) {
+        this->weight_cpu_batch(bottom_data, top_diff, weight_diff);
+        image_weight_diff = NULL;
+      }
+      if (this->workers_) {
+        this->workers_->Run(boost::bind(
+            &ConvolutionLayer<Dtype>::backward_images, this, top_diff,
+            bottom_data, weight, image_weight_diff, partial_diffs,
+            image_bottom_diff, _1));
+        if (image_weight_diff) {
+          this->workers_->Run(boost::bind(
+              &ConvolutionLayer<Dtype>::reduce_weight_diff, this,
+              partial_diffs, weight_diff, _1));
         }
+      } else {
+        backward_images(top_diff, bottom_data, weight, image_weight_diff,
+            NULL, image_bottom_diff, 0);
       }
     }
   }
 }
 
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::backward_images(const Dtype* top_diff,
+    const Dtype* bottom_data, const Dtype* weight, Dtype* weight_diff,
+    Dtype* partial_diffs, Dtype* bottom_diff, int worker_id) {
+  const int num_workers = this->workers_ ? this->workers_->num_threads() : 1;
+  // Worker 0 accumulates into the weight diff, the others into their own
+  // partial diff, which reduce_weight_diff then adds to it.
+  if (weight_diff && worker_id > 0) {
+    const int count = this->blobs_[0]->count();
+    weight_diff = partial_diffs + (worker_id - 1) * count;
+    caffe_set(count, Dtype(0), weight_diff);
+  }
+  for (int n = worker_id; n < this->num_; n += num_workers) {
+    // gradient w.r.t. weight. Note that we will accumulate diffs.
+    if (weight_diff) {
+      this->weight_cpu_gemm(bottom_data + n * this->bottom_dim_,
+          top_diff + n * this->top_dim_, weight_diff, worker_id);
+    }
+    // gradient w.r.t. bottom data, if necessary.
+    if (bottom_diff) {
+      this->backward_cpu_gemm(top_diff + n * this->top_dim_, weight,
+          bottom_diff + n * this->bottom_dim_, worker_id);
+    }
+  }
+}
+
+template <typename Dtype>
+void ConvolutionLayer<Dtype>::reduce_weight_diff(const Dtype* partial_diffs,
+    Dtype* weight_diff, int worker_id) {
+  const int num_workers = this->workers_->num_threads();
+  const int count = this->blobs_[0]->count();
+  const int slice = (count + num_workers - 1) / num_workers;
+  const int begin = std::min(count, worker_id * slice);
+  const int end = std::min(count, begin + slice);
+  if (begin == end) {
+    return;
+  }
+  for (int w = 1; w < num_workers; ++w) {
+    caffe_axpy(end - begin, Dtype(1),
+        partial_diffs + (w - 1) * count + begin, weight_diff + begin);
+  }
+}
+
 #ifdef CPU_ONLY
 STUB_GPU(ConvolutionLayer);
 #endif
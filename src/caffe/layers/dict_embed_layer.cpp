@@ -1,3 +1,5 @@
+#include <boost/bind.hpp>
+#include <algorithm>
 #include <vector>
 
 #include "caffe/filler.hpp"
@@ -6,61 +8,128 @@
 
 namespace caffe {
 
+// Lookups ahead of the current one whose rows are prefetched. The rows of a
+// large table are scattered, so each copy would otherwise wait on memory.
+static const int kPrefetchDistance = 4;
+
+template <typename Dtype>
+static inline void PrefetchRow(const Dtype* row, int width) {
+#ifdef __GNUC__
+  const char* end = reinterpret_cast<const char*>(row + width);
+  for (const char* line = reinterpret_cast<const char*>(row); line < end;
+       line += 64) {
+    __builtin_prefetch(line);
+  }
+#endif
+}
+
 template <typename Dtype>
 void DictEmbedLayer<Dtype>::LayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
-  N_ = this->layer_param_.dict_embed_param().num_output();
+  const DictEmbedParameter& param = this->layer_param_.dict_embed_param();
+  const string& dic_source = param.dic_source();
+  if (frozen_) {
+    // Reference the table shared by every layer of the process.
+    dict_ = EmbeddingDict::GetShared(dic_source, param.num_output());
+  } else if (this->blobs_.size() == 0 && EmbeddingDict::IsBinary(dic_source)) {
+    // Back the weights by a private mapping of the dict: pages stay shared
+    // with other processes until they are written by an update.
+    dict_.reset(new EmbeddingDict(dic_source, true));
+  }
+  // A dict that was already opened gives the shape, which num_output and
+  // input_dim may then leave out.
+  N_ = dict_ && !param.has_num_output() ? dict_->dim() : param.num_output();
   CHECK_GT(N_, 0) << "DictEmbedLayer num_output must be positive.";
-  K_ = this->layer_param_.dict_embed_param().input_dim();
+  K_ = dict_ && !param.has_input_dim() ? dict_->rows() : param.input_dim();
   CHECK_GT(K_, 0) << "DictEmbedLayer input_dim must be positive.";
+  copy_row_ = RowCopier<Dtype>(N_);
+  CHECK_GT(param.num_workers(), 0);
+  workers_.reset(new ThreadPool(param.num_workers()));
   bias_term_ = this->layer_param_.dict_embed_param().bias_term();
+  // Initialize the weights --
+  // transposed from InnerProductLayer for spatial locality.
+  vector<int> weight_shape(2);
+  weight_shape[0] = K_;
+  weight_shape[1] = N_;
+  if (frozen_) {
+    CHECK_EQ(dict_->rows(), K_) << "dict rows should be equal to input_dim.";
+    CHECK_EQ(dict_->dim(), N_) << "dict dim should be equal to num_output.";
+  }
   // Check if we need to set up the weights
   if (this->blobs_.size() > 0) {
     LOG(INFO) << "Skipping parameter initialization";
   } else {
-    if (bias_term_) {
-      this->blobs_.resize(2);
+    this->blobs_.resize(bias_term_ ? 2 : 1);
+    if (frozen_) {
+      // The table is not a parameter: nets never update it, solvers keep no
+      // history for it and its diff is never allocated.
+      this->blobs_[0].reset(new Blob<Dtype>(weight_shape));
+      const Dtype* table = dict_->data<Dtype>();
+      if (table) {
+        // Only ever read, through cpu_data() and gpu_data().
+        this->blobs_[0]->set_cpu_data(const_cast<Dtype*>(table));
+      } else if (dict_->quantized()) {
+        LOG(INFO) << "Dequantizing the rows of " << dic_source
+            << " as they are looked up";
+      } else {
+        LOG(WARNING) << "Converting " << dic_source
+            << " to the layer precision; the table is not shared.";
+        dict_->CopyTo(this->blobs_[0]->mutable_cpu_data());
+      }
+      LOG(INFO) << "Sharing frozen dict.";
+    } else if (dict_) {
+      this->blobs_[0].reset(new Blob<Dtype>(weight_shape));
+      CHECK_EQ(dict_->rows(), K_) << "dict rows should be equal to input_dim.";
+      CHECK_EQ(dict_->dim(), N_) << "dict dim should be equal to num_output.";
+      Dtype* table = dict_->mutable_data<Dtype>();
+      if (table) {
+        this->blobs_[0]->data()->set_cpu_data(table);
+      } else {
+        dict_->CopyTo(this->blobs_[0]->mutable_cpu_data());
+        dict_.reset();
+      }
+      LOG(INFO)<<"Finish mapping dict.";
     } else {
-      this->blobs_.resize(1);
-    }
-    // Initialize the weights --
-    // transposed from InnerProductLayer for spatial locality.
-    vector<int> weight_shape(2);
-    weight_shape[0] = K_;
-    weight_shape[1] = N_;
-    this->blobs_[0].reset(new Blob<Dtype>(weight_shape));
-    // fill the weights
-    shared_ptr<Filler<Dtype> > weight_filler(GetFiller<Dtype>(
-        this->layer_param_.dict_embed_param().weight_filler()));
-    weight_filler->Fill(this->blobs_[0].get());
-    Dtype* dict_filler = this->blobs_[0]->mutable_cpu_data();
-    //vector<Dtype> vec_dic;
-    LOG(INFO)<<"Reading vector dict...";
-    std::ifstream fdic(this->layer_param_.dict_embed_param().dic_source().c_str());
-    CHECK(fdic != NULL) << "fail to open " << this->layer_param_.dict_embed_param().dic_source().c_str();
-    Dtype word;
-    int count = 0;
-    while(fdic>>word){
-      *dict_filler = word;
-      dict_filler++;
-      count ++;
+      this->blobs_[0].reset(new Blob<Dtype>(weight_shape));
+      // fill the weights
+      shared_ptr<Filler<Dtype> > weight_filler(GetFiller<Dtype>(
+          this->layer_param_.dict_embed_param().weight_filler()));
+      weight_filler->Fill(this->blobs_[0].get());
+      Dtype* dict_filler = this->blobs_[0]->mutable_cpu_data();
+      //vector<Dtype> vec_dic;
+      LOG(INFO)<<"Reading vector dict...";
+      std::ifstream fdic(dic_source.c_str());
+      CHECK(fdic.good()) << "fail to open " << dic_source.c_str();
+      Dtype word;
+      int count = 0;
+      while(fdic>>word){
+        CHECK_LT(count, K_ * N_) << "dict has more than input_dim rows.";
+        *dict_filler = word;
+        dict_filler++;
+        count ++;
+      }
+      CHECK_EQ(count % N_, 0)<<"count % num_output should be equal to 0.";
+      LOG(INFO)<<"vec_dic size: "<<count/N_;
+      //memcpy(dict_filler, &vec_dic, sizeof(Dtype) * vec_dic.size());
+      LOG(INFO)<<"Finish reading dict.";
     }
-    CHECK_EQ(count % 300, 0)<<"count % 300 should be equal to 0.";
-    LOG(INFO)<<"vec_dic size: "<<count/300.0;
-    //memcpy(dict_filler, &vec_dic, sizeof(Dtype) * vec_dic.size());
-    LOG(INFO)<<"Finish reading dict.";
-
 
     // If necessary, initialize and fill the bias term
     if (bias_term_) {
       vector<int> bias_shape(1, N_);
-      this->blobs_[1].reset(new Blob<Dtype>(bias_shape));
+      this->blobs_.back().reset(new Blob<Dtype>(bias_shape));
       shared_ptr<Filler<Dtype> > bias_filler(GetFiller<Dtype>(
           this->layer_param_.dict_embed_param().bias_filler()));
-      bias_filler->Fill(this->blobs_[1].get());
+      bias_filler->Fill(this->blobs_.back().get());
     }
   }  // parameter initialization
   this->param_propagate_down_.resize(this->blobs_.size(), true);
+  if (frozen_) {
+    this->param_propagate_down_[0] = false;
+  } else {
+    this->blobs_[0]->set_sparse_diff(
+        this->layer_param_.dict_embed_param().sparse_gradient());
+  }
 }
 
 template <typename Dtype>
@@ -81,35 +150,65 @@ void DictEmbedLayer<Dtype>::Reshape(const vector<Blob<Dtype>*>& bottom,
 }
 
 template <typename Dtype>
-void DictEmbedLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
-    const vector<Blob<Dtype>*>& top) {
-  const Dtype* bottom_data = bottom[0]->cpu_data();
-  const Dtype* weight = this->blobs_[0]->cpu_data();
-  Dtype* top_data = top[0]->mutable_cpu_data();
+void DictEmbedLayer<Dtype>::gather_rows(const Dtype* bottom_data,
+    const Dtype* weight, const Dtype* bias, Dtype* top_data, int worker_id) {
+  // Each worker takes a contiguous block of the lookups, so that the
+  // workers write to disjoint parts of the output.
+  const int num_workers = workers_->num_threads();
+  const int begin = int64_t(M_) * worker_id / num_workers;
+  const int end = int64_t(M_) * (worker_id + 1) / num_workers;
+  for (int n = begin; weight && n < std::min(begin + kPrefetchDistance, end);
+       ++n) {
+    PrefetchRow(weight + size_t(bottom_data[n]) * N_, N_);
+  }
   int index;
-  for (int n = 0; n < M_; ++n) {
+  for (int n = begin; n < end; ++n) {
+    if (weight && n + kPrefetchDistance < end) {
+      PrefetchRow(weight
+          + size_t(bottom_data[n + kPrefetchDistance]) * N_, N_);
+    }
     index = static_cast<int>(bottom_data[n]);
     DCHECK_GE(index, 0);
     DCHECK_LT(index, K_);
     DCHECK_EQ(static_cast<Dtype>(index), bottom_data[n]) << "non-integer input";
-    caffe_copy(N_, weight + index * N_, top_data + n * N_);
-  }
-  if (bias_term_) {
-    const Dtype* bias = this->blobs_[1]->cpu_data();
-    caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, 1, Dtype(1),
-        bias_multiplier_.cpu_data(), bias, Dtype(1), top_data);
+    if (!weight) {
+      dict_->CopyRow(index, top_data + size_t(n) * N_);
+      if (bias) {
+        caffe_axpy(N_, Dtype(1), bias, top_data + size_t(n) * N_);
+      }
+    } else if (bias) {
+      caffe_add(N_, weight + size_t(index) * N_, bias,
+          top_data + size_t(n) * N_);
+    } else {
+      copy_row_(weight + size_t(index) * N_, top_data + size_t(n) * N_);
+    }
   }
 }
 
+template <typename Dtype>
+void DictEmbedLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
+    const vector<Blob<Dtype>*>& top) {
+  const Dtype* bottom_data = bottom[0]->cpu_data();
+  // A quantized table leaves the weight blob empty; its rows are dequantized
+  // instead.
+  const Dtype* weight = frozen_ && dict_->quantized() ? NULL
+      : this->blobs_[0]->cpu_data();
+  const Dtype* bias = bias_term_ ? this->blobs_.back()->cpu_data() : NULL;
+  Dtype* top_data = top[0]->mutable_cpu_data();
+  workers_->Run(boost::bind(&DictEmbedLayer<Dtype>::gather_rows, this,
+      bottom_data, weight, bias, top_data, _1));
+}
+
 template <typename Dtype>
 void DictEmbedLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {
   CHECK(!propagate_down[0]) << "Can't backpropagate to DictEmbedLayer input.";
-  if (this->param_propagate_down_[0]) {
+  if (!frozen_ && this->param_propagate_down_[0]) {
     const Dtype* top_diff = top[0]->cpu_diff();
     const Dtype* bottom_data = bottom[0]->cpu_data();
     // Gradient with respect to weight
     Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
+    RowSet* rows = this->blobs_[0]->diff_rows();
     int index;
     for (int n = 0; n < M_; ++n) {
       index = static_cast<int>(bottom_data[n]);
@@ -117,12 +216,16 @@ void DictEmbedLayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
       DCHECK_LT(index, K_);
       DCHECK_EQ(static_cast<Dtype>(index), bottom_data[n])
           << "non-integer input";
-      caffe_axpy(N_, Dtype(1), top_diff + n * N_, weight_diff + index * N_);
+      caffe_axpy(N_, Dtype(1), top_diff + size_t(n) * N_,
+          weight_diff + size_t(index) * N_);
+      if (rows) {
+        rows->Add(index);
+      }
     }
   }
-  if (bias_term_ && this->param_propagate_down_[1]) {
+  if (bias_term_ && this->param_propagate_down_.back()) {
     const Dtype* top_diff = top[0]->cpu_diff();
-    Dtype* bias_diff = this->blobs_[1]->mutable_cpu_diff();
+    Dtype* bias_diff = this->blobs_.back()->mutable_cpu_diff();
     caffe_cpu_gemv<Dtype>(CblasTrans, M_, N_, Dtype(1), top_diff,
         bias_multiplier_.cpu_data(), Dtype(1), bias_diff);
   }
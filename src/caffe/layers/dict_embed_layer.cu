@@ -43,6 +43,11 @@ void DictEmbedLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
     const vector<Blob<Dtype>*>& top) {
   const Dtype* bottom_data = bottom[0]->gpu_data();
   Dtype* top_data = top[0]->mutable_gpu_data();
+  if (frozen_ && dict_->quantized() &&
+      this->blobs_[0]->data()->head() == SyncedMemory::UNINITIALIZED) {
+    // The GPU kernel reads the whole table, dequantized once.
+    dict_->CopyTo(this->blobs_[0]->mutable_cpu_data());
+  }
   const Dtype* weight = this->blobs_[0]->gpu_data();
   const int count = top[0]->count();
   DictEmbedForward<Dtype>  // NOLINT_NEXT_LINE(whitespace/operators)
@@ -51,7 +56,7 @@ void DictEmbedLayer<Dtype>::Forward_gpu(const vector<Blob<Dtype>*>& bottom,
   if (bias_term_) {
     caffe_gpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, M_, N_, 1, Dtype(1),
         bias_multiplier_.gpu_data(),
-        this->blobs_[1]->gpu_data(), Dtype(1), top_data);
+        this->blobs_.back()->gpu_data(), Dtype(1), top_data);
   }
 }
 
@@ -59,18 +64,22 @@ template <typename Dtype>
 void DictEmbedLayer<Dtype>::Backward_gpu(const vector<Blob<Dtype>*>& top,
     const vector<bool>& propagate_down, const vector<Blob<Dtype>*>& bottom) {
   CHECK(!propagate_down[0]) << "Can't backpropagate to DictEmbedLayer input.";
-  if (this->param_propagate_down_[0]) {
+  if (!frozen_ && this->param_propagate_down_[0]) {
     const int top_count = top[0]->count();
     const Dtype* top_diff = top[0]->gpu_diff();
     const Dtype* bottom_data = bottom[0]->gpu_data();
     Dtype* weight_diff = this->blobs_[0]->mutable_gpu_diff();
+    // Rows are not tracked on the GPU.
+    if (this->blobs_[0]->diff_rows()) {
+      this->blobs_[0]->diff_rows()->MarkAll();
+    }
     DictEmbedBackward<Dtype>  // NOLINT_NEXT_LINE(whitespace/operators)
         <<<CAFFE_GET_BLOCKS(top_count), CAFFE_CUDA_NUM_THREADS>>>(
         top_count, bottom_data, top_diff, M_, N_, K_, weight_diff);
   }
-  if (bias_term_ && this->param_propagate_down_[1]) {
+  if (bias_term_ && this->param_propagate_down_.back()) {
     const Dtype* top_diff = top[0]->gpu_diff();
-    Dtype* bias_diff = this->blobs_[1]->mutable_gpu_diff();
+    Dtype* bias_diff = this->blobs_.back()->mutable_gpu_diff();
     caffe_gpu_gemv<Dtype>(CblasTrans, M_, N_, Dtype(1), top_diff,
         bias_multiplier_.gpu_data(), Dtype(1), bias_diff);
   }
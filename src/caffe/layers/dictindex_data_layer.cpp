@@ -1,3 +1,4 @@
+#include <boost/bind.hpp>
 #include <fstream>  // NOLINT(readability/streams)
 #include <string>
 #include <vector>
@@ -55,57 +56,58 @@ void DictIndexDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& botto
   channel_ = param.channel();
   shuffle_ = param.shuffle();
 
-  data_count = channel_ * crop_height_ * crop_width_;
-  char buf[1024];
-
-  // read label
-  std::ifstream flabel(param.label_source().c_str());
-  CHECK(flabel != NULL) << "file " <<param.label_source().c_str() << " read error" ;
-  int num = 0;
-  flabel.getline(buf,sizeof(buf));
-  int len = sscanf(buf, "%d", &num);
-  CHECK_GT(len, 0);
-  text_info_.resize(num);
-  int text_idx = 0;
-  int temp_label = 0;
-  while(flabel>>temp_label)
-  {
-    CHECK_LT(text_idx, num);
-    text_info_[text_idx].label = temp_label;
-    text_idx++;
+  bucket_heights_.clear();
+  for (int i = 0; i < param.bucket_boundaries_size(); ++i) {
+    const int bound = param.bucket_boundaries(i);
+    CHECK_GT(bound, i == 0 ? 0 : bucket_heights_.back())
+        << "bucket_boundaries should be positive and increasing.";
+    CHECK_LT(bound, crop_height_)
+        << "bucket_boundaries should be below crop_height.";
+    bucket_heights_.push_back(bound);
   }
-  flabel.close();
-  CHECK_EQ(text_idx, num);
-  LOG(INFO) <<"read label done ("<< num <<" samples)";
-
-  // read list
-  LOG(INFO) << "Reading content";
-  std::ifstream fdata(param.data_source().c_str());
-  char text_fn[10240];
-  CHECK(fdata != NULL) << "fail to open " << param.data_source().c_str();
-  text_idx = 0;
-  while(!fdata.eof())
-  {
-    fdata.getline(text_fn, sizeof(text_fn));
-    if (fdata.eof())
-      break;
-    CHECK_LT(text_idx, num);
-    text_info_[text_idx].content = string(text_fn);
-    text_idx++;
+  bucket_heights_.push_back(crop_height_);
+  bucket_pending_.clear();
+  bucket_pending_.resize(bucket_heights_.size());
+  batch_height_ = crop_height_;
+
+  const int rank = param.rank();
+  const int world_size = param.world_size();
+  // Every process shuffles only its own shard, so the seeds need not
+  // match; a shared shuffle_seed only makes the run reproducible.
+  LOG_IF(WARNING, world_size > 1 && shuffle_ && !param.has_shard_source()
+      && !param.has_shuffle_seed())
+      << "No shuffle_seed: the sample orders of this run cannot be "
+      << "reproduced.";
+  if (param.has_shard_source()) {
+    LOG(INFO) << "Streaming shards listed in " << param.shard_source();
+    stream_.reset(new ShuffleBuffer<TextSample>(
+        new TextShardReader(param.shard_source(), rank, world_size),
+        shuffle_ ? param.shuffle_buffer() : 1, caffe_rng_rand()));
+  } else if (param.has_corpus_source()) {
+    LOG(INFO) << "Mapping corpus " << param.corpus_source();
+    corpus_.Open(param.corpus_source(), rank, world_size);
+  } else {
+    LOG(INFO) << "Reading content";
+    corpus_.LoadText(param.label_source(), param.data_source(), rank,
+        world_size);
   }
-  fdata.close();
-  CHECK_EQ(text_idx, num);
-  LOG(INFO) <<"read content done: #"<<text_info_.size()<<" samples.";
 
-  // randomly shuffle data
-  const unsigned int prefetch_rng_seed = caffe_rng_rand();
-  prefetch_rng_.reset(new Caffe::RNG(prefetch_rng_seed));
-  if (shuffle_) {
-	LOG(INFO) << "Shuffling data";
-    ShuffleText();
+  if (param.has_vocab_remap()) {
+    vocab_remap_.Load(param.vocab_remap());
   }
 
-  current_row_ = 0;
+  // randomly shuffle data
+  const unsigned int prefetch_rng_seed = param.has_shuffle_seed() ?
+      param.shuffle_seed() : caffe_rng_rand();
+  if (!stream_) {
+    if (shuffle_) {
+      LOG(INFO) << "Shuffling data";
+    }
+    order_.reset(new SamplePermutation(corpus_.total_samples(), shuffle_,
+        prefetch_rng_seed, rank, world_size));
+  }
+  CHECK_GT(param.num_workers(), 0);
+  workers_.reset(new ThreadPool(param.num_workers()));
 
   vector<int> data_shape;
   data_shape.push_back(batch_size_);
@@ -114,69 +116,109 @@ void DictIndexDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& botto
   top[0]->Reshape(data_shape);
   vector<int> label_shape(1, batch_size_);
   top[1]->Reshape(label_shape);
+  if (top.size() > 2) {
+    top[2]->Reshape(label_shape);
+  }
   LOG(INFO) << "output data size: " << top[0]->num() << ","
 	  << top[0]->channels() << "," << top[0]->height();
-  for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
-    this->prefetch_[i].data_.Reshape(data_shape);
-    this->prefetch_[i].label_.Reshape(label_shape);
+  if (bucket_heights_.size() > 1) {
+    LOG(INFO) << "Batching samples into " << bucket_heights_.size()
+        << " length buckets";
+  }
+  for (int i = 0; i < this->prefetch_.size(); ++i) {
+    this->prefetch_[i]->data_.Reshape(data_shape);
+    this->prefetch_[i]->label_.Reshape(label_shape);
+    this->prefetch_[i]->length_.Reshape(label_shape);
   }
 }
 
 template <typename Dtype>
-void DictIndexDataLayer<Dtype>::ShuffleText() {
-  caffe::rng_t* prefetch_rng =
-      static_cast<caffe::rng_t*>(prefetch_rng_->generator());
-  shuffle(text_info_.begin(), text_info_.end(), prefetch_rng);
+int DictIndexDataLayer<Dtype>::bucket(int length) const {
+  int b = 0;
+  while (b + 1 < bucket_heights_.size() && length > bucket_heights_[b]) {
+    ++b;
+  }
+  return b;
 }
 
 template <typename Dtype>
-void DictIndexDataLayer<Dtype>::crop(string content, Dtype* data_out){
-  //Dtype *org_data = new Dtype[num_words_*crop_width_];
-  if (content.empty())
-    caffe_set(channel_*crop_height_, Dtype(0), data_out);
+void DictIndexDataLayer<Dtype>::crop(const int32_t* tokens, int length,
+    int height, Dtype* data_out){
+  if (length == 0)
+    caffe_set(channel_*height, Dtype(0), data_out);
   else{
-    std::istringstream istr;
-    istr.str(content);
-    int count = 0;
-    int index = 0;
-    Dtype *tmp_data_out = data_out;
-    while (istr>>index){
-      if (count<crop_height_){
-        *tmp_data_out = index;
-        tmp_data_out++;
-        count++;
+    const int count = min(length, height);
+    if (vocab_remap_.empty()) {
+      for (int i = 0; i < count; i++){
+        data_out[i] = tokens[i];
+      }
+    } else {
+      // Shards stream in unchecked, so every token is checked here.
+      const uint32_t num_words = vocab_remap_.num_words();
+      for (int i = 0; i < count; i++){
+        CHECK_LT(static_cast<uint32_t>(tokens[i]), num_words)
+            << "Token " << tokens[i] << " is not in the vocab_remap.";
+        data_out[i] = vocab_remap_(tokens[i]);
       }
-      else
-        break;
     }
-    for(int i=count;i<crop_height_;i++)
+    for(int i=count;i<height;i++)
     {
-      memcpy(data_out+i, data_out+i%count, sizeof(Dtype));
+      data_out[i] = data_out[i%count];
     }
   }
 
 }
+// This function is called on the workers of the prefetch thread
+template <typename Dtype>
+void DictIndexDataLayer<Dtype>::load_items(Dtype* data, Dtype* label,
+    Dtype* length, int worker_id) {
+  const int item_count = channel_ * batch_height_ * crop_width_;
+  for (int item_id = worker_id; item_id < batch_size_;
+       item_id += workers_->num_threads()) {
+    const int sample = batch_samples_[item_id];
+    crop(sample_tokens(sample), sample_length(sample), batch_height_,
+        data + item_id*item_count);
+    label[item_id] = sample_label(sample);
+    length[item_id] = min(sample_length(sample), batch_height_);
+  }
+}
+
 // This function is called on prefetch thread
 template <typename Dtype>
 void DictIndexDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
+  // Draw samples in order until one bucket holds a full batch.
+  int b;
+  do {
+    int sample;
+    if (stream_) {
+      sample = stream_->Next();
+    } else {
+      sample = order_->Next();
+    }
+    b = bucket(sample_length(sample));
+    bucket_pending_[b].push_back(sample);
+  } while (bucket_pending_[b].size() < batch_size_);
+  batch_samples_.swap(bucket_pending_[b]);
+  bucket_pending_[b].clear();
+  batch_height_ = bucket_heights_[b];
+
   vector<int> data_shape;
   data_shape.push_back(batch_size_);
   data_shape.push_back(channel_);
-  data_shape.push_back(crop_height_);
+  data_shape.push_back(batch_height_);
   batch->data_.Reshape(data_shape);
   vector<int> label_shape(1, batch_size_);
   batch->label_.Reshape(label_shape);
+  batch->length_.Reshape(label_shape);
   Dtype *label_ptr_ = batch->label_.mutable_cpu_data();
   Dtype *data_ptr_ = batch->data_.mutable_cpu_data();
-  for (int item_id = 0; item_id < batch_size_; ++item_id) {
-         crop(text_info_[current_row_].content, data_ptr_ + item_id*data_count);
-         label_ptr_[item_id] = text_info_[current_row_].label;
-         current_row_ ++;
-         if(current_row_ >= text_info_.size()){
-            current_row_ = 0;
-	          if (shuffle_)
-	     	    ShuffleText();
-         }
+  Dtype *length_ptr_ = batch->length_.mutable_cpu_data();
+  workers_->Run(boost::bind(&DictIndexDataLayer<Dtype>::load_items, this,
+      data_ptr_, label_ptr_, length_ptr_, _1));
+  if (stream_) {
+    for (int item_id = 0; item_id < batch_size_; ++item_id) {
+      stream_->Release(batch_samples_[item_id]);
+    }
   }
 }
 
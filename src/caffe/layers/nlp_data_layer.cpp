@@ -1,4 +1,6 @@
+#include <boost/bind.hpp>
 #include <fstream>  // NOLINT(readability/streams)
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -63,60 +65,77 @@ void NlpDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   data_count = height_[0]*width_[0]*channel_[0];
   char buf[1024];
 
-  // read label
-  std::ifstream flabel(param.label_source().c_str());
-  CHECK(flabel != NULL) << "file " <<param.label_source().c_str() << " read error" ;
-  int num = 0;
-  int num_people = 0;
-  flabel.getline(buf,sizeof(buf));
-  int len = sscanf(buf, "%d%d", &num, &num_people);
-  CHECK_GT(len, 0);
-  nlp_info_.resize(num);
-  int image_idx = 0;
-  int temp_label = 0;
-  while(flabel>>temp_label)
-  {
-    CHECK_LT(image_idx, num);
-    nlp_info_[image_idx].label = temp_label;
-    image_idx++;
-  }
-  flabel.close();
-  CHECK_EQ(image_idx, num);
-  if(len == 1){
-    LOG(WARNING) << "Using deprecated label.meta format. Not specifying #people is unsafe";
-    num_people = temp_label+1;
-  }
-  LOG(INFO) <<"read label done ("<< num_people <<" people)";
-
-    // read list
-  LOG(INFO) << "Reading list";
-  string image_prefix = param.image_prefix().c_str();
-  std::ifstream fdata(param.data_source().c_str());
-  char image_fn[1024];
-  CHECK(fdata != NULL) << "fail to open " << param.data_source().c_str();
-  image_idx = 0;
-  while(fdata>>image_fn)
-  {
-    CHECK_LT(image_idx, num);
-    nlp_info_[image_idx].filename = image_prefix + "/" + string(image_fn);
-    image_idx++;
+  if (param.has_shard_source()) {
+    LOG(INFO) << "Streaming shards listed in " << param.shard_source();
+    stream_.reset(new ShuffleBuffer<nlpinfo>(
+        new ShardReader(param.shard_source(), param.image_prefix()),
+        shuffle_ ? param.shuffle_buffer() : 1, caffe_rng_rand()));
+  } else if (param.has_pack_source()) {
+    pack_.reset(new SamplePack());
+    pack_->Open(param.pack_source());
+  } else {
+    // read label
+    std::ifstream flabel(param.label_source().c_str());
+    CHECK(flabel != NULL) << "file " <<param.label_source().c_str() << " read error" ;
+    int num = 0;
+    int num_people = 0;
+    flabel.getline(buf,sizeof(buf));
+    int len = sscanf(buf, "%d%d", &num, &num_people);
+    CHECK_GT(len, 0);
+    nlp_info_.resize(num);
+    int image_idx = 0;
+    int temp_label = 0;
+    while(flabel>>temp_label)
+    {
+      CHECK_LT(image_idx, num);
+      nlp_info_[image_idx].label = temp_label;
+      image_idx++;
+    }
+    flabel.close();
+    CHECK_EQ(image_idx, num);
+    if(len == 1){
+      LOG(WARNING) << "Using deprecated label.meta format. Not specifying #people is unsafe";
+      num_people = temp_label+1;
+    }
+    LOG(INFO) <<"read label done ("<< num_people <<" people)";
+
+      // read list
+    LOG(INFO) << "Reading list";
+    string image_prefix = param.image_prefix().c_str();
+    std::ifstream fdata(param.data_source().c_str());
+    char image_fn[1024];
+    CHECK(fdata != NULL) << "fail to open " << param.data_source().c_str();
+    image_idx = 0;
+    while(fdata>>image_fn)
+    {
+      CHECK_LT(image_idx, num);
+      nlp_info_[image_idx].filename = image_prefix + "/" + string(image_fn);
+      image_idx++;
+    }
+    fdata.close();
+    CHECK_EQ(image_idx, num);
+    LOG(INFO) <<"read list done (#image, #people: "<<nlp_info_.size()<<", "<<num_people<<")";
   }
-  fdata.close();
-  CHECK_EQ(image_idx, num);
-  LOG(INFO) <<"read list done (#image, #people: "<<nlp_info_.size()<<", "<<num_people<<")";
 
   // randomly shuffle data
   const unsigned int prefetch_rng_seed = caffe_rng_rand();
-  prefetch_rng_.reset(new Caffe::RNG(prefetch_rng_seed));
-  if (shuffle_) {
-	LOG(INFO) << "Shuffling data";
-	ShuffleImages();
+  if (!stream_) {
+    if (shuffle_) {
+      LOG(INFO) << "Shuffling data";
+    }
+    order_.reset(new SamplePermutation(
+        pack_ ? pack_->num_samples() : nlp_info_.size(), shuffle_,
+        prefetch_rng_seed));
   }
-
-  //const int thread_id = Caffe::getThreadId();
-  //const int thread_num = Caffe::getThreadNum();
-  //current_row_ = nlp_info_.size() / thread_num * thread_id;
-  current_row_ = 0;
+  CHECK_GT(param.num_workers(), 0);
+  workers_.reset(new ThreadPool(param.num_workers()));
+  if (param.io_depth() > 0 && !pack_) {
+    reader_.reset(new AsyncReader(param.io_depth()));
+    LOG(INFO) << "Reading files with " << param.io_depth()
+        << " requests in flight"
+        << (reader_->uses_io_uring() ? " through io_uring" : "");
+  }
+  batch_ids_.resize(batch_size_);
 
   // getchar();
   // Reshape blobs.
@@ -129,19 +148,63 @@ void NlpDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
 	  << top[0]->width();
   //this->prefetch_data_.Reshape(batch_size_ / thread_num, channel_[0], height_[0], width_[0]);
   //this->prefetch_label_.Reshape(batch_size_ / thread_num, channel_[1], height_[1], width_[1]);
-  for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
-    this->prefetch_[i].data_.Reshape(batch_size_, channel_[0], height_[0], width_[0]);
-    //this->prefetch_[i].label_.Reshape(batch_size_, channel_[1], height_[1], width_[1]);
-    this->prefetch_[i].label_.Reshape(label_shape);
+  for (int i = 0; i < this->prefetch_.size(); ++i) {
+    this->prefetch_[i]->data_.Reshape(batch_size_, channel_[0], height_[0], width_[0]);
+    //this->prefetch_[i]->label_.Reshape(batch_size_, channel_[1], height_[1], width_[1]);
+    this->prefetch_[i]->label_.Reshape(label_shape);
   }
 
 }
 
 template <typename Dtype>
-void NlpDataLayer<Dtype>::ShuffleImages() {
-  caffe::rng_t* prefetch_rng =
-      static_cast<caffe::rng_t*>(prefetch_rng_->generator());
-  shuffle(nlp_info_.begin(), nlp_info_.end(), prefetch_rng);
+NlpDataLayer<Dtype>::ShardReader::ShardReader(const string& shard_list,
+    const string& image_prefix)
+    : image_prefix_(image_prefix), shard_(-1), remaining_(0) {
+  std::ifstream list(shard_list.c_str());
+  CHECK(list.good()) << "fail to open " << shard_list;
+  string line;
+  while (std::getline(list, line)) {
+    std::istringstream fields(line);
+    string label_file, data_file;
+    if (fields >> label_file >> data_file) {
+      shards_.push_back(std::make_pair(label_file, data_file));
+    }
+  }
+  CHECK_GT(shards_.size(), 0) << "no shards listed in " << shard_list;
+}
+
+template <typename Dtype>
+void NlpDataLayer<Dtype>::ShardReader::OpenShard(int shard) {
+  label_file_.close();
+  label_file_.clear();
+  label_file_.open(shards_[shard].first.c_str());
+  CHECK(label_file_.good()) << "file " << shards_[shard].first
+      << " read error";
+  string line;
+  std::getline(label_file_, line);
+  int num = 0;
+  CHECK_GT(sscanf(line.c_str(), "%d", &num), 0);
+  data_file_.close();
+  data_file_.clear();
+  data_file_.open(shards_[shard].second.c_str());
+  CHECK(data_file_.good()) << "fail to open " << shards_[shard].second;
+  remaining_ = num;
+}
+
+template <typename Dtype>
+void NlpDataLayer<Dtype>::ShardReader::Read(nlpinfo* sample) {
+  for (int tries = 0; remaining_ == 0; ++tries) {
+    CHECK_LE(tries, shards_.size()) << "all shards are empty";
+    shard_ = (shard_ + 1) % shards_.size();
+    OpenShard(shard_);
+  }
+  string image_fn;
+  CHECK(label_file_ >> sample->label)
+      << "missing labels in " << shards_[shard_].first;
+  CHECK(data_file_ >> image_fn)
+      << "missing files in " << shards_[shard_].second;
+  sample->filename = image_prefix_ + "/" + image_fn;
+  --remaining_;
 }
 
 template <typename Dtype>
@@ -157,6 +220,27 @@ void NlpDataLayer<Dtype>::crop(string path,Dtype* data_out, int crop_height_, in
   //}
   fin.close();
  }
+// This function is called on the workers of the prefetch thread
+template <typename Dtype>
+void NlpDataLayer<Dtype>::load_items(Dtype* data, Dtype* label,
+    int worker_id) {
+  for (int item_id = worker_id; item_id < batch_size_;
+       item_id += workers_->num_threads()) {
+    const int id = batch_ids_[item_id];
+    if (pack_) {
+      const size_t bytes = sizeof(Dtype) * crop_height_ * crop_width_;
+      CHECK_GE(pack_->size(id), bytes) << "packed sample " << id
+          << " is too small";
+      memcpy(data + item_id*data_count, pack_->data(id), bytes);
+      label[item_id] = pack_->label(id);
+      continue;
+    }
+    const nlpinfo& info = sample(id);
+    crop(info.filename, data + item_id*data_count, crop_height_, crop_width_);
+    label[item_id] = info.label;
+  }
+}
+
 // This function is called on prefetch thread
 template <typename Dtype>
 void NlpDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
@@ -168,18 +252,25 @@ void NlpDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   Dtype *label_ptr_ = batch->label_.mutable_cpu_data();
   Dtype *data_ptr_ = batch->data_.mutable_cpu_data();
   for (int item_id = 0; item_id < batch_size_; ++item_id) {
-    // get a blob
-       //for (int i = 0; i < batch_size_ / Caffe::getThreadNum(); ++i){
-         crop(nlp_info_[current_row_].filename, data_ptr_ + item_id*data_count, crop_height_, crop_width_);
-         label_ptr_[item_id] = nlp_info_[current_row_].label;
-         //LOG(INFO)<<nlp_info_[current_row_].filename<<" "<<nlp_info_[current_row_].label;
-         current_row_ ++;
-         if(current_row_ >= nlp_info_.size()){
-           current_row_ = 0;
-	       if (shuffle_)
-	     	  ShuffleImages();
-         }
-       //}
+    batch_ids_[item_id] = stream_ ? stream_->Next() : order_->Next();
+  }
+  if (reader_) {
+    // Issue the reads of the whole batch at once.
+    for (int item_id = 0; item_id < batch_size_; ++item_id) {
+      const nlpinfo& info = sample(batch_ids_[item_id]);
+      reader_->Add(info.filename, data_ptr_ + item_id*data_count,
+          sizeof(Dtype) * crop_height_ * crop_width_);
+      label_ptr_[item_id] = info.label;
+    }
+    reader_->Wait();
+  } else {
+    workers_->Run(boost::bind(&NlpDataLayer<Dtype>::load_items, this,
+        data_ptr_, label_ptr_, _1));
+  }
+  if (stream_) {
+    for (int item_id = 0; item_id < batch_size_; ++item_id) {
+      stream_->Release(batch_ids_[item_id]);
+    }
   }
 }
 
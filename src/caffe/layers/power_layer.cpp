@@ -2,6 +2,7 @@
 
 #include "caffe/layers/power_layer.hpp"
 #include "caffe/util/math_functions.hpp"
+#include "caffe/util/neuron_kernels.hpp"
 
 namespace caffe {
 
@@ -28,16 +29,7 @@ void PowerLayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
     return;
   }
   const Dtype* bottom_data = bottom[0]->cpu_data();
-  caffe_copy(count, bottom_data, top_data);
-  if (scale_ != Dtype(1)) {
-    caffe_scal(count, scale_, top_data);
-  }
-  if (shift_ != Dtype(0)) {
-    caffe_add_scalar(count, shift_, top_data);
-  }
-  if (power_ != Dtype(1)) {
-    caffe_powx(count, top_data, power_, top_data);
-  }
+  caffe_cpu_power(count, bottom_data, scale_, shift_, power_, top_data);
 }
 
 template <typename Dtype>
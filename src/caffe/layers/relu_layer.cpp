@@ -1,7 +1,7 @@
-#include <algorithm>
 #include <vector>
 
 #include "caffe/layers/relu_layer.hpp"
+#include "caffe/util/neuron_kernels.hpp"
 
 namespace caffe {
 
@@ -12,10 +12,7 @@ void ReLULayer<Dtype>::Forward_cpu(const vector<Blob<Dtype>*>& bottom,
   Dtype* top_data = top[0]->mutable_cpu_data();
   const int count = bottom[0]->count();
   Dtype negative_slope = this->layer_param_.relu_param().negative_slope();
-  for (int i = 0; i < count; ++i) {
-    top_data[i] = std::max(bottom_data[i], Dtype(0))
-        + negative_slope * std::min(bottom_data[i], Dtype(0));
-  }
+  caffe_cpu_relu(count, bottom_data, negative_slope, top_data);
 }
 
 template <typename Dtype>
@@ -28,10 +25,8 @@ void ReLULayer<Dtype>::Backward_cpu(const vector<Blob<Dtype>*>& top,
     Dtype* bottom_diff = bottom[0]->mutable_cpu_diff();
     const int count = bottom[0]->count();
     Dtype negative_slope = this->layer_param_.relu_param().negative_slope();
-    for (int i = 0; i < count; ++i) {
-      bottom_diff[i] = top_diff[i] * ((bottom_data[i] > 0)
-          + negative_slope * (bottom_data[i] <= 0));
-    }
+    caffe_cpu_relu_backward(count, bottom_data, top_diff, negative_slope,
+        bottom_diff);
   }
 }
 
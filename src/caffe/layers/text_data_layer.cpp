@@ -1,3 +1,4 @@
+#include <boost/bind.hpp>
 #include <fstream>  // NOLINT(readability/streams)
 #include <string>
 #include <vector>
@@ -35,12 +36,11 @@ template <typename Dtype>
 void TextDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
       const vector<Blob<Dtype>*>& top) {
   const TextDataParameter & param = this->layer_param_.text_data_param();
-  if (param.has_crop_height() && param.has_crop_width()){
+  if (param.has_crop_height()){
       crop_height_ = param.crop_height();
-      crop_width_ = param.crop_width();
   }
   else{
-      LOG(FATAL)<<"TextDataLayer: crop_height crop_width error!";
+      LOG(FATAL)<<"TextDataLayer: crop_height error!";
   }
   if (param.has_num_words()){
       num_words_ = param.num_words();
@@ -52,64 +52,102 @@ void TextDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
     flip_ = param.flip();
   else
     flip_ = false;
-  CHECK_EQ(crop_width_, 300)<<"crop_width_ should be equal to 300.";
   CHECK_GE(num_words_, crop_height_)<<"num_words should be greater or equal to crop_height_.";
 
   batch_size_ = param.batch_size();
   channel_ = param.channel();
   shuffle_ = param.shuffle();
 
+  // The crop width is the embedding width: a binary dict records it in its
+  // header, a text dict is split into rows of crop_width values. Either way
+  // the table is loaded once and shared by every layer of the process.
+  dict_ = EmbeddingDict::GetShared(param.dict_source(), param.crop_width());
+  crop_width_ = dict_->dim();
+  if (param.has_crop_width()) {
+    CHECK_EQ(param.crop_width(), crop_width_)
+        << "crop_width should be equal to the dict dim.";
+  }
+  dict_rows_ = dict_->rows();
+  dict_data_ = dict_->data<Dtype>();
+  if (dict_->quantized()) {
+    LOG(INFO) << "Dequantizing the rows of " << param.dict_source()
+        << " as they are looked up";
+  } else if (!dict_data_) {
+    LOG(WARNING) << "Converting " << param.dict_source()
+        << " to the layer precision; the table is not shared.";
+    vec_dict.resize(size_t(dict_rows_) * crop_width_);
+    dict_->CopyTo(&vec_dict[0]);
+    dict_data_ = &vec_dict[0];
+    dict_.reset();
+  }
+  LOG(INFO)<<"vec_dict size: "<<dict_rows_<<" x "<<crop_width_;
+  copy_row_ = RowCopier<Dtype>(crop_width_);
+
   data_count = channel_ * crop_height_ * crop_width_;
-  char buf[1024];
-
-  // read label
-  std::ifstream flabel(param.label_source().c_str());
-  CHECK(flabel != NULL) << "file " <<param.label_source().c_str() << " read error" ;
-  int num = 0;
-  flabel.getline(buf,sizeof(buf));
-  int len = sscanf(buf, "%d", &num);
-  CHECK_GT(len, 0);
-  text_info_.resize(num);
-  int text_idx = 0;
-  int temp_label = 0;
-  while(flabel>>temp_label)
-  {
-    CHECK_LT(text_idx, num);
-    text_info_[text_idx].label = temp_label;
-    text_idx++;
-  }
-  flabel.close();
-  CHECK_EQ(text_idx, num);
-  LOG(INFO) <<"read label done ("<< num <<" samples)";
-
-  // read list
-  LOG(INFO) << "Reading content";
-  std::ifstream fdata(param.data_source().c_str());
-  char text_fn[10240];
-  CHECK(fdata != NULL) << "fail to open " << param.data_source().c_str();
-  text_idx = 0;
-  while(!fdata.eof())
-  {
-    fdata.getline(text_fn, sizeof(text_fn));
-    if (fdata.eof())
-      break;
-    CHECK_LT(text_idx, num);
-    text_info_[text_idx].content = string(text_fn);
-    text_idx++;
-  }
-  fdata.close();
-  CHECK_EQ(text_idx, num);
-  LOG(INFO) <<"read content done: #"<<text_info_.size()<<" samples.";
 
-  // randomly shuffle data
-  const unsigned int prefetch_rng_seed = caffe_rng_rand();
-  prefetch_rng_.reset(new Caffe::RNG(prefetch_rng_seed));
-  if (shuffle_) {
-	LOG(INFO) << "Shuffling data";
-    ShuffleText();
+  const int rank = param.rank();
+  const int world_size = param.world_size();
+  // Every process shuffles only its own shard, so the seeds need not
+  // match; a shared shuffle_seed only makes the run reproducible.
+  LOG_IF(WARNING, world_size > 1 && shuffle_ && !param.has_shard_source()
+      && !param.has_shuffle_seed())
+      << "No shuffle_seed: the sample orders of this run cannot be "
+      << "reproduced.";
+  if (param.has_shard_source()) {
+    LOG(INFO) << "Streaming shards listed in " << param.shard_source();
+    stream_.reset(new ShuffleBuffer<TextSample>(
+        new TextShardReader(param.shard_source(), rank, world_size),
+        shuffle_ ? param.shuffle_buffer() : 1, caffe_rng_rand()));
+  } else if (param.has_vocab_source()) {
+    raw_text_ = true;
+    vocab_.Open(param.vocab_source());
+    CHECK_LE(vocab_.num_words(), dict_rows_)
+        << param.vocab_source() << " has more words than the dict.";
+    unknown_word_ = param.unknown_word();
+    CHECK_LT(unknown_word_, dict_rows_)
+        << "unknown_word should be a row of the dict.";
+    LOG(INFO) << "Reading raw text";
+    raw_corpus_.Open(param.label_source(), param.data_source(), rank,
+        world_size);
+  } else if (param.has_corpus_source()) {
+    LOG(INFO) << "Mapping corpus " << param.corpus_source();
+    corpus_.Open(param.corpus_source(), rank, world_size);
+  } else {
+    LOG(INFO) << "Reading content";
+    corpus_.LoadText(param.label_source(), param.data_source(), rank,
+        world_size);
   }
 
-  current_row_ = 0;
+  if (param.has_vocab_remap()) {
+    vocab_remap_.Load(param.vocab_remap());
+    // tools/remap_vocabulary renumbers every row of the dict; a shorter
+    // remap would leave tokens of the dict without a new index.
+    CHECK_EQ(vocab_remap_.num_words(), dict_rows_)
+        << param.vocab_remap() << " does not match the dict.";
+  }
+
+  // randomly shuffle data
+  const unsigned int prefetch_rng_seed = param.has_shuffle_seed() ?
+      param.shuffle_seed() : caffe_rng_rand();
+  if (!stream_) {
+    if (shuffle_) {
+      LOG(INFO) << "Shuffling data";
+    }
+    const int total_samples = raw_text_ ?
+        raw_corpus_.total_samples() : corpus_.total_samples();
+    order_.reset(new SamplePermutation(total_samples, shuffle_,
+        prefetch_rng_seed, rank, world_size));
+  }
+  const int num_workers = param.num_workers();
+  CHECK_GT(num_workers, 0);
+  for (int i = 0; i < num_workers; ++i) {
+    worker_rngs_.push_back(
+        shared_ptr<Caffe::RNG>(new Caffe::RNG(caffe_rng_rand())));
+  }
+  workers_.reset(new ThreadPool(num_workers));
+  worker_tokens_.resize(num_workers);
+  batch_samples_.resize(batch_size_);
+  LOG(INFO) << "Assembling batches with " << num_workers << " workers";
 
   top[0]->Reshape(batch_size_, channel_, crop_height_, crop_width_);
   vector<int> label_shape(1, batch_size_);
@@ -117,73 +155,71 @@ void TextDataLayer<Dtype>::DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
   LOG(INFO) << "output data size: " << top[0]->num() << ","
 	  << top[0]->channels() << "," << top[0]->height() << ","
 	  << top[0]->width();
-  for (int i = 0; i < this->PREFETCH_COUNT; ++i) {
-    this->prefetch_[i].data_.Reshape(batch_size_, channel_, crop_height_, crop_width_);
-    this->prefetch_[i].label_.Reshape(label_shape);
+  for (int i = 0; i < this->prefetch_.size(); ++i) {
+    this->prefetch_[i]->data_.Reshape(batch_size_, channel_, crop_height_, crop_width_);
+    this->prefetch_[i]->label_.Reshape(label_shape);
   }
-
-  LOG(INFO)<<"Reading vector dict...";
-  std::ifstream fdict(param.dict_source().c_str());
-  CHECK(fdict != NULL) << "fail to open " << param.dict_source().c_str();
-  Dtype word;
-  while(fdict>>word)
-    vec_dict.push_back(word);
-  CHECK_EQ(vec_dict.size() % 300, 0)<<"vec_dict.size() % 300 should be equal to 0.";
-  LOG(INFO)<<"vec_dict size: "<<vec_dict.size()/300.0;
-
-
 }
 
 template <typename Dtype>
-void TextDataLayer<Dtype>::ShuffleText() {
-  caffe::rng_t* prefetch_rng =
-      static_cast<caffe::rng_t*>(prefetch_rng_->generator());
-  shuffle(text_info_.begin(), text_info_.end(), prefetch_rng);
-}
-
-template <typename Dtype>
-void TextDataLayer<Dtype>::crop(string content, Dtype* data_out){
-  Dtype *org_data = new Dtype[num_words_*crop_width_];
-  if (content.empty())
-    caffe_set(channel_*crop_height_*crop_width_, Dtype(0), data_out);
-  else{
-    std::istringstream istr;
-    istr.str(content);
-    int count = 0;
-    int index = 0;
-    while (istr>>index){
-      if (count<num_words_){
-        memcpy(org_data+count*crop_width_, &vec_dict[index*crop_width_], sizeof(Dtype) * crop_width_);
-        count++;
+void TextDataLayer<Dtype>::crop(const int32_t* tokens, int length,
+    Dtype* data_out, Caffe::RNG* rng){
+  // The sample is conceptually padded cyclically to num_words_ rows and a
+  // crop_height_ window is taken from it. Only the rows of the window are
+  // gathered, straight from the dict into the batch.
+  int h_off = 0;
+  if (this->phase_ == TRAIN && num_words_ > crop_height_) {
+    caffe::rng_t* rng_seed =
+      static_cast<caffe::rng_t*>(rng->generator());
+    h_off = (*rng_seed)() % (num_words_ - crop_height_);
+  }
+  if (length == 0) {
+    // Every channel, so that no value of the previous batch in this slot
+    // is left behind.
+    caffe_set(data_count, Dtype(0), data_out);
+  } else {
+    const int count = min(length, num_words_);
+    for (int i = 0; i < crop_height_; i++){
+      int32_t token = tokens[(h_off + i) % count];
+      if (!vocab_remap_.empty()) {
+        token = vocab_remap_(token);
+      }
+      DCHECK_LT(token, dict_rows_);
+      if (dict_data_) {
+        copy_row_(dict_data_ + size_t(token)*crop_width_, data_out+i*crop_width_);
+      } else {
+        dict_->CopyRow(token, data_out+i*crop_width_);
       }
-      else
-        break;
-    }
-    for(int i=count;i<num_words_;i++)
-    {
-      memcpy(org_data+i*crop_width_, org_data+i%count*crop_width_, sizeof(Dtype) * crop_width_);
     }
   }
-  if (this->phase_ == TRAIN) {
-    caffe::rng_t* rng_seed =
-      static_cast<caffe::rng_t*>(prefetch_rng_->generator());
-    int h_off = (*rng_seed)() % (num_words_ - crop_height_);
-    memcpy(data_out, org_data+h_off*crop_width_, sizeof(Dtype)*crop_height_*crop_width_);
-  }
-  else
-      memcpy(data_out, org_data, sizeof(Dtype)*crop_height_*crop_width_);
 
   if (flip_){
-    //Dtype *flip_data = new Dtype[crop_height_*crop_width_];
     for (int i = 0;i<crop_height_;i++)
-      memcpy(data_out  + (i+crop_height_)* crop_width_, data_out+(crop_height_ - 1 - i)*crop_width_, sizeof(Dtype)*crop_width_);
-      //memcpy(flip_data + i* crop_width_, data_out+(crop_height_ - 1 - i)*crop_width_, sizeof(Dtype)*crop_width_);
-    //memcpy(data_out, flip_data, sizeof(Dtype)*crop_height_*crop_width_);
-    //delete flip_data;
+      copy_row_(data_out+(crop_height_ - 1 - i)*crop_width_, data_out  + (i+crop_height_)* crop_width_);
   }
-  delete org_data;
-
 }
+// This function is called on the workers of the prefetch thread
+template <typename Dtype>
+void TextDataLayer<Dtype>::load_items(Dtype* data, Dtype* label,
+    int worker_id) {
+  for (int item_id = worker_id; item_id < batch_size_;
+       item_id += workers_->num_threads()) {
+    const int sample = batch_samples_[item_id];
+    if (raw_text_) {
+      vector<int32_t>& tokens = worker_tokens_[worker_id];
+      tokens.clear();
+      vocab_.Tokenize(raw_corpus_.text(sample), raw_corpus_.text_length(sample),
+          unknown_word_, &tokens);
+      crop(tokens.empty() ? NULL : &tokens[0], tokens.size(),
+          data + item_id*data_count, worker_rngs_[worker_id].get());
+    } else {
+      crop(sample_tokens(sample), sample_length(sample),
+          data + item_id*data_count, worker_rngs_[worker_id].get());
+    }
+    label[item_id] = sample_label(sample);
+  }
+}
+
 // This function is called on prefetch thread
 template <typename Dtype>
 void TextDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
@@ -193,14 +229,18 @@ void TextDataLayer<Dtype>::load_batch(Batch<Dtype>* batch) {
   Dtype *label_ptr_ = batch->label_.mutable_cpu_data();
   Dtype *data_ptr_ = batch->data_.mutable_cpu_data();
   for (int item_id = 0; item_id < batch_size_; ++item_id) {
-         crop(text_info_[current_row_].content, data_ptr_ + item_id*data_count);
-         label_ptr_[item_id] = text_info_[current_row_].label;
-         current_row_ ++;
-         if(current_row_ >= text_info_.size()){
-            current_row_ = 0;
-	          if (shuffle_)
-	     	    ShuffleText();
-         }
+    if (stream_) {
+      batch_samples_[item_id] = stream_->Next();
+    } else {
+      batch_samples_[item_id] = order_->Next();
+    }
+  }
+  workers_->Run(boost::bind(&TextDataLayer<Dtype>::load_items, this,
+      data_ptr_, label_ptr_, _1));
+  if (stream_) {
+    for (int item_id = 0; item_id < batch_size_; ++item_id) {
+      stream_->Release(batch_samples_[item_id]);
+    }
   }
 }
 
@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <vector>
+
+#include "caffe/layers/winograd_conv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
+
+namespace caffe {
+
+// The transforms of F(2x2, 3x3) and F(4x4, 3x3), from Lavin & Gray, "Fast
+// Algorithms for Convolutional Neural Networks" (2015).
+static const double kInputTransform2[4 * 4] = {
+  1,  0, -1,  0,
+  0,  1,  1,  0,
+  0, -1,  1,  0,
+  0,  1,  0, -1
+};
+static const double kFilterTransform2[4 * 3] = {
+  1,    0,   0,
+  0.5,  0.5, 0.5,
+  0.5, -0.5, 0.5,
+  0,    0,   1
+};
+static const double kOutputTransform2[2 * 4] = {
+  1, 1,  1,  0,
+  0, 1, -1, -1
+};
+static const double kInputTransform4[6 * 6] = {
+  4,  0, -5,  0, 1, 0,
+  0, -4, -4,  1, 1, 0,
+  0,  4, -4, -1, 1, 0,
+  0, -2, -1,  2, 1, 0,
+  0,  2, -1, -2, 1, 0,
+  0,  4,  0, -5, 0, 1
+};
+static const double kFilterTransform4[6 * 3] = {
+  1. / 4,  0,       0,
+  -1. / 6, -1. / 6,  -1. / 6,
+  -1. / 6, 1. / 6,   -1. / 6,
+  1. / 24, 1. / 12,  1. / 6,
+  1. / 24, -1. / 12, 1. / 6,
+  0,       0,        1
+};
+static const double kOutputTransform4[4 * 6] = {
+  1, 1,  1, 1,  1, 0,
+  0, 1, -1, 2, -2, 0,
+  0, 1,  1, 4,  4, 0,
+  0, 1, -1, 8, -8, 1
+};
+// The largest tile, alpha x alpha for F(4x4, 3x3).
+static const int kMaxTileSize = 6 * 6;
+
+// out = L in L^T for an n x n tile in and a rows x n matrix L; L is stored
+// as n x rows when transpose is set, for the transposed transforms.
+template <typename Dtype>
+static void TransformTile(const Dtype* L, bool transpose, int rows, int n,
+    const Dtype* in, Dtype* out) {
+  Dtype tmp[kMaxTileSize];
+  for (int r = 0; r < rows; ++r) {
+    for (int j = 0; j < n; ++j) {
+      Dtype sum = 0;
+      for (int k = 0; k < n; ++k) {
+        sum += (transpose ? L[k * rows + r] : L[r * n + k]) * in[k * n + j];
+      }
+      tmp[r * n + j] = sum;
+    }
+  }
+  for (int r = 0; r < rows; ++r) {
+    for (int s = 0; s < rows; ++s) {
+      Dtype sum = 0;
+      for (int k = 0; k < n; ++k) {
+        sum += tmp[r * n + k] * (transpose ? L[k * rows + s] : L[s * n + k]);
+      }
+      out[r * rows + s] = sum;
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::LayerSetUp(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  ConvolutionLayer<Dtype>::LayerSetUp(bottom, top);
+  const ConvolutionParameter& conv_param =
+      this->layer_param_.convolution_param();
+  tile_ = conv_param.winograd_tile();
+  CHECK(tile_ == 2 || tile_ == 4) << "winograd_tile should be 2 or 4.";
+  alpha_ = tile_ + 2;
+  const double* input_transform =
+      tile_ == 2 ? kInputTransform2 : kInputTransform4;
+  const double* filter_transform =
+      tile_ == 2 ? kFilterTransform2 : kFilterTransform4;
+  const double* output_transform =
+      tile_ == 2 ? kOutputTransform2 : kOutputTransform4;
+  input_transform_.assign(input_transform, input_transform + alpha_ * alpha_);
+  filter_transform_.assign(filter_transform, filter_transform + alpha_ * 3);
+  output_transform_.assign(output_transform,
+      output_transform + tile_ * alpha_);
+
+  winograd_ = this->num_spatial_axes_ == 2;
+  for (int i = 0; winograd_ && i < 2; ++i) {
+    winograd_ = this->kernel_shape_.cpu_data()[i] == 3
+        && this->stride_.cpu_data()[i] == 1
+        && this->dilation_.cpu_data()[i] == 1;
+  }
+  if (!winograd_) {
+    LOG(INFO) << "Layer " << this->layer_param_.name() << ": Winograd "
+        << "convolution needs 3x3 kernels with stride 1 and no dilation; "
+        << "falling back to the CAFFE engine.";
+    return;
+  }
+  pad_h_ = this->pad_.cpu_data()[0];
+  pad_w_ = this->pad_.cpu_data()[1];
+  in_channels_ = this->channels_;
+  out_channels_ = this->num_output_;
+  vector<int> shape(3, alpha_ * alpha_);
+  shape[1] = out_channels_;
+  shape[2] = in_channels_ / this->group_;
+  transformed_weights_.Reshape(shape);
+  transformed_weight_diff_.Reshape(shape);
+  transformed_from_.clear();
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::Reshape(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  ConvolutionLayer<Dtype>::Reshape(bottom, top);
+  if (!winograd_) {
+    return;
+  }
+  height_ = this->input_shape(1);
+  width_ = this->input_shape(2);
+  height_out_ = this->output_shape_[0];
+  width_out_ = this->output_shape_[1];
+  tiles_h_ = (height_out_ + tile_ - 1) / tile_;
+  tiles_w_ = (width_out_ + tile_ - 1) / tile_;
+  num_tiles_ = tiles_h_ * tiles_w_;
+  vector<int> shape(3, alpha_ * alpha_);
+  shape[1] = in_channels_;
+  shape[2] = num_tiles_;
+  input_tiles_.Reshape(shape);
+  shape[1] = out_channels_;
+  product_tiles_.Reshape(shape);
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::transform_weights() {
+  const Dtype* weights = this->blobs_[0]->cpu_data();
+  const int count = this->blobs_[0]->count();
+  if (transformed_from_.size() == count
+      && std::equal(weights, weights + count, transformed_from_.begin())) {
+    return;
+  }
+  transformed_from_.assign(weights, weights + count);
+  // Filter f = (output channel, input channel) is 3 x 3.
+  const int num_filters = count / 9;
+  Dtype* transformed = transformed_weights_.mutable_cpu_data();
+  Dtype tile[kMaxTileSize];
+  for (int f = 0; f < num_filters; ++f) {
+    TransformTile(&filter_transform_[0], false, alpha_, 3, weights + f * 9,
+        tile);
+    for (int e = 0; e < alpha_ * alpha_; ++e) {
+      transformed[e * num_filters + f] = tile[e];
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::transform_input(const Dtype* input) {
+  Dtype* tiles = input_tiles_.mutable_cpu_data();
+  const int plane = in_channels_ * num_tiles_;
+  Dtype in[kMaxTileSize], out[kMaxTileSize];
+  for (int c = 0; c < in_channels_; ++c) {
+    const Dtype* channel = input + c * height_ * width_;
+    for (int p = 0; p < num_tiles_; ++p) {
+      const int y0 = (p / tiles_w_) * tile_ - pad_h_;
+      const int x0 = (p % tiles_w_) * tile_ - pad_w_;
+      for (int y = 0; y < alpha_; ++y) {
+        for (int x = 0; x < alpha_; ++x) {
+          const int h = y0 + y;
+          const int w = x0 + x;
+          in[y * alpha_ + x] = (h >= 0 && h < height_ && w >= 0 && w < width_)
+              ? channel[h * width_ + w] : Dtype(0);
+        }
+      }
+      TransformTile(&input_transform_[0], false, alpha_, alpha_, in, out);
+      for (int e = 0; e < alpha_ * alpha_; ++e) {
+        tiles[e * plane + c * num_tiles_ + p] = out[e];
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::multiply_tiles() {
+  const int kernel_channels = in_channels_ / this->group_;
+  const int group_outputs = out_channels_ / this->group_;
+  const Dtype* weights = transformed_weights_.cpu_data();
+  const Dtype* inputs = input_tiles_.cpu_data();
+  Dtype* products = product_tiles_.mutable_cpu_data();
+  for (int e = 0; e < alpha_ * alpha_; ++e) {
+    for (int g = 0; g < this->group_; ++g) {
+      caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasNoTrans, group_outputs,
+          num_tiles_, kernel_channels, (Dtype)1.,
+          weights + (e * out_channels_ + g * group_outputs) * kernel_channels,
+          inputs + (e * in_channels_ + g * kernel_channels) * num_tiles_,
+          (Dtype)0.,
+          products + (e * out_channels_ + g * group_outputs) * num_tiles_);
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::transform_output(Dtype* output) {
+  const Dtype* products = product_tiles_.cpu_data();
+  const int plane = out_channels_ * num_tiles_;
+  Dtype in[kMaxTileSize], out[kMaxTileSize];
+  for (int k = 0; k < out_channels_; ++k) {
+    Dtype* channel = output + k * height_out_ * width_out_;
+    for (int p = 0; p < num_tiles_; ++p) {
+      for (int e = 0; e < alpha_ * alpha_; ++e) {
+        in[e] = products[e * plane + k * num_tiles_ + p];
+      }
+      TransformTile(&output_transform_[0], false, tile_, alpha_, in, out);
+      const int y0 = (p / tiles_w_) * tile_;
+      const int x0 = (p % tiles_w_) * tile_;
+      for (int y = 0; y < tile_ && y0 + y < height_out_; ++y) {
+        for (int x = 0; x < tile_ && x0 + x < width_out_; ++x) {
+          channel[(y0 + y) * width_out_ + x0 + x] = out[y * tile_ + x];
+        }
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::transform_output_diff(
+    const Dtype* output_diff) {
+  Dtype* products = product_tiles_.mutable_cpu_data();
+  const int plane = out_channels_ * num_tiles_;
+  Dtype in[kMaxTileSize], out[kMaxTileSize];
+  for (int k = 0; k < out_channels_; ++k) {
+    const Dtype* channel = output_diff + k * height_out_ * width_out_;
+    for (int p = 0; p < num_tiles_; ++p) {
+      const int y0 = (p / tiles_w_) * tile_;
+      const int x0 = (p % tiles_w_) * tile_;
+      for (int y = 0; y < tile_; ++y) {
+        for (int x = 0; x < tile_; ++x) {
+          in[y * tile_ + x] = (y0 + y < height_out_ && x0 + x < width_out_)
+              ? channel[(y0 + y) * width_out_ + x0 + x] : Dtype(0);
+        }
+      }
+      TransformTile(&output_transform_[0], true, alpha_, tile_, in, out);
+      for (int e = 0; e < alpha_ * alpha_; ++e) {
+        products[e * plane + k * num_tiles_ + p] = out[e];
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::accumulate_weight_diff() {
+  const int kernel_channels = in_channels_ / this->group_;
+  const int group_outputs = out_channels_ / this->group_;
+  const Dtype* products = product_tiles_.cpu_data();
+  const Dtype* inputs = input_tiles_.cpu_data();
+  Dtype* weight_diff = transformed_weight_diff_.mutable_cpu_data();
+  for (int e = 0; e < alpha_ * alpha_; ++e) {
+    for (int g = 0; g < this->group_; ++g) {
+      caffe_cpu_gemm<Dtype>(CblasNoTrans, CblasTrans, group_outputs,
+          kernel_channels, num_tiles_, (Dtype)1.,
+          products + (e * out_channels_ + g * group_outputs) * num_tiles_,
+          inputs + (e * in_channels_ + g * kernel_channels) * num_tiles_,
+          (Dtype)1., weight_diff
+          + (e * out_channels_ + g * group_outputs) * kernel_channels);
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::multiply_tiles_diff() {
+  const int kernel_channels = in_channels_ / this->group_;
+  const int group_outputs = out_channels_ / this->group_;
+  const Dtype* weights = transformed_weights_.cpu_data();
+  const Dtype* products = product_tiles_.cpu_data();
+  Dtype* inputs = input_tiles_.mutable_cpu_data();
+  for (int e = 0; e < alpha_ * alpha_; ++e) {
+    for (int g = 0; g < this->group_; ++g) {
+      caffe_cpu_gemm<Dtype>(CblasTrans, CblasNoTrans, kernel_channels,
+          num_tiles_, group_outputs, (Dtype)1.,
+          weights + (e * out_channels_ + g * group_outputs) * kernel_channels,
+          products + (e * out_channels_ + g * group_outputs) * num_tiles_,
+          (Dtype)0.,
+          inputs + (e * in_channels_ + g * kernel_channels) * num_tiles_);
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::transform_input_diff(
+    Dtype* input_diff) {
+  const Dtype* tiles = input_tiles_.cpu_data();
+  const int plane = in_channels_ * num_tiles_;
+  caffe_set(in_channels_ * height_ * width_, Dtype(0), input_diff);
+  Dtype in[kMaxTileSize], out[kMaxTileSize];
+  for (int c = 0; c < in_channels_; ++c) {
+    Dtype* channel = input_diff + c * height_ * width_;
+    for (int p = 0; p < num_tiles_; ++p) {
+      for (int e = 0; e < alpha_ * alpha_; ++e) {
+        in[e] = tiles[e * plane + c * num_tiles_ + p];
+      }
+      TransformTile(&input_transform_[0], true, alpha_, alpha_, in, out);
+      // Neighbouring input tiles overlap by 2 rows or columns.
+      const int y0 = (p / tiles_w_) * tile_ - pad_h_;
+      const int x0 = (p % tiles_w_) * tile_ - pad_w_;
+      for (int y = 0; y < alpha_; ++y) {
+        const int h = y0 + y;
+        if (h < 0 || h >= height_) {
+          continue;
+        }
+        for (int x = 0; x < alpha_; ++x) {
+          const int w = x0 + x;
+          if (w >= 0 && w < width_) {
+            channel[h * width_ + w] += out[y * alpha_ + x];
+          }
+        }
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::Forward_cpu(
+    const vector<Blob<Dtype>*>& bottom, const vector<Blob<Dtype>*>& top) {
+  if (!winograd_) {
+    ConvolutionLayer<Dtype>::Forward_cpu(bottom, top);
+    return;
+  }
+  transform_weights();
+  const Dtype* bias = this->bias_term_ ? this->blobs_[1]->cpu_data() : NULL;
+  for (int i = 0; i < bottom.size(); ++i) {
+    const Dtype* bottom_data = bottom[i]->cpu_data();
+    Dtype* top_data = top[i]->mutable_cpu_data();
+    for (int n = 0; n < this->num_; ++n) {
+      transform_input(bottom_data + n * this->bottom_dim_);
+      multiply_tiles();
+      transform_output(top_data + n * this->top_dim_);
+      if (bias) {
+        this->forward_cpu_bias(top_data + n * this->top_dim_, bias);
+      }
+    }
+  }
+}
+
+template <typename Dtype>
+void WinogradConvolutionLayer<Dtype>::Backward_cpu(
+    const vector<Blob<Dtype>*>& top, const vector<bool>& propagate_down,
+    const vector<Blob<Dtype>*>& bottom) {
+  if (!winograd_) {
+    ConvolutionLayer<Dtype>::Backward_cpu(top, propagate_down, bottom);
+    return;
+  }
+  transform_weights();
+  const bool weight_down = this->param_propagate_down_[0];
+  if (weight_down) {
+    caffe_set(transformed_weight_diff_.count(), Dtype(0),
+        transformed_weight_diff_.mutable_cpu_data());
+  }
+  for (int i = 0; i < top.size(); ++i) {
+    const Dtype* top_diff = top[i]->cpu_diff();
+    const Dtype* bottom_data = bottom[i]->cpu_data();
+    Dtype* bottom_diff = bottom[i]->mutable_cpu_diff();
+    // Bias gradient, if necessary.
+    if (this->bias_term_ && this->param_propagate_down_[1]) {
+      Dtype* bias_diff = this->blobs_[1]->mutable_cpu_diff();
+      for (int n = 0; n < this->num_; ++n) {
+        this->backward_cpu_bias(bias_diff, top_diff + n * this->top_dim_);
+      }
+    }
+    if (!weight_down && !propagate_down[i]) {
+      continue;
+    }
+    for (int n = 0; n < this->num_; ++n) {
+      transform_output_diff(top_diff + n * this->top_dim_);
+      if (weight_down) {
+        transform_input(bottom_data + n * this->bottom_dim_);
+        accumulate_weight_diff();
+      }
+      // The input tiles are overwritten by their diffs.
+      if (propagate_down[i]) {
+        multiply_tiles_diff();
+        transform_input_diff(bottom_diff + n * this->bottom_dim_);
+      }
+    }
+  }
+  if (weight_down) {
+    // Back from the Winograd domain: G^T dU G for every filter.
+    const int num_filters = this->blobs_[0]->count() / 9;
+    const Dtype* transformed_diff = transformed_weight_diff_.cpu_data();
+    Dtype* weight_diff = this->blobs_[0]->mutable_cpu_diff();
+    Dtype in[kMaxTileSize], out[9];
+    for (int f = 0; f < num_filters; ++f) {
+      for (int e = 0; e < alpha_ * alpha_; ++e) {
+        in[e] = transformed_diff[e * num_filters + f];
+      }
+      TransformTile(&filter_transform_[0], true, 3, alpha_, in, out);
+      caffe_axpy(9, Dtype(1), out, weight_diff + f * 9);
+    }
+  }
+}
+
+INSTANTIATE_CLASS(WinogradConvolutionLayer);
+
+}  // namespace caffe
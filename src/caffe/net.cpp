@@ -172,7 +172,8 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
     for (int param_id = 0; param_id < num_param_blobs; ++param_id) {
       const ParamSpec* param_spec = (param_id < param_size) ?
           &layer_param.param(param_id) : &default_param_spec;
-      const bool param_need_backward = param_spec->lr_mult() != 0;
+      const bool param_need_backward = param_spec->lr_mult() != 0 &&
+          !layers_[layer_id]->FixedParam(param_id);
       need_backward |= param_need_backward;
       layers_[layer_id]->set_param_propagate_down(param_id,
                                                   param_need_backward);
@@ -260,7 +261,8 @@ void Net<Dtype>::Init(const NetParameter& in_param) {
       }
       for (int param_id = 0; param_id < layers_[layer_id]->blobs().size();
            ++param_id) {
-        layers_[layer_id]->set_param_propagate_down(param_id, true);
+        layers_[layer_id]->set_param_propagate_down(param_id,
+            !layers_[layer_id]->FixedParam(param_id));
       }
     }
   }
@@ -487,7 +489,11 @@ void Net<Dtype>::AppendParam(const NetParameter& param, const int layer_id,
   ParamSpec default_param_spec;
   const ParamSpec* param_spec = (layer_param.param_size() > param_id) ?
       &layer_param.param(param_id) : &default_param_spec;
-  if (!param_size || !param_name.size() || (param_name.size() &&
+  if (layers_[layer_id]->FixedParam(param_id)) {
+    // Neither learned nor shared: the layer owns it, whatever its name.
+    param_owners_.push_back(-1);
+    learnable_param_ids_.push_back(-1);
+  } else if (!param_size || !param_name.size() || (param_name.size() &&
       param_names_index_.find(param_name) == param_names_index_.end())) {
     // This layer "owns" this parameter blob -- it is either anonymous
     // (i.e., not given a param_name) or explicitly given a name that we
@@ -668,6 +674,7 @@ void Net<Dtype>::ForwardDebugInfo(const int layer_id) {
   }
   for (int param_id = 0; param_id < layers_[layer_id]->blobs().size();
        ++param_id) {
+    if (layers_[layer_id]->FixedParam(param_id)) { continue; }
     const Blob<Dtype>& blob = *layers_[layer_id]->blobs()[param_id];
     const int net_param_id = param_id_vecs_[layer_id][param_id];
     const string& blob_name = param_display_names_[net_param_id];
@@ -754,6 +761,7 @@ void Net<Dtype>::ShareTrainedLayersWith(const Net* other) {
     CHECK_EQ(target_blobs.size(), source_layer->blobs().size())
         << "Incompatible number of blobs for layer " << source_layer_name;
     for (int j = 0; j < target_blobs.size(); ++j) {
+      if (layers_[target_layer_id]->FixedParam(j)) { continue; }
       Blob<Dtype>* source_blob = source_layer->blobs()[j].get();
       CHECK(target_blobs[j]->shape() == source_blob->shape())
           << "Cannot share param " << j << " weights from layer '"
@@ -822,6 +830,7 @@ void Net<Dtype>::CopyTrainedLayersFrom(const NetParameter& param) {
     CHECK_EQ(target_blobs.size(), source_layer.blobs_size())
         << "Incompatible number of blobs for layer " << source_layer_name;
     for (int j = 0; j < target_blobs.size(); ++j) {
+      if (layers_[target_layer_id]->FixedParam(j)) { continue; }
       if (!target_blobs[j]->ShapeEquals(source_layer.blobs(j))) {
         Blob<Dtype> source_blob;
         const bool kReshape = true;
@@ -884,6 +893,7 @@ void Net<Dtype>::CopyTrainedLayersFromHDF5(const string trained_filename) {
     CHECK_LE(num_source_params, target_blobs.size())
         << "Incompatible number of blobs for layer " << source_layer_name;
     for (int j = 0; j < target_blobs.size(); ++j) {
+      if (layers_[target_layer_id]->FixedParam(j)) { continue; }
       ostringstream oss;
       oss << j;
       string dataset_name = oss.str();
@@ -953,6 +963,7 @@ void Net<Dtype>::ToHDF5(const string& filename, bool write_diff) const {
     }
     int num_params = layers_[layer_id]->blobs().size();
     for (int param_id = 0; param_id < num_params; ++param_id) {
+      if (layers_[layer_id]->FixedParam(param_id)) { continue; }
       ostringstream dataset_name;
       dataset_name << param_id;
       const int net_param_id = param_id_vecs_[layer_id][param_id];
@@ -990,10 +1001,20 @@ template <typename Dtype>
 void Net<Dtype>::ClearParamDiffs() {
   for (int i = 0; i < learnable_params_.size(); ++i) {
     Blob<Dtype>* blob = learnable_params_[i];
+    RowSet* rows = blob->diff_rows();
     switch (Caffe::mode()) {
     case Caffe::CPU:
-      caffe_set(blob->count(), static_cast<Dtype>(0),
-                blob->mutable_cpu_diff());
+      if (rows && !rows->all()) {
+        const int dim = blob->count(1);
+        Dtype* diff = blob->mutable_cpu_diff();
+        for (int j = 0; j < rows->rows().size(); ++j) {
+          caffe_set(dim, static_cast<Dtype>(0),
+                    diff + size_t(rows->rows()[j]) * dim);
+        }
+      } else {
+        caffe_set(blob->count(), static_cast<Dtype>(0),
+                  blob->mutable_cpu_diff());
+      }
       break;
     case Caffe::GPU:
 #ifndef CPU_ONLY
@@ -1004,6 +1025,9 @@ void Net<Dtype>::ClearParamDiffs() {
 #endif
       break;
     }
+    if (rows) {
+      rows->Clear();
+    }
   }
 }
 
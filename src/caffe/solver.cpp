@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 
+#include "caffe/layers/base_data_layer.hpp"
 #include "caffe/solver.hpp"
 #include "caffe/util/format.hpp"
 #include "caffe/util/hdf5.hpp"
@@ -247,6 +248,7 @@ void Solver<Dtype>::Step(int iters) {
               << result_vec[k] << loss_msg_stream.str();
         }
       }
+      DisplayPrefetchStats();
     }
     for (int i = 0; i < callbacks_.size(); ++i) {
       callbacks_[i]->on_gradients_ready();
@@ -292,6 +294,7 @@ void Solver<Dtype>::Solve(const char* resume_file) {
   // should be given, and we will just provide dummy vecs.
   int start_iter = iter_;
   Step(param_.max_iter() - iter_);
+  CatchUpParams();
   // If we haven't already, save a snapshot after optimization, unless
   // overridden by setting snapshot_after_train := false
   if (param_.snapshot_after_train()
@@ -323,8 +326,30 @@ void Solver<Dtype>::Solve(const char* resume_file) {
   LOG(INFO) << "Optimization Done.";
 }
 
+template <typename Dtype>
+void Solver<Dtype>::DisplayPrefetchStats() {
+  const vector<shared_ptr<Layer<Dtype> > >& layers = net_->layers();
+  for (int i = 0; i < layers.size(); ++i) {
+    BasePrefetchingDataLayer<Dtype>* data_layer =
+        dynamic_cast<BasePrefetchingDataLayer<Dtype>*>(layers[i].get());
+    if (!data_layer) {
+      continue;
+    }
+    const PrefetchStats stats = data_layer->prefetch_stats();
+    data_layer->ResetPrefetchStats();
+    LOG_IF(INFO, Caffe::root_solver()) << "    Data layer "
+        << net_->layer_names()[i] << ": waited " << stats.wait_ms
+        << " ms in " << stats.starved << " of " << stats.forwards
+        << " forwards, " << stats.mean_ready << " batches ready on average"
+        << " of " << stats.depth << "; load_batch p50/p90/p99 = "
+        << stats.load_ms_p50 << "/" << stats.load_ms_p90 << "/"
+        << stats.load_ms_p99 << " ms";
+  }
+}
+
 template <typename Dtype>
 void Solver<Dtype>::TestAll() {
+  CatchUpParams();
   for (int test_net_id = 0;
        test_net_id < test_nets_.size() && !requested_early_exit_;
        ++test_net_id) {
@@ -411,6 +436,7 @@ void Solver<Dtype>::Test(const int test_net_id) {
 template <typename Dtype>
 void Solver<Dtype>::Snapshot() {
   CHECK(Caffe::root_solver());
+  CatchUpParams();
   string model_filename;
   switch (param_.snapshot_format()) {
   case caffe::SolverParameter_SnapshotFormat_BINARYPROTO:
@@ -75,6 +75,9 @@ void SGDSolver<Dtype>::PreSolve() {
     update_.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>(shape)));
     temp_.push_back(shared_ptr<Blob<Dtype> >(new Blob<Dtype>(shape)));
   }
+  row_iters_.clear();
+  row_iters_.resize(net_params.size());
+  last_rate_ = 0;
 }
 
 template <typename Dtype>
@@ -102,12 +105,23 @@ template <typename Dtype>
 void SGDSolver<Dtype>::ApplyUpdate() {
   CHECK(Caffe::root_solver());
   Dtype rate = GetLearningRate();
+  last_rate_ = rate;
   if (this->param_.display() && this->iter_ % this->param_.display() == 0) {
     LOG(INFO) << "Iteration " << this->iter_ << ", lr = " << rate;
   }
   ClipGradients();
   for (int param_id = 0; param_id < this->net_->learnable_params().size();
        ++param_id) {
+    RowSet* rows = this->net_->learnable_params()[param_id]->diff_rows();
+    if (rows && !rows->all()) {
+      if (Caffe::mode() == Caffe::CPU && SupportsSparseUpdate() &&
+          this->param_.regularization_type() == "L2") {
+        SparseUpdate(param_id, rate);
+        continue;
+      }
+      // The dense update writes every row of the diff.
+      rows->MarkAll();
+    }
     Normalize(param_id);
     Regularize(param_id);
     ComputeUpdateValue(param_id, rate);
@@ -115,6 +129,101 @@ void SGDSolver<Dtype>::ApplyUpdate() {
   this->net_->Update();
 }
 
+template <typename Dtype>
+void SGDSolver<Dtype>::SparseUpdate(int param_id, Dtype rate) {
+  Blob<Dtype>* param = this->net_->learnable_params()[param_id];
+  const vector<int>& rows = param->diff_rows()->rows();
+  const int dim = param->count(1);
+  const Dtype momentum = this->param_.momentum();
+  const Dtype local_rate = rate * this->net_->params_lr()[param_id];
+  const Dtype local_decay = this->param_.weight_decay()
+      * this->net_->params_weight_decay()[param_id];
+  const Dtype accum_normalization = Dtype(1.) / this->param_.iter_size();
+  vector<int>& row_iters = row_iters_[param_id];
+  if (row_iters.size() != param->shape(0)) {
+    row_iters.assign(param->shape(0), this->iter_);
+  }
+  Dtype* data = param->mutable_cpu_data();
+  Dtype* diff = param->mutable_cpu_diff();
+  Dtype* history = history_[param_id]->mutable_cpu_data();
+  for (int i = 0; i < rows.size(); ++i) {
+    const int row = rows[i];
+    Dtype* row_data = data + size_t(row) * dim;
+    Dtype* row_diff = diff + size_t(row) * dim;
+    Dtype* row_history = history + size_t(row) * dim;
+    CatchUpRow(param_id, row, rate);
+    row_iters[row] = this->iter_ + 1;
+    // This iteration's step, as Normalize, Regularize and ComputeUpdateValue
+    // take it for a dense param.
+    if (this->param_.iter_size() > 1) {
+      caffe_scal(dim, accum_normalization, row_diff);
+    }
+    if (local_decay) {
+      caffe_axpy(dim, local_decay, row_data, row_diff);
+    }
+    caffe_cpu_axpby(dim, local_rate, row_diff, momentum, row_history);
+    caffe_copy(dim, row_history, row_diff);
+  }
+}
+
+template <typename Dtype>
+void SGDSolver<Dtype>::CatchUpRow(int param_id, int row, Dtype rate) {
+  vector<int>& row_iters = row_iters_[param_id];
+  int skipped = this->iter_ - row_iters[row];
+  row_iters[row] = this->iter_;
+  const double momentum = this->param_.momentum();
+  const double decay = double(rate) * this->net_->params_lr()[param_id]
+      * this->param_.weight_decay()
+      * this->net_->params_weight_decay()[param_id];
+  if (skipped <= 0 || (momentum == 0 && decay == 0)) {
+    return;
+  }
+  // With a zero gradient, one step maps (data, history) through
+  //   history' = momentum * history + local_rate * local_decay * data
+  //   data'    = data - history'
+  // i.e. through the 2x2 matrix step below, which skipped steps are raised to.
+  const double step[4] = { 1 - decay, -momentum, decay, momentum };
+  double power[4] = { 1, 0, 0, 1 };
+  double base[4] = { step[0], step[1], step[2], step[3] };
+  for (; skipped > 0; skipped >>= 1) {
+    if (skipped & 1) {
+      const double p[4] = { power[0], power[1], power[2], power[3] };
+      power[0] = base[0] * p[0] + base[1] * p[2];
+      power[1] = base[0] * p[1] + base[1] * p[3];
+      power[2] = base[2] * p[0] + base[3] * p[2];
+      power[3] = base[2] * p[1] + base[3] * p[3];
+    }
+    const double b[4] = { base[0], base[1], base[2], base[3] };
+    base[0] = b[0] * b[0] + b[1] * b[2];
+    base[1] = b[0] * b[1] + b[1] * b[3];
+    base[2] = b[2] * b[0] + b[3] * b[2];
+    base[3] = b[2] * b[1] + b[3] * b[3];
+  }
+  Blob<Dtype>* param = this->net_->learnable_params()[param_id];
+  const int dim = param->count(1);
+  Dtype* row_data = param->mutable_cpu_data() + size_t(row) * dim;
+  Dtype* row_history =
+      history_[param_id]->mutable_cpu_data() + size_t(row) * dim;
+  for (int j = 0; j < dim; ++j) {
+    const double w = row_data[j];
+    const double v = row_history[j];
+    row_data[j] = power[0] * w + power[1] * v;
+    row_history[j] = power[2] * w + power[3] * v;
+  }
+}
+
+template <typename Dtype>
+void SGDSolver<Dtype>::CatchUpParams() {
+  for (int param_id = 0; param_id < row_iters_.size(); ++param_id) {
+    const vector<int>& row_iters = row_iters_[param_id];
+    for (int row = 0; row < row_iters.size(); ++row) {
+      if (row_iters[row] < this->iter_) {
+        CatchUpRow(param_id, row, last_rate_);
+      }
+    }
+  }
+}
+
 template <typename Dtype>
 void SGDSolver<Dtype>::Normalize(int param_id) {
   if (this->param_.iter_size() == 1) { return; }
@@ -307,6 +416,8 @@ void SGDSolver<Dtype>::RestoreSolverStateFromBinaryProto(
   SolverState state;
   ReadProtoFromBinaryFile(state_file, &state);
   this->iter_ = state.iter();
+  // Snapshots hold caught up params: every row resumes at iter_.
+  row_iters_.assign(row_iters_.size(), vector<int>());
   if (state.has_learned_net()) {
     NetParameter net_param;
     ReadNetParamsFromBinaryFileOrDie(state.learned_net().c_str(), &net_param);
@@ -326,6 +437,7 @@ void SGDSolver<Dtype>::RestoreSolverStateFromHDF5(const string& state_file) {
   hid_t file_hid = H5Fopen(state_file.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
   CHECK_GE(file_hid, 0) << "Couldn't open solver state file " << state_file;
   this->iter_ = hdf5_load_int(file_hid, "iter");
+  row_iters_.assign(row_iters_.size(), vector<int>());
   if (H5LTfind_dataset(file_hid, "learned_net")) {
     string learned_net = hdf5_load_string(file_hid, "learned_net");
     this->net_->CopyTrainedLayersFrom(learned_net);
@@ -0,0 +1,174 @@
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layers/base_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+static const int kBatchSize = 4;
+
+// Numbers its batches, and loads each one only once the test releases it,
+// so that the test decides which Forward finds no batch ready.
+template <typename Dtype>
+class GatedDataLayer : public BasePrefetchingDataLayer<Dtype> {
+ public:
+  explicit GatedDataLayer(const LayerParameter& param)
+      : BasePrefetchingDataLayer<Dtype>(param), loaded_(0), released_(0) {}
+  virtual ~GatedDataLayer() { this->StopInternalThread(); }
+  virtual void DataLayerSetUp(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+    vector<int> shape(1, kBatchSize);
+    top[0]->Reshape(shape);
+    top[1]->Reshape(shape);
+    for (int i = 0; i < this->prefetch_.size(); ++i) {
+      this->prefetch_[i]->data_.Reshape(shape);
+      this->prefetch_[i]->label_.Reshape(shape);
+    }
+  }
+  virtual inline const char* type() const { return "GatedData"; }
+
+  // Lets the prefetch thread load num more batches.
+  void Release(int num) {
+    boost::mutex::scoped_lock lock(mutex_);
+    released_ += num;
+    released_cond_.notify_all();
+  }
+
+  // Waits until num batches are ready.
+  void WaitForReady(int num) {
+    while (this->prefetch_full_.size() < num) {
+      boost::this_thread::yield();
+    }
+  }
+
+  // Runs a Forward that finds no batch ready: the next batch is released
+  // only once Forward waits for it.
+  void StarvedForward(const vector<Blob<Dtype>*>& bottom,
+      const vector<Blob<Dtype>*>& top) {
+    const int starved = this->prefetch_stats().starved;
+    boost::thread forward(&GatedDataLayer::RunForward, this, Caffe::mode(),
+        &bottom, &top);
+    while (this->prefetch_stats().starved == starved) {
+      boost::this_thread::yield();
+    }
+    Release(1);
+    forward.join();
+  }
+
+ protected:
+  virtual void load_batch(Batch<Dtype>* batch) {
+    int index;
+    {
+      boost::mutex::scoped_lock lock(mutex_);
+      while (loaded_ == released_) {
+        released_cond_.wait(lock);
+      }
+      index = loaded_++;
+    }
+    caffe_set(kBatchSize, Dtype(index), batch->data_.mutable_cpu_data());
+    caffe_set(kBatchSize, Dtype(index), batch->label_.mutable_cpu_data());
+  }
+
+  void RunForward(Caffe::Brew mode, const vector<Blob<Dtype>*>* bottom,
+      const vector<Blob<Dtype>*>* top) {
+    Caffe::set_mode(mode);
+    this->Forward(*bottom, *top);
+  }
+
+  boost::mutex mutex_;
+  boost::condition_variable released_cond_;
+  int loaded_;
+  int released_;
+};
+
+template <typename TypeParam>
+class BaseDataLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  BaseDataLayerTest()
+      : blob_top_data_(new Blob<Dtype>()),
+        blob_top_label_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+  }
+  virtual ~BaseDataLayerTest() {
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  Blob<Dtype>* const blob_top_data_;
+  Blob<Dtype>* const blob_top_label_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(BaseDataLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(BaseDataLayerTest, TestPrefetchGrowsWhenStarved) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter param;
+  param.mutable_data_param()->set_prefetch_batches(1);
+  param.mutable_data_param()->set_max_prefetch(3);
+  GatedDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  const int num_starved = 5;
+  for (int iter = 0; iter < num_starved; ++iter) {
+    layer.StarvedForward(this->blob_bottom_vec_, this->blob_top_vec_);
+    // Batches arrive in order, whatever the depth.
+    for (int i = 0; i < kBatchSize; ++i) {
+      EXPECT_EQ(iter, this->blob_top_data_->cpu_data()[i]);
+      EXPECT_EQ(iter, this->blob_top_label_->cpu_data()[i]);
+    }
+    // Every starved Forward but the first adds a batch, up to max_prefetch.
+    EXPECT_EQ(std::min(1 + iter, 3), layer.prefetch_stats().depth);
+  }
+  PrefetchStats stats = layer.prefetch_stats();
+  EXPECT_EQ(num_starved, stats.forwards);
+  EXPECT_EQ(num_starved, stats.starved);
+  EXPECT_EQ(num_starved, stats.loads);
+  EXPECT_EQ(0, stats.mean_ready);
+  EXPECT_LE(stats.load_ms_p50, stats.load_ms_p90);
+  EXPECT_LE(stats.load_ms_p90, stats.load_ms_p99);
+  // With the batches the tops do not hold ready, Forward does not wait and
+  // the queue keeps its depth.
+  layer.Release(2);
+  layer.WaitForReady(2);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(num_starved, this->blob_top_data_->cpu_data()[0]);
+  stats = layer.prefetch_stats();
+  EXPECT_EQ(num_starved + 1, stats.forwards);
+  EXPECT_EQ(num_starved, stats.starved);
+  EXPECT_EQ(3, stats.depth);
+  layer.ResetPrefetchStats();
+  stats = layer.prefetch_stats();
+  EXPECT_EQ(0, stats.forwards);
+  EXPECT_EQ(0, stats.starved);
+  EXPECT_EQ(3, stats.depth);
+}
+
+TYPED_TEST(BaseDataLayerTest, TestFixedPrefetchDepth) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter param;
+  param.mutable_data_param()->set_prefetch_batches(2);
+  GatedDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int iter = 0; iter < 4; ++iter) {
+    layer.StarvedForward(this->blob_bottom_vec_, this->blob_top_vec_);
+    EXPECT_EQ(iter, this->blob_top_data_->cpu_data()[0]);
+  }
+  EXPECT_EQ(4, layer.prefetch_stats().starved);
+  EXPECT_EQ(2, layer.prefetch_stats().depth);
+}
+
+}  // namespace caffe
@@ -6,6 +6,7 @@
 #include "caffe/common.hpp"
 #include "caffe/filler.hpp"
 #include "caffe/layers/conv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
 
 #ifdef USE_CUDNN
 #include "caffe/layers/cudnn_conv_layer.hpp"
@@ -264,6 +265,37 @@ TYPED_TEST(ConvolutionLayerTest, TestSimpleConvolution) {
   }
 }
 
+TYPED_TEST(ConvolutionLayerTest, TestFullWidthConvolution) {
+  typedef typename TypeParam::Dtype Dtype;
+  // A text convolution: the kernel spans the embedding width.
+  Blob<Dtype> bottom(2, 2, 7, 5);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  vector<Blob<Dtype>*> bottom_vec(1, &bottom);
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_h(3);
+  convolution_param->set_kernel_w(5);
+  convolution_param->set_num_output(4);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("constant");
+  convolution_param->mutable_bias_filler()->set_value(0.1);
+  ConvolutionLayer<Dtype> layer(layer_param);
+  layer.SetUp(bottom_vec, this->blob_top_vec_);
+  EXPECT_EQ(5, this->blob_top_->height());
+  EXPECT_EQ(1, this->blob_top_->width());
+  layer.Forward(bottom_vec, this->blob_top_vec_);
+  caffe_conv(&bottom, convolution_param, layer.blobs(),
+      this->MakeReferenceTop(this->blob_top_));
+  const Dtype* top_data = this->blob_top_->cpu_data();
+  const Dtype* ref_top_data = this->ref_blob_top_->cpu_data();
+  for (int i = 0; i < this->blob_top_->count(); ++i) {
+    EXPECT_NEAR(top_data[i], ref_top_data[i], 1e-4);
+  }
+}
+
 TYPED_TEST(ConvolutionLayerTest, TestDilatedConvolution) {
   typedef typename TypeParam::Dtype Dtype;
   vector<int> bottom_shape;
@@ -811,6 +843,190 @@ TYPED_TEST(ConvolutionLayerTest, TestGradientGroup) {
       this->blob_top_vec_);
 }
 
+TYPED_TEST(ConvolutionLayerTest, TestFullWidthGradientGroup) {
+  typedef typename TypeParam::Dtype Dtype;
+  Blob<Dtype> bottom(2, 2, 5, 4);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  vector<Blob<Dtype>*> bottom_vec(1, &bottom);
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->set_kernel_h(2);
+  convolution_param->set_kernel_w(4);
+  convolution_param->set_num_output(4);
+  convolution_param->set_group(2);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, bottom_vec, this->blob_top_vec_);
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestBatchGemmMatchesImages) {
+  typedef typename TypeParam::Dtype Dtype;
+  Blob<Dtype> bottom(7, 4, 5, 5);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  vector<Blob<Dtype>*> bottom_vec(1, &bottom);
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_pad(1);
+  convolution_param->set_num_output(6);
+  convolution_param->set_group(2);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> reference(layer_param);
+  Blob<Dtype> ref_top;
+  vector<Blob<Dtype>*> ref_top_vec(1, &ref_top);
+  reference.SetUp(bottom_vec, ref_top_vec);
+  reference.Forward(bottom_vec, ref_top_vec);
+  filler.Fill(&ref_top);
+  caffe_copy(ref_top.count(), ref_top.cpu_data(), ref_top.mutable_cpu_diff());
+  reference.Backward(ref_top_vec, vector<bool>(1, false), bottom_vec);
+  reference.Forward(bottom_vec, ref_top_vec);
+
+  // Chunks of 3 images: columns and outputs of (36 + 6) x 25 values each.
+  convolution_param->set_batch_gemm(true);
+  convolution_param->set_batch_gemm_max_bytes(3 * 42 * 25 * sizeof(Dtype));
+  // The columns go straight into the chunk buffer, through both im2cols.
+  for (int nd = 0; nd < 2; ++nd) {
+    convolution_param->set_force_nd_im2col(nd);
+    ConvolutionLayer<Dtype> layer(layer_param);
+    Blob<Dtype> top;
+    vector<Blob<Dtype>*> top_vec(1, &top);
+    layer.SetUp(bottom_vec, top_vec);
+    for (int i = 0; i < layer.blobs().size(); ++i) {
+      layer.blobs()[i]->CopyFrom(*reference.blobs()[i]);
+      caffe_set(layer.blobs()[i]->count(), Dtype(0),
+          layer.blobs()[i]->mutable_cpu_diff());
+    }
+    layer.Forward(bottom_vec, top_vec);
+    for (int i = 0; i < top.count(); ++i) {
+      EXPECT_NEAR(ref_top.cpu_data()[i], top.cpu_data()[i], 1e-4);
+    }
+    caffe_copy(top.count(), ref_top.cpu_diff(), top.mutable_cpu_diff());
+    layer.Backward(top_vec, vector<bool>(1, false), bottom_vec);
+    for (int b = 0; b < layer.blobs().size(); ++b) {
+      for (int i = 0; i < layer.blobs()[b]->count(); ++i) {
+        EXPECT_NEAR(reference.blobs()[b]->cpu_diff()[i],
+            layer.blobs()[b]->cpu_diff()[i], 1e-4);
+      }
+    }
+  }
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestGradientBatchGemm) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  this->blob_bottom_vec_.push_back(this->blob_bottom_2_);
+  this->blob_top_vec_.push_back(this->blob_top_2_);
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(2);
+  convolution_param->set_num_output(2);
+  convolution_param->set_batch_gemm(true);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestGradientParallelWorkers) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  this->blob_bottom_vec_.push_back(this->blob_bottom_2_);
+  this->blob_top_vec_.push_back(this->blob_top_2_);
+  convolution_param->add_kernel_size(3);
+  convolution_param->add_stride(2);
+  convolution_param->set_num_output(2);
+  convolution_param->set_num_workers(3);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> layer(layer_param);
+  GradientChecker<Dtype> checker(1e-2, 1e-3);
+  checker.CheckGradientExhaustive(&layer, this->blob_bottom_vec_,
+      this->blob_top_vec_);
+}
+
+TYPED_TEST(ConvolutionLayerTest, TestParallelWorkersMatchSerial) {
+  typedef typename TypeParam::Dtype Dtype;
+  // More images than workers, and not a multiple of their number.
+  Blob<Dtype> bottom(7, 3, 6, 4);
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(&bottom);
+  vector<Blob<Dtype>*> bottom_vec(1, &bottom);
+  LayerParameter layer_param;
+  ConvolutionParameter* convolution_param =
+      layer_param.mutable_convolution_param();
+  convolution_param->add_kernel_size(3);
+  convolution_param->set_num_output(4);
+  convolution_param->mutable_weight_filler()->set_type("gaussian");
+  convolution_param->mutable_bias_filler()->set_type("gaussian");
+  ConvolutionLayer<Dtype> serial(layer_param);
+  Blob<Dtype> serial_top;
+  vector<Blob<Dtype>*> serial_top_vec(1, &serial_top);
+  serial.SetUp(bottom_vec, serial_top_vec);
+  filler.Fill(&serial_top);
+  caffe_copy(serial_top.count(), serial_top.cpu_data(),
+      serial_top.mutable_cpu_diff());
+  serial.Forward(bottom_vec, serial_top_vec);
+  serial.Backward(serial_top_vec, vector<bool>(1, true), bottom_vec);
+  Blob<Dtype> serial_bottom_diff;
+  serial_bottom_diff.CopyFrom(bottom, true, true);
+
+  // The weight diff is summed in the same order on every run.
+  convolution_param->set_num_workers(3);
+  vector<Dtype> first_weight_diff;
+  for (int run = 0; run < 2; ++run) {
+    ConvolutionLayer<Dtype> parallel(layer_param);
+    Blob<Dtype> top;
+    vector<Blob<Dtype>*> top_vec(1, &top);
+    parallel.SetUp(bottom_vec, top_vec);
+    for (int i = 0; i < parallel.blobs().size(); ++i) {
+      parallel.blobs()[i]->CopyFrom(*serial.blobs()[i]);
+      caffe_set(parallel.blobs()[i]->count(), Dtype(0),
+          parallel.blobs()[i]->mutable_cpu_diff());
+    }
+    parallel.Forward(bottom_vec, top_vec);
+    for (int i = 0; i < top.count(); ++i) {
+      EXPECT_NEAR(serial_top.cpu_data()[i], top.cpu_data()[i], 1e-4);
+    }
+    caffe_copy(top.count(), serial_top.cpu_diff(), top.mutable_cpu_diff());
+    parallel.Backward(top_vec, vector<bool>(1, true), bottom_vec);
+    for (int i = 0; i < bottom.count(); ++i) {
+      EXPECT_NEAR(serial_bottom_diff.cpu_diff()[i], bottom.cpu_diff()[i],
+          1e-4);
+    }
+    for (int b = 0; b < parallel.blobs().size(); ++b) {
+      const Blob<Dtype>& expected = *serial.blobs()[b];
+      const Blob<Dtype>& actual = *parallel.blobs()[b];
+      for (int i = 0; i < expected.count(); ++i) {
+        EXPECT_NEAR(expected.cpu_diff()[i], actual.cpu_diff()[i], 1e-4);
+      }
+    }
+    const Dtype* weight_diff = parallel.blobs()[0]->cpu_diff();
+    if (run == 0) {
+      first_weight_diff.assign(weight_diff,
+          weight_diff + parallel.blobs()[0]->count());
+    } else {
+      for (int i = 0; i < first_weight_diff.size(); ++i) {
+        EXPECT_EQ(first_weight_diff[i], weight_diff[i]);
+      }
+    }
+  }
+}
+
 #ifdef USE_CUDNN
 
 template <typename Dtype>
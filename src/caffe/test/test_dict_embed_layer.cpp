@@ -0,0 +1,309 @@
+#include <fstream>  // NOLINT(readability/streams)
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "google/protobuf/text_format.h"
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/layers/dict_embed_layer.hpp"
+#include "caffe/net.hpp"
+#include "caffe/util/embedding_dict.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class DictEmbedLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+ protected:
+  DictEmbedLayerTest()
+      : blob_bottom_(new Blob<Dtype>(4, 1, 3, 1)),
+        blob_top_(new Blob<Dtype>()),
+        kInputDim(10), kNumOutput(128) {
+    blob_bottom_vec_.push_back(blob_bottom_);
+    blob_top_vec_.push_back(blob_top_);
+  }
+  virtual void SetUp() {
+    table_.resize(kInputDim * kNumOutput);
+    for (int i = 0; i < table_.size(); ++i) {
+      table_[i] = i / Dtype(100);
+    }
+    MakeTempFilename(&text_dict_);
+    std::ofstream out(text_dict_.c_str());
+    for (int i = 0; i < table_.size(); ++i) {
+      out << table_[i] << " ";
+    }
+    out.close();
+    MakeTempFilename(&binary_dict_);
+    EmbeddingDict::Write(binary_dict_, kInputDim, kNumOutput, &table_[0]);
+    for (int i = 0; i < blob_bottom_->count(); ++i) {
+      blob_bottom_->mutable_cpu_data()[i] = caffe_rng_rand() % kInputDim;
+    }
+  }
+  virtual ~DictEmbedLayerTest() { delete blob_bottom_; delete blob_top_; }
+
+  void CheckForward(const string& dic_source, bool set_shape = true,
+      bool frozen = false) {
+    LayerParameter layer_param;
+    DictEmbedParameter* embed_param = layer_param.mutable_dict_embed_param();
+    if (set_shape) {
+      embed_param->set_num_output(kNumOutput);
+      embed_param->set_input_dim(kInputDim);
+    }
+    embed_param->set_bias_term(false);
+    embed_param->set_dic_source(dic_source);
+    embed_param->set_frozen(frozen);
+    shared_ptr<DictEmbedLayer<Dtype> > layer(
+        new DictEmbedLayer<Dtype>(layer_param));
+    layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    ASSERT_EQ(1, layer->blobs().size());
+    EXPECT_EQ(frozen, layer->FixedParam(0));
+    ASSERT_EQ(5, blob_top_->num_axes());
+    EXPECT_EQ(kNumOutput, blob_top_->shape(4));
+    layer->Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* top = blob_top_->cpu_data();
+    for (int n = 0; n < blob_bottom_->count(); ++n) {
+      const int index = blob_bottom_->cpu_data()[n];
+      for (int j = 0; j < kNumOutput; ++j) {
+        // Frozen text dicts are read as float.
+        EXPECT_NEAR(table_[index * kNumOutput + j], top[n * kNumOutput + j],
+            1e-5);
+      }
+    }
+  }
+
+  // A net looking up row 3 of the binary dict, with a weight lr_mult of 1
+  // and a bias one of 2.
+  shared_ptr<Net<Dtype> > MakeNet(bool frozen) {
+    std::ostringstream proto;
+    proto <<
+        "name: 'DictEmbedNet' "
+        "layer { "
+        "  name: 'data' "
+        "  type: 'DummyData' "
+        "  top: 'index' "
+        "  dummy_data_param { "
+        "    data_filler { type: 'constant' value: 3 } "
+        "    shape { dim: 2 } "
+        "  } "
+        "} "
+        "layer { "
+        "  name: 'embed' "
+        "  type: 'DictEmbed' "
+        "  bottom: 'index' "
+        "  top: 'embed' "
+        "  param { lr_mult: 1 } "
+        "  param { lr_mult: 2 } "
+        "  dict_embed_param { "
+        "    dic_source: '" << binary_dict_ << "' "
+        "    bias_filler { type: 'gaussian' } "
+        "    frozen: " << (frozen ? "true" : "false") <<
+        "  } "
+        "} ";
+    NetParameter param;
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto.str(), &param));
+    return shared_ptr<Net<Dtype> >(new Net<Dtype>(param));
+  }
+
+  Blob<Dtype>* const blob_bottom_;
+  Blob<Dtype>* const blob_top_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+  const int kInputDim;
+  const int kNumOutput;
+  vector<Dtype> table_;
+  string text_dict_;
+  string binary_dict_;
+};
+
+TYPED_TEST_CASE(DictEmbedLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(DictEmbedLayerTest, TestForwardTextDict) {
+  this->CheckForward(this->text_dict_);
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestForwardBinaryDict) {
+  this->CheckForward(this->binary_dict_);
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestForwardBinaryDictShape) {
+  this->CheckForward(this->binary_dict_, false);
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestForwardFrozenTextDict) {
+  this->CheckForward(this->text_dict_, true, true);
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestForwardFrozenBinaryDict) {
+  this->CheckForward(this->binary_dict_, false, true);
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestFrozenSharedWithBias) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  DictEmbedParameter* embed_param = layer_param.mutable_dict_embed_param();
+  embed_param->set_dic_source(this->binary_dict_);
+  embed_param->set_frozen(true);
+  DictEmbedLayer<Dtype> train_layer(layer_param);
+  train_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  DictEmbedLayer<Dtype> test_layer(layer_param);
+  test_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // The table keeps its place, but only the bias is learned.
+  ASSERT_EQ(2, train_layer.blobs().size());
+  EXPECT_TRUE(train_layer.FixedParam(0));
+  EXPECT_FALSE(train_layer.param_propagate_down(0));
+  EXPECT_EQ(this->kInputDim * this->kNumOutput,
+      train_layer.blobs()[0]->count());
+  EXPECT_EQ(this->kNumOutput, train_layer.blobs()[1]->count());
+  // Both layers hold the process-wide table.
+  EXPECT_EQ(EmbeddingDict::GetShared(this->binary_dict_).use_count(), 3);
+  caffe_rng_gaussian(this->blob_top_->count(), Dtype(0), Dtype(1),
+      this->blob_top_->mutable_cpu_diff());
+  vector<bool> propagate_down(1, false);
+  train_layer.Backward(this->blob_top_vec_, propagate_down,
+      this->blob_bottom_vec_);
+  for (int j = 0; j < this->kNumOutput; ++j) {
+    Dtype expected = 0;
+    for (int n = 0; n < this->blob_bottom_->count(); ++n) {
+      expected += this->blob_top_->cpu_diff()[n * this->kNumOutput + j];
+    }
+    EXPECT_NEAR(expected, train_layer.blobs()[1]->cpu_diff()[j], 1e-4);
+  }
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestForwardFrozenQuantized) {
+  typedef typename TypeParam::Dtype Dtype;
+  const vector<float> table(this->table_.begin(), this->table_.end());
+  const EmbeddingDict::Type dtypes[2] =
+      { EmbeddingDict::FLOAT16, EmbeddingDict::INT8 };
+  // Half a step of fp16 at the largest value, and of 255 steps over a row.
+  const float errors[2] = { 0.01, 0.003 };
+  for (int i = 0; i < 2; ++i) {
+    string dict_filename;
+    MakeTempFilename(&dict_filename);
+    EmbeddingDict::Write(dict_filename, this->kInputDim, this->kNumOutput,
+        &table[0], dtypes[i]);
+    EXPECT_TRUE(EmbeddingDict::GetShared(dict_filename)->quantized());
+    LayerParameter layer_param;
+    DictEmbedParameter* embed_param = layer_param.mutable_dict_embed_param();
+    embed_param->set_dic_source(dict_filename);
+    embed_param->set_frozen(true);
+    embed_param->mutable_bias_filler()->set_type("gaussian");
+    embed_param->set_num_workers(2);
+    DictEmbedLayer<Dtype> layer(layer_param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* bias = layer.blobs()[1]->cpu_data();
+    const Dtype* top = this->blob_top_->cpu_data();
+    for (int n = 0; n < this->blob_bottom_->count(); ++n) {
+      const int index = this->blob_bottom_->cpu_data()[n];
+      for (int j = 0; j < this->kNumOutput; ++j) {
+        EXPECT_NEAR(table[index * this->kNumOutput + j] + bias[j],
+            top[n * this->kNumOutput + j], errors[i]);
+      }
+    }
+  }
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestWritePermutedQuantized) {
+  const vector<float> table(this->table_.begin(), this->table_.end());
+  const EmbeddingDict::Type dtypes[2] =
+      { EmbeddingDict::FLOAT16, EmbeddingDict::INT8 };
+  vector<int32_t> new_index(this->kInputDim);
+  for (int i = 0; i < this->kInputDim; ++i) {
+    new_index[i] = (3 * i + 1) % this->kInputDim;
+  }
+  for (int i = 0; i < 2; ++i) {
+    string dict_filename, permuted_filename;
+    MakeTempFilename(&dict_filename);
+    MakeTempFilename(&permuted_filename);
+    EmbeddingDict::Write(dict_filename, this->kInputDim, this->kNumOutput,
+        &table[0], dtypes[i]);
+    EmbeddingDict dict(dict_filename);
+    dict.WritePermuted(permuted_filename, new_index);
+    EmbeddingDict permuted(permuted_filename);
+    EXPECT_EQ(dtypes[i], permuted.dtype());
+    EXPECT_EQ(this->kInputDim, permuted.rows());
+    EXPECT_EQ(this->kNumOutput, permuted.dim());
+    // The rows move without being quantized again.
+    vector<float> row(this->kNumOutput), permuted_row(this->kNumOutput);
+    for (int r = 0; r < this->kInputDim; ++r) {
+      dict.CopyRow(r, &row[0]);
+      permuted.CopyRow(new_index[r], &permuted_row[0]);
+      for (int j = 0; j < this->kNumOutput; ++j) {
+        EXPECT_EQ(row[j], permuted_row[j]);
+      }
+    }
+  }
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestForwardWorkersWithBias) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  DictEmbedParameter* embed_param = layer_param.mutable_dict_embed_param();
+  embed_param->set_num_output(this->kNumOutput);
+  embed_param->set_input_dim(this->kInputDim);
+  embed_param->set_dic_source(this->binary_dict_);
+  embed_param->mutable_bias_filler()->set_type("gaussian");
+  embed_param->set_num_workers(3);
+  DictEmbedLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  const Dtype* bias = layer.blobs()[1]->cpu_data();
+  const Dtype* top = this->blob_top_->cpu_data();
+  for (int n = 0; n < this->blob_bottom_->count(); ++n) {
+    const int index = this->blob_bottom_->cpu_data()[n];
+    for (int j = 0; j < this->kNumOutput; ++j) {
+      EXPECT_NEAR(this->table_[index * this->kNumOutput + j] + bias[j],
+          top[n * this->kNumOutput + j], 1e-4);
+    }
+  }
+}
+
+TYPED_TEST(DictEmbedLayerTest, TestCopyTrainedIntoFrozen) {
+  typedef typename TypeParam::Dtype Dtype;
+  shared_ptr<Net<Dtype> > trained_net = this->MakeNet(false);
+  Blob<Dtype>* trained_weight = trained_net->layers()[1]->blobs()[0].get();
+  caffe_set(trained_weight->count(), Dtype(-1),
+      trained_weight->mutable_cpu_data());
+  NetParameter trained;
+  trained_net->ToProto(&trained);
+  shared_ptr<Net<Dtype> > net = this->MakeNet(true);
+  // Only the bias is learned, with the lr_mult of the second param spec.
+  ASSERT_EQ(1, net->learnable_params().size());
+  EXPECT_EQ(this->kNumOutput, net->learnable_params()[0]->count());
+  EXPECT_EQ(2, net->params_lr()[0]);
+  net->CopyTrainedLayersFrom(trained);
+  const vector<shared_ptr<Blob<Dtype> > >& blobs = net->layers()[1]->blobs();
+  const Blob<Dtype>& trained_bias = *trained_net->layers()[1]->blobs()[1];
+  for (int j = 0; j < this->kNumOutput; ++j) {
+    EXPECT_EQ(trained_bias.cpu_data()[j], blobs[1]->cpu_data()[j]);
+  }
+  // The table is still the dict's.
+  net->ForwardPrefilled();
+  const Dtype* top = net->blob_by_name("embed")->cpu_data();
+  for (int j = 0; j < this->kNumOutput; ++j) {
+    EXPECT_NEAR(this->table_[3 * this->kNumOutput + j]
+        + trained_bias.cpu_data()[j], top[j], 1e-4);
+  }
+  // Saved, the frozen table has its shape only, and the net loads back.
+  NetParameter saved;
+  net->ToProto(&saved);
+  const LayerParameter& saved_embed = saved.layer(1);
+  ASSERT_EQ(2, saved_embed.blobs_size());
+  EXPECT_EQ(2, saved_embed.blobs(0).shape().dim_size());
+  EXPECT_EQ(0, saved_embed.blobs(0).data_size()
+      + saved_embed.blobs(0).double_data_size());
+  EXPECT_EQ(this->kNumOutput, saved_embed.blobs(1).data_size()
+      + saved_embed.blobs(1).double_data_size());
+  this->MakeNet(true)->CopyTrainedLayersFrom(saved);
+}
+
+}  // namespace caffe
@@ -1264,4 +1264,161 @@ TYPED_TEST(RMSPropSolverTest, TestSnapshotShare) {
   }
 }
 
+template <typename Dtype>
+class SparseSGDSolverTest : public CPUDeviceTest<Dtype> {
+ protected:
+  shared_ptr<SGDSolver<Dtype> > MakeSolver(bool sparse_gradient,
+      int max_iter = 100, const string& snapshot_prefix = "") {
+    ostringstream proto;
+    if (!snapshot_prefix.empty()) {
+      proto << "snapshot_prefix: '" << snapshot_prefix << "/' ";
+    }
+    proto <<
+       "base_lr: 0.1 "
+       "lr_policy: 'fixed' "
+       "momentum: 0.9 "
+       "weight_decay: 0.05 "
+       "max_iter: " << max_iter << " "
+       "snapshot_after_train: false "
+       "random_seed: 1701 "
+       "net_param { "
+       "  name: 'SparseEmbed' "
+       "  layer { "
+       "    name: 'data' "
+       "    type: 'DummyData' "
+       "    top: 'index' "
+       "    dummy_data_param { "
+       "      data_filler { type: 'constant' value: 0 } "
+       "      shape { dim: 2 } "
+       "    } "
+       "  } "
+       "  layer { "
+       "    name: 'embed' "
+       "    type: 'Embed' "
+       "    bottom: 'index' "
+       "    top: 'embed' "
+       "    embed_param { "
+       "      num_output: 4 "
+       "      input_dim: 5 "
+       "      bias_term: false "
+       "      weight_filler { type: 'gaussian' std: 1 } "
+       "      sparse_gradient: " << (sparse_gradient ? "true" : "false") <<
+       "    } "
+       "  } "
+       "  layer { "
+       "    name: 'loss' "
+       "    type: 'Reduction' "
+       "    bottom: 'embed' "
+       "    top: 'loss' "
+       "    loss_weight: 1 "
+       "    reduction_param { operation: SUM axis: 0 } "
+       "  } "
+       "} ";
+    SolverParameter param;
+    CHECK(google::protobuf::TextFormat::ParseFromString(proto.str(), &param));
+    Caffe::set_random_seed(1701);
+    return shared_ptr<SGDSolver<Dtype> >(new SGDSolver<Dtype>(param));
+  }
+
+  void SetIndices(SGDSolver<Dtype>* solver, int first, int second) {
+    Dtype* index =
+        solver->net()->blob_by_name("index")->mutable_cpu_data();
+    index[0] = first;
+    index[1] = second;
+  }
+
+  void ExpectSameParams(SGDSolver<Dtype>* expected, SGDSolver<Dtype>* actual) {
+    const Blob<Dtype>* expected_weights = expected->net()->learnable_params()[0];
+    const Blob<Dtype>* actual_weights = actual->net()->learnable_params()[0];
+    ASSERT_EQ(expected_weights->count(), actual_weights->count());
+    for (int i = 0; i < expected_weights->count(); ++i) {
+      EXPECT_NEAR(expected_weights->cpu_data()[i],
+          actual_weights->cpu_data()[i], 1e-4) << "weight " << i;
+      EXPECT_NEAR(expected->history()[0]->cpu_data()[i],
+          actual->history()[0]->cpu_data()[i], 1e-4) << "history " << i;
+    }
+  }
+};
+
+TYPED_TEST_CASE(SparseSGDSolverTest, TestDtypes);
+
+TYPED_TEST(SparseSGDSolverTest, TestLazyRowsMatchDense) {
+  typedef TypeParam Dtype;
+  shared_ptr<SGDSolver<Dtype> > dense = this->MakeSolver(false);
+  shared_ptr<SGDSolver<Dtype> > sparse = this->MakeSolver(true);
+  shared_ptr<SGDSolver<Dtype> > solvers[2] = { dense, sparse };
+  // Rows are touched at irregular intervals; row 4 first at iteration 5.
+  // Constant DummyData tops are not refilled, so they can be set here. The
+  // loss is a plain sum, whose gradient does not depend on the weights: the
+  // stale rows a lazy update reads in Forward then do not change the result.
+  // Rows not touched are only caught up by Solve(), tested below.
+  const int kIndices[8][2] =
+      { {0, 1}, {0, 0}, {2, 0}, {0, 0}, {0, 3}, {1, 4}, {2, 0}, {3, 1} };
+  for (int iter = 0; iter < 8; ++iter) {
+    for (int s = 0; s < 2; ++s) {
+      Net<Dtype>* net = solvers[s]->net().get();
+      Dtype* index = net->blob_by_name("index")->mutable_cpu_data();
+      index[0] = kIndices[iter][0];
+      index[1] = kIndices[iter][1];
+      solvers[s]->Step(1);
+    }
+    // A touched row of the lazily updated table is up to date.
+    const Blob<Dtype>* dense_weights = dense->net()->learnable_params()[0];
+    const Blob<Dtype>* sparse_weights = sparse->net()->learnable_params()[0];
+    ASSERT_TRUE(sparse_weights->diff_rows() != NULL);
+    ASSERT_TRUE(dense_weights->diff_rows() == NULL);
+    for (int k = 0; k < 2; ++k) {
+      const int row = kIndices[iter][k];
+      for (int j = 0; j < 4; ++j) {
+        EXPECT_NEAR(dense_weights->cpu_data()[row * 4 + j],
+            sparse_weights->cpu_data()[row * 4 + j], 1e-4)
+            << "iter " << iter << ", row " << row;
+      }
+    }
+  }
+}
+
+TYPED_TEST(SparseSGDSolverTest, TestSolveCatchesUpUntouchedRows) {
+  typedef TypeParam Dtype;
+  shared_ptr<SGDSolver<Dtype> > dense = this->MakeSolver(false, 6);
+  shared_ptr<SGDSolver<Dtype> > sparse = this->MakeSolver(true, 6);
+  // Training touches rows 0 and 1 only.
+  this->SetIndices(dense.get(), 0, 1);
+  this->SetIndices(sparse.get(), 0, 1);
+  dense->Solve();
+  sparse->Solve();
+  this->ExpectSameParams(dense.get(), sparse.get());
+  // A loss over the rows training never touched.
+  this->SetIndices(dense.get(), 3, 4);
+  this->SetIndices(sparse.get(), 3, 4);
+  Dtype dense_loss, sparse_loss;
+  dense->net()->ForwardPrefilled(&dense_loss);
+  sparse->net()->ForwardPrefilled(&sparse_loss);
+  EXPECT_NEAR(dense_loss, sparse_loss, 1e-4);
+}
+
+TYPED_TEST(SparseSGDSolverTest, TestSnapshotResume) {
+  typedef TypeParam Dtype;
+  string snapshot_prefix;
+  MakeTempDir(&snapshot_prefix);
+  shared_ptr<SGDSolver<Dtype> > solver =
+      this->MakeSolver(true, 100, snapshot_prefix);
+  this->SetIndices(solver.get(), 0, 1);
+  solver->Step(3);
+  solver->Snapshot();
+  // The snapshot holds every row as of iteration 3.
+  shared_ptr<SGDSolver<Dtype> > dense = this->MakeSolver(false);
+  this->SetIndices(dense.get(), 0, 1);
+  dense->Step(3);
+  shared_ptr<SGDSolver<Dtype> > resumed = this->MakeSolver(true);
+  resumed->Restore((snapshot_prefix + "/_iter_3.solverstate").c_str());
+  this->ExpectSameParams(dense.get(), resumed.get());
+  // Resuming continues as the uninterrupted run.
+  this->SetIndices(resumed.get(), 2, 1);
+  this->SetIndices(solver.get(), 2, 1);
+  resumed->Step(3);
+  solver->Step(3);
+  this->ExpectSameParams(solver.get(), resumed.get());
+}
+
 }  // namespace caffe
@@ -0,0 +1,231 @@
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/neuron_kernels.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Runs the float kernels of every instruction set the CPU has against
+// double precision references. The ulp bounds of sigmoid and BNLL hold for
+// the SIMD kernels only: the <cmath> ones lose the results below about
+// exp(-88) and exp(-37) respectively.
+class NeuronKernelsTest : public ::testing::Test {
+ protected:
+  NeuronKernelsTest() : level_(simd_level()) {}
+
+  virtual void SetUp() {
+    // A sweep over the whole float range of the functions, denser near 0,
+    // and a length that leaves a tail for every vector width.
+    for (float x = -110.f; x < 95.f; x += 0.00731f) {
+      x_.push_back(x);
+    }
+    for (float x = -1.f; x < 1.f; x += 3.1e-5f) {
+      x_.push_back(x);
+    }
+    x_.push_back(0.f);
+    x_.push_back(-0.f);
+    x_.push_back(std::numeric_limits<float>::min());
+    y_.resize(x_.size());
+  }
+
+  virtual void TearDown() {
+    set_simd_level(level_);
+  }
+
+  // The distance from x to the float nearest to ref, in floats.
+  static int64_t Ulps(float x, double ref) {
+    const float rounded = static_cast<float>(ref);
+    if (x == rounded) {
+      return 0;
+    }
+    return std::abs(Ordered(x) - Ordered(rounded));
+  }
+
+  static int64_t Ordered(float x) {
+    int32_t bits;
+    memcpy(&bits, &x, sizeof(bits));
+    return bits < 0 ? -int64_t(bits & 0x7fffffff) : int64_t(bits);
+  }
+
+  int n() const { return x_.size(); }
+
+  const SimdLevel level_;
+  vector<float> x_;
+  vector<float> y_;
+};
+
+TEST_F(NeuronKernelsTest, TestSimdLevel) {
+  EXPECT_LE(simd_level(), max_simd_level());
+  set_simd_level(SIMD_SCALAR);
+  EXPECT_EQ(SIMD_SCALAR, simd_level());
+  EXPECT_STREQ("scalar", simd_level_name(SIMD_SCALAR));
+}
+
+TEST_F(NeuronKernelsTest, TestExp) {
+  for (int level = 0; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    caffe_cpu_fast_exp(n(), &x_[0], &y_[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_LE(Ulps(y_[i], std::exp(double(x_[i]))), 1)
+          << simd_level_name(simd_level()) << " exp(" << x_[i] << ")";
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestSigmoid) {
+  for (int level = SIMD_SSE2; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    caffe_cpu_sigmoid(n(), &x_[0], &y_[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_LE(Ulps(y_[i], 1. / (1. + std::exp(-double(x_[i])))), 2)
+          << simd_level_name(simd_level()) << " sigmoid(" << x_[i] << ")";
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestTanH) {
+  for (int level = 0; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    caffe_cpu_tanh(n(), &x_[0], &y_[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_LE(Ulps(y_[i], std::tanh(double(x_[i]))), 2)
+          << simd_level_name(simd_level()) << " tanh(" << x_[i] << ")";
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestBNLL) {
+  for (int level = SIMD_SSE2; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    caffe_cpu_bnll(n(), &x_[0], &y_[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_LE(Ulps(y_[i], std::log1p(std::exp(double(x_[i])))), 2)
+          << simd_level_name(simd_level()) << " bnll(" << x_[i] << ")";
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestELU) {
+  const float alpha = 0.5;
+  for (int level = 0; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    caffe_cpu_elu(n(), &x_[0], alpha, &y_[0]);
+    for (int i = 0; i < n(); ++i) {
+      const double x = x_[i];
+      const double expected = x > 0 ? x : alpha * std::expm1(x);
+      EXPECT_NEAR(expected, y_[i],
+          std::max(1e-7, 2.4e-7 * std::fabs(expected)))
+          << simd_level_name(simd_level()) << " elu(" << x_[i] << ")";
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestReLU) {
+  for (int level = 0; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    caffe_cpu_relu(n(), &x_[0], 0.25f, &y_[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_EQ(x_[i] > 0 ? x_[i] : 0.25f * x_[i], y_[i]);
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestBackward) {
+  vector<float> dy(n()), y(n()), dx(n());
+  for (int i = 0; i < n(); ++i) {
+    dy[i] = std::sin(float(i));
+  }
+  for (int level = 0; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    caffe_cpu_relu_backward(n(), &x_[0], &dy[0], 0.25f, &dx[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_EQ(x_[i] > 0 ? dy[i] : 0.25f * dy[i], dx[i]);
+    }
+    caffe_cpu_sigmoid(n(), &x_[0], &y[0]);
+    caffe_cpu_sigmoid_backward(n(), &y[0], &dy[0], &dx[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_FLOAT_EQ(dy[i] * y[i] * (1 - y[i]), dx[i]);
+    }
+    caffe_cpu_tanh(n(), &x_[0], &y[0]);
+    caffe_cpu_tanh_backward(n(), &y[0], &dy[0], &dx[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_NEAR(dy[i] * (1 - y[i] * y[i]), dx[i], 1e-7);
+    }
+    caffe_cpu_elu(n(), &x_[0], 0.5f, &y[0]);
+    caffe_cpu_elu_backward(n(), &x_[0], &y[0], &dy[0], 0.5f, &dx[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_FLOAT_EQ(x_[i] > 0 ? dy[i] : (0.5f + y[i]) * dy[i], dx[i]);
+    }
+    caffe_cpu_bnll_backward(n(), &x_[0], &dy[0], &dx[0]);
+    for (int i = 0; i < n(); ++i) {
+      const double sigmoid = 1. / (1. + std::exp(-double(x_[i])));
+      EXPECT_NEAR(dy[i] * sigmoid, dx[i], 2.4e-7 * std::fabs(dy[i]));
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestPower) {
+  const float powers[] = {1.f, 2.f, 0.5f, 3.f, -1.5f};
+  for (int level = 0; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    for (int p = 0; p < sizeof(powers) / sizeof(powers[0]); ++p) {
+      caffe_cpu_power(n(), &x_[0], 0.125f, 14.f, powers[p], &y_[0]);
+      for (int i = 0; i < n(); ++i) {
+        const double expected =
+            std::pow(14. + 0.125 * double(x_[i]), double(powers[p]));
+        EXPECT_NEAR(expected, y_[i], 4e-7 * std::fabs(expected))
+            << simd_level_name(simd_level()) << " power " << powers[p];
+      }
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestInPlace) {
+  vector<float> y(n());
+  for (int level = 0; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    caffe_cpu_tanh(n(), &x_[0], &y[0]);
+    caffe_cpu_tanh(n(), &x_[0], &x_[0]);
+    for (int i = 0; i < n(); ++i) {
+      EXPECT_EQ(y[i], x_[i]);
+    }
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestNaN) {
+  const float nan = std::numeric_limits<float>::quiet_NaN();
+  for (int level = 0; level <= max_simd_level(); ++level) {
+    set_simd_level(static_cast<SimdLevel>(level));
+    float y;
+    caffe_cpu_fast_exp(1, &nan, &y);
+    EXPECT_TRUE(std::isnan(y));
+    caffe_cpu_sigmoid(1, &nan, &y);
+    EXPECT_TRUE(std::isnan(y));
+    caffe_cpu_tanh(1, &nan, &y);
+    EXPECT_TRUE(std::isnan(y));
+    caffe_cpu_bnll(1, &nan, &y);
+    EXPECT_TRUE(std::isnan(y));
+    caffe_cpu_relu(1, &nan, 0.1f, &y);
+    EXPECT_TRUE(std::isnan(y));
+  }
+}
+
+TEST_F(NeuronKernelsTest, TestDouble) {
+  vector<double> x(x_.begin(), x_.end()), y(n());
+  caffe_cpu_tanh(n(), &x[0], &y[0]);
+  for (int i = 0; i < n(); ++i) {
+    EXPECT_EQ(std::tanh(x[i]), y[i]);
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,156 @@
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layers/nlp_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/io.hpp"
+#include "caffe/util/sample_pack.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+static const int kNlpSamples = 5;
+static const int kNlpHeight = 3;
+static const int kNlpWidth = 4;
+
+template <typename TypeParam>
+class NlpDataLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  NlpDataLayerTest()
+      : blob_top_data_(new Blob<Dtype>()),
+        blob_top_label_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+    Caffe::set_random_seed(1701);
+    // One binary matrix per sample, named by its index.
+    MakeTempDir(&prefix_);
+    MakeTempFilename(&label_filename_);
+    MakeTempFilename(&data_filename_);
+    std::ofstream label_file(label_filename_.c_str());
+    std::ofstream data_file(data_filename_.c_str());
+    label_file << kNlpSamples << " " << kNlpSamples << "\n";
+    for (int i = 0; i < kNlpSamples; ++i) {
+      label_file << i << "\n";
+      const string name = format_int(i) + ".bin";
+      data_file << name << "\n";
+      vector<Dtype> values(kNlpHeight * kNlpWidth);
+      for (int j = 0; j < values.size(); ++j) {
+        values[j] = Value(i, j);
+      }
+      std::ofstream sample((prefix_ + "/" + name).c_str(), std::ios::binary);
+      sample.write(reinterpret_cast<const char*>(&values[0]),
+          sizeof(Dtype) * values.size());
+    }
+  }
+
+  virtual ~NlpDataLayerTest() {
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  static Dtype Value(int sample, int j) { return sample * 100 + j; }
+
+  void SetParam(LayerParameter* param) {
+    NlpDataParameter* data_param = param->mutable_nlp_data_param();
+    data_param->set_batch_size(kNlpSamples);
+    data_param->set_channel(1);
+    data_param->set_crop_height(kNlpHeight);
+    data_param->set_crop_width(kNlpWidth);
+    data_param->set_shuffle(false);
+  }
+
+  void CheckBatch() {
+    for (int i = 0; i < kNlpSamples; ++i) {
+      EXPECT_EQ(i, blob_top_label_->cpu_data()[i]);
+      for (int j = 0; j < kNlpHeight * kNlpWidth; ++j) {
+        EXPECT_EQ(Value(i, j),
+            blob_top_data_->cpu_data()[i * kNlpHeight * kNlpWidth + j]);
+      }
+    }
+  }
+
+  string prefix_, label_filename_, data_filename_;
+  Blob<Dtype>* const blob_top_data_;
+  Blob<Dtype>* const blob_top_label_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(NlpDataLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(NlpDataLayerTest, TestReadFiles) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter param;
+  this->SetParam(&param);
+  NlpDataParameter* data_param = param.mutable_nlp_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_image_prefix(this->prefix_);
+  NlpDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int iter = 0; iter < 2; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    this->CheckBatch();
+  }
+}
+
+TYPED_TEST(NlpDataLayerTest, TestReadFilesAsync) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter param;
+  this->SetParam(&param);
+  NlpDataParameter* data_param = param.mutable_nlp_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_image_prefix(this->prefix_);
+  data_param->set_io_depth(2);
+  NlpDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int iter = 0; iter < 2; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    this->CheckBatch();
+  }
+}
+
+TYPED_TEST(NlpDataLayerTest, TestReadPack) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<int> labels;
+  vector<string> files;
+  for (int i = 0; i < kNlpSamples; ++i) {
+    labels.push_back(i);
+    files.push_back(this->prefix_ + "/" + format_int(i) + ".bin");
+  }
+  string pack_filename;
+  MakeTempFilename(&pack_filename);
+  SamplePack::Write(pack_filename, labels, files, 64);
+  {
+    SamplePack pack;
+    pack.Open(pack_filename);
+    ASSERT_EQ(kNlpSamples, pack.num_samples());
+    for (int i = 0; i < kNlpSamples; ++i) {
+      EXPECT_EQ(i, pack.label(i));
+      EXPECT_EQ(sizeof(Dtype) * kNlpHeight * kNlpWidth, pack.size(i));
+      EXPECT_EQ(0, (pack.data(i) - pack.data(0)) % 64);
+    }
+  }
+
+  LayerParameter param;
+  this->SetParam(&param);
+  param.mutable_nlp_data_param()->set_pack_source(pack_filename);
+  NlpDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int iter = 0; iter < 2; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    this->CheckBatch();
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,98 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/sample_permutation.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+static const int kSize = 100;
+
+class SamplePermutationTest : public ::testing::Test {
+ protected:
+  vector<uint32_t> Epoch(SamplePermutation* order) {
+    vector<uint32_t> indices;
+    for (int i = 0; i < kSize; ++i) {
+      indices.push_back(order->Next());
+    }
+    return indices;
+  }
+
+  void CheckPermutation(const vector<uint32_t>& indices) {
+    vector<bool> seen(kSize, false);
+    for (int i = 0; i < indices.size(); ++i) {
+      ASSERT_LT(indices[i], kSize);
+      EXPECT_FALSE(seen[indices[i]]) << indices[i] << " visited twice";
+      seen[indices[i]] = true;
+    }
+  }
+};
+
+TEST_F(SamplePermutationTest, TestSequential) {
+  SamplePermutation order(kSize, false, 1701);
+  for (int epoch = 0; epoch < 3; ++epoch) {
+    EXPECT_EQ(epoch, order.epoch());
+    vector<uint32_t> indices = Epoch(&order);
+    for (int i = 0; i < kSize; ++i) {
+      EXPECT_EQ(i, indices[i]);
+    }
+  }
+}
+
+TEST_F(SamplePermutationTest, TestShuffleEveryEpoch) {
+  SamplePermutation order(kSize, true, 1701);
+  vector<vector<uint32_t> > epochs;
+  for (int epoch = 0; epoch < 4; ++epoch) {
+    epochs.push_back(Epoch(&order));
+    CheckPermutation(epochs.back());
+  }
+  EXPECT_EQ(4, order.epoch());
+  for (int epoch = 1; epoch < epochs.size(); ++epoch) {
+    EXPECT_NE(epochs[epoch - 1], epochs[epoch]);
+  }
+  // The background shuffles depend on the seed only.
+  SamplePermutation same(kSize, true, 1701);
+  for (int epoch = 0; epoch < epochs.size(); ++epoch) {
+    EXPECT_EQ(epochs[epoch], Epoch(&same));
+  }
+}
+
+TEST_F(SamplePermutationTest, TestShardsSplitEachEpoch) {
+  const int world_size = 3;
+  vector<shared_ptr<SamplePermutation> > orders;
+  for (int rank = 0; rank < world_size; ++rank) {
+    orders.push_back(shared_ptr<SamplePermutation>(
+        new SamplePermutation(kSize, true, 1701, rank, world_size)));
+  }
+  EXPECT_EQ(34, orders[0]->size());
+  EXPECT_EQ(33, orders[2]->size());
+  vector<vector<uint32_t> > epochs;
+  for (int epoch = 0; epoch < 3; ++epoch) {
+    // Together the shards visit every sample once per epoch.
+    vector<uint32_t> indices;
+    for (int rank = 0; rank < world_size; ++rank) {
+      for (int i = 0; i < orders[rank]->size(); ++i) {
+        indices.push_back(orders[rank]->Next() * world_size + rank);
+      }
+    }
+    ASSERT_EQ(kSize, indices.size());
+    CheckPermutation(indices);
+    epochs.push_back(indices);
+  }
+  for (int epoch = 1; epoch < epochs.size(); ++epoch) {
+    EXPECT_NE(epochs[epoch - 1], epochs[epoch]);
+  }
+  // Each epoch depends on the seed and the rank only.
+  SamplePermutation same(kSize, true, 1701, 1, world_size);
+  for (int epoch = 0; epoch < epochs.size(); ++epoch) {
+    for (int i = 0; i < same.size(); ++i) {
+      EXPECT_EQ(epochs[epoch][orders[0]->size() + i],
+          same.Next() * world_size + 1);
+    }
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,73 @@
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/common.hpp"
+#include "caffe/util/shuffle_buffer.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Yields 0, 1, 2, ... so that a sample tells its position in the stream.
+class CountingReader : public SampleReader<int> {
+ public:
+  CountingReader() : next_(0) {}
+  virtual void Read(int* sample) { *sample = next_++; }
+
+ private:
+  int next_;
+};
+
+class ShuffleBufferTest : public ::testing::Test {
+ protected:
+  // Draws num samples, releasing each one right away.
+  vector<int> Draw(int capacity, int num) {
+    ShuffleBuffer<int> buffer(new CountingReader(), capacity, 1701);
+    vector<int> drawn;
+    for (int i = 0; i < num; ++i) {
+      const int id = buffer.Next();
+      drawn.push_back(buffer.sample(id));
+      buffer.Release(id);
+    }
+    return drawn;
+  }
+};
+
+TEST_F(ShuffleBufferTest, TestCapacityOneKeepsOrder) {
+  vector<int> drawn = Draw(1, 100);
+  for (int i = 0; i < drawn.size(); ++i) {
+    EXPECT_EQ(i, drawn[i]);
+  }
+}
+
+TEST_F(ShuffleBufferTest, TestBoundedShuffle) {
+  const int capacity = 16;
+  const int num = 1000;
+  vector<int> drawn = Draw(capacity, num);
+  vector<bool> seen(num + capacity, false);
+  int in_order = 0;
+  for (int i = 0; i < num; ++i) {
+    // Only capacity samples are read ahead of each draw.
+    ASSERT_LT(drawn[i], i + capacity);
+    EXPECT_FALSE(seen[drawn[i]]) << drawn[i] << " drawn twice";
+    seen[drawn[i]] = true;
+    in_order += drawn[i] == i;
+  }
+  EXPECT_LT(in_order, num / 2);
+}
+
+TEST_F(ShuffleBufferTest, TestHeldSamples) {
+  ShuffleBuffer<int> buffer(new CountingReader(), 4, 1701);
+  // Samples that are not released keep their value while others are drawn.
+  vector<int> ids, values;
+  for (int i = 0; i < 10; ++i) {
+    ids.push_back(buffer.Next());
+    values.push_back(buffer.sample(ids.back()));
+  }
+  for (int i = 0; i < ids.size(); ++i) {
+    EXPECT_EQ(values[i], buffer.sample(ids[i]));
+  }
+}
+
+}  // namespace caffe
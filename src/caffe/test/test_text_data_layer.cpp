@@ -0,0 +1,713 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layers/dictindex_data_layer.hpp"
+#include "caffe/layers/text_data_layer.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/embedding_dict.hpp"
+#include "caffe/util/io.hpp"
+#include "caffe/util/text_corpus.hpp"
+#include "caffe/util/vocab_hash.hpp"
+#include "caffe/util/vocab_remap.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+
+namespace caffe {
+
+// Sample i has label i and the word indices 0, 1, ..., i (i + 1 tokens),
+// except for the last sample which is empty.
+static const int kNumSamples = 5;
+static const int kDictRows = 8;
+static const int kDictWidth = 100;
+// Not one of the widths RowCopier specializes.
+static const int kBinaryDictWidth = 7;
+
+template <typename TypeParam>
+class TextDataLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  TextDataLayerTest()
+      : blob_top_data_(new Blob<Dtype>()),
+        blob_top_label_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    blob_top_vec_.push_back(blob_top_data_);
+    blob_top_vec_.push_back(blob_top_label_);
+    Caffe::set_random_seed(1701);
+    MakeTempFilename(&label_filename_);
+    std::ofstream label_file(label_filename_.c_str());
+    label_file << kNumSamples << "\n";
+    for (int i = 0; i < kNumSamples; ++i) {
+      label_file << i << "\n";
+    }
+    label_file.close();
+    MakeTempFilename(&data_filename_);
+    std::ofstream data_file(data_filename_.c_str());
+    for (int i = 0; i < kNumSamples; ++i) {
+      for (int j = 0; j <= i && i < kNumSamples - 1; ++j) {
+        data_file << j << " ";
+      }
+      data_file << "\n";
+    }
+    data_file.close();
+    MakeTempFilename(&dict_filename_);
+    std::ofstream dict_file(dict_filename_.c_str());
+    for (int i = 0; i < kDictRows; ++i) {
+      for (int j = 0; j < kDictWidth; ++j) {
+        dict_file << DictValue(i, j) << " ";
+      }
+      dict_file << "\n";
+    }
+    dict_file.close();
+  }
+
+  virtual ~TextDataLayerTest() {
+    delete blob_top_data_;
+    delete blob_top_label_;
+  }
+
+  static Dtype DictValue(int row, int col) {
+    return row + col / Dtype(1000);
+  }
+
+  string label_filename_;
+  string data_filename_;
+  string dict_filename_;
+  Blob<Dtype>* const blob_top_data_;
+  Blob<Dtype>* const blob_top_label_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(TextDataLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(TextDataLayerTest, TestCorpusRoundTrip) {
+  TextCorpus text;
+  text.LoadText(this->label_filename_, this->data_filename_);
+  EXPECT_FALSE(text.mapped());
+  ASSERT_EQ(kNumSamples, text.num_samples());
+  string corpus_filename;
+  MakeTempFilename(&corpus_filename);
+  text.Save(corpus_filename);
+  EXPECT_TRUE(TextCorpus::IsBinary(corpus_filename));
+  EXPECT_FALSE(TextCorpus::IsBinary(this->data_filename_));
+  TextCorpus binary;
+  binary.Open(corpus_filename);
+  EXPECT_TRUE(binary.mapped());
+  ASSERT_EQ(kNumSamples, binary.num_samples());
+  EXPECT_EQ(text.num_tokens(), binary.num_tokens());
+  for (int i = 0; i < kNumSamples; ++i) {
+    EXPECT_EQ(i, binary.label(i));
+    const int length = i < kNumSamples - 1 ? i + 1 : 0;
+    ASSERT_EQ(length, binary.length(i));
+    for (int j = 0; j < length; ++j) {
+      EXPECT_EQ(j, binary.tokens(i)[j]);
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestCorpusShards) {
+  TextCorpus text;
+  text.LoadText(this->label_filename_, this->data_filename_);
+  string corpus_filename;
+  MakeTempFilename(&corpus_filename);
+  text.Save(corpus_filename);
+  const int world_size = 2;
+  for (int rank = 0; rank < world_size; ++rank) {
+    TextCorpus parsed, mapped;
+    parsed.LoadText(this->label_filename_, this->data_filename_, rank,
+        world_size);
+    mapped.Open(corpus_filename, rank, world_size);
+    const int shard_size = rank == 0 ? 3 : 2;
+    ASSERT_EQ(shard_size, parsed.num_samples());
+    ASSERT_EQ(shard_size, mapped.num_samples());
+    EXPECT_EQ(kNumSamples, parsed.total_samples());
+    EXPECT_EQ(kNumSamples, mapped.total_samples());
+    for (int i = 0; i < shard_size; ++i) {
+      const int sample = i * world_size + rank;
+      EXPECT_EQ(sample, parsed.label(i));
+      EXPECT_EQ(sample, mapped.label(i));
+      ASSERT_EQ(text.length(sample), parsed.length(i));
+      ASSERT_EQ(text.length(sample), mapped.length(i));
+      for (int j = 0; j < text.length(sample); ++j) {
+        EXPECT_EQ(text.tokens(sample)[j], parsed.tokens(i)[j]);
+        EXPECT_EQ(text.tokens(sample)[j], mapped.tokens(i)[j]);
+      }
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestDictIndexReadCorpus) {
+  typedef typename TypeParam::Dtype Dtype;
+  TextCorpus text;
+  text.LoadText(this->label_filename_, this->data_filename_);
+  string corpus_filename;
+  MakeTempFilename(&corpus_filename);
+  text.Save(corpus_filename);
+
+  const int crop_height = 3;
+  LayerParameter param;
+  DictIndexDataParameter* data_param = param.mutable_dictindex_data_param();
+  data_param->set_corpus_source(corpus_filename);
+  data_param->set_batch_size(kNumSamples);
+  data_param->set_channel(1);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(1);
+  data_param->set_shuffle(false);
+  DictIndexDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(kNumSamples, this->blob_top_data_->shape(0));
+  EXPECT_EQ(1, this->blob_top_data_->shape(1));
+  EXPECT_EQ(crop_height, this->blob_top_data_->shape(2));
+  for (int iter = 0; iter < 2; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* data = this->blob_top_data_->cpu_data();
+    for (int i = 0; i < kNumSamples; ++i) {
+      EXPECT_EQ(i, this->blob_top_label_->cpu_data()[i]);
+      const int length = i < kNumSamples - 1 ? i + 1 : 0;
+      for (int h = 0; h < crop_height; ++h) {
+        // Short texts repeat cyclically, empty ones are zero.
+        const int expected = length == 0 ? 0 : h % length;
+        EXPECT_EQ(expected, data[i * crop_height + h]);
+      }
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestDictIndexForwardSharesBatch) {
+  typedef typename TypeParam::Dtype Dtype;
+  const int crop_height = 3;
+  LayerParameter param;
+  DictIndexDataParameter* data_param = param.mutable_dictindex_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_batch_size(kNumSamples);
+  data_param->set_channel(1);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(1);
+  data_param->set_shuffle(false);
+  DictIndexDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // The tops take the memory of each prefetched batch in turn instead of
+  // receiving a copy of it.
+  vector<const Dtype*> batches;
+  for (int iter = 0; iter <= param.data_param().prefetch_batches(); ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* data = this->blob_top_data_->cpu_data();
+    EXPECT_EQ(batches.end(), std::find(batches.begin(), batches.end(), data));
+    batches.push_back(data);
+    EXPECT_EQ(1, data[crop_height + 1]);
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestDictIndexBucketing) {
+  typedef typename TypeParam::Dtype Dtype;
+  const int crop_height = 4;
+  LayerParameter param;
+  DictIndexDataParameter* data_param = param.mutable_dictindex_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_batch_size(2);
+  data_param->set_channel(1);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(1);
+  data_param->set_shuffle(false);
+  data_param->add_bucket_boundaries(1);
+  data_param->add_bucket_boundaries(2);
+  Blob<Dtype> blob_top_length;
+  this->blob_top_vec_.push_back(&blob_top_length);
+  DictIndexDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(crop_height, this->blob_top_data_->shape(2));
+  EXPECT_EQ(2, blob_top_length.count());
+  // Samples have lengths 1, 2, 3, 4, 0 and are drawn in order, so the
+  // buckets fill up as {2, 3}, then {0, 4}, then {1, 1} in the next epoch.
+  const int kBatchSamples[3][2] = {{2, 3}, {0, 4}, {1, 1}};
+  const int kBatchHeights[3] = {4, 1, 2};
+  for (int iter = 0; iter < 3; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const int height = kBatchHeights[iter];
+    EXPECT_EQ(height, this->blob_top_data_->shape(2));
+    const Dtype* data = this->blob_top_data_->cpu_data();
+    for (int i = 0; i < 2; ++i) {
+      const int sample = kBatchSamples[iter][i];
+      EXPECT_EQ(sample, this->blob_top_label_->cpu_data()[i]);
+      const int length = sample < kNumSamples - 1 ? sample + 1 : 0;
+      EXPECT_EQ(std::min(length, height), blob_top_length.cpu_data()[i]);
+      for (int h = 0; h < height; ++h) {
+        const int expected = length == 0 ? 0 : h % length;
+        EXPECT_EQ(expected, data[i * height + h]);
+      }
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestDictIndexReadShards) {
+  typedef typename TypeParam::Dtype Dtype;
+  TextCorpus text;
+  text.LoadText(this->label_filename_, this->data_filename_);
+  string corpus_filename;
+  MakeTempFilename(&corpus_filename);
+  text.Save(corpus_filename);
+  // One text shard followed by the same samples as a binary shard.
+  string shard_filename;
+  MakeTempFilename(&shard_filename);
+  std::ofstream shard_file(shard_filename.c_str());
+  shard_file << this->label_filename_ << " " << this->data_filename_ << "\n";
+  shard_file << corpus_filename << "\n";
+  shard_file.close();
+
+  const int crop_height = 3;
+  const int batch_size = 3;
+  LayerParameter param;
+  DictIndexDataParameter* data_param = param.mutable_dictindex_data_param();
+  data_param->set_shard_source(shard_filename);
+  data_param->set_batch_size(batch_size);
+  data_param->set_channel(1);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(1);
+  data_param->set_shuffle(false);
+  DictIndexDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Read past the end of both shards to check the wrap around.
+  for (int iter = 0; iter < 5; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* data = this->blob_top_data_->cpu_data();
+    for (int i = 0; i < batch_size; ++i) {
+      const int sample = (iter * batch_size + i) % kNumSamples;
+      EXPECT_EQ(sample, this->blob_top_label_->cpu_data()[i]);
+      const int length = sample < kNumSamples - 1 ? sample + 1 : 0;
+      for (int h = 0; h < crop_height; ++h) {
+        const int expected = length == 0 ? 0 : h % length;
+        EXPECT_EQ(expected, data[i * crop_height + h]);
+      }
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestDictIndexReadRank) {
+  typedef typename TypeParam::Dtype Dtype;
+  const int crop_height = 2;
+  const int batch_size = 2;
+  LayerParameter param;
+  DictIndexDataParameter* data_param = param.mutable_dictindex_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_rank(1);
+  data_param->set_world_size(2);
+  data_param->set_batch_size(batch_size);
+  data_param->set_channel(1);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(1);
+  data_param->set_shuffle(false);
+  DictIndexDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // Rank 1 of 2 reads samples 1 and 3 only.
+  for (int iter = 0; iter < 2; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* data = this->blob_top_data_->cpu_data();
+    for (int i = 0; i < batch_size; ++i) {
+      const int sample = 2 * i + 1;
+      EXPECT_EQ(sample, this->blob_top_label_->cpu_data()[i]);
+      for (int h = 0; h < crop_height; ++h) {
+        EXPECT_EQ(h % (sample + 1), data[i * crop_height + h]);
+      }
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestTextReadCorpus) {
+  typedef typename TypeParam::Dtype Dtype;
+  TextCorpus text;
+  text.LoadText(this->label_filename_, this->data_filename_);
+  string corpus_filename;
+  MakeTempFilename(&corpus_filename);
+  text.Save(corpus_filename);
+
+  const int crop_height = 2;
+  LayerParameter param;
+  param.set_phase(TEST);
+  TextDataParameter* data_param = param.mutable_text_data_param();
+  data_param->set_corpus_source(corpus_filename);
+  data_param->set_dict_source(this->dict_filename_);
+  data_param->set_batch_size(kNumSamples);
+  data_param->set_channel(1);
+  data_param->set_num_words(4);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(kDictWidth);
+  data_param->set_shuffle(false);
+  TextDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(kNumSamples, this->blob_top_data_->num());
+  EXPECT_EQ(1, this->blob_top_data_->channels());
+  EXPECT_EQ(crop_height, this->blob_top_data_->height());
+  EXPECT_EQ(kDictWidth, this->blob_top_data_->width());
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  const Dtype* data = this->blob_top_data_->cpu_data();
+  for (int i = 0; i < kNumSamples; ++i) {
+    EXPECT_EQ(i, this->blob_top_label_->cpu_data()[i]);
+    const int length = i < kNumSamples - 1 ? i + 1 : 0;
+    for (int h = 0; h < crop_height; ++h) {
+      const int word = length == 0 ? -1 : h % length;
+      for (int w = 0; w < kDictWidth; ++w) {
+        const Dtype expected = word < 0 ? 0 : this->DictValue(word, w);
+        EXPECT_NEAR(expected,
+            data[(i * crop_height + h) * kDictWidth + w], 1e-5);
+      }
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestTextReadBinaryDict) {
+  typedef typename TypeParam::Dtype Dtype;
+  vector<float> table(kDictRows * kBinaryDictWidth);
+  for (int i = 0; i < kDictRows; ++i) {
+    for (int j = 0; j < kBinaryDictWidth; ++j) {
+      table[i * kBinaryDictWidth + j] = this->DictValue(i, j);
+    }
+  }
+  string dict_filename;
+  MakeTempFilename(&dict_filename);
+  EmbeddingDict::Write(dict_filename, kDictRows, kBinaryDictWidth, &table[0]);
+  EXPECT_TRUE(EmbeddingDict::IsBinary(dict_filename));
+  EXPECT_FALSE(EmbeddingDict::IsBinary(this->dict_filename_));
+  shared_ptr<EmbeddingDict> dict = EmbeddingDict::GetShared(dict_filename);
+  EXPECT_EQ(dict.get(), EmbeddingDict::GetShared(dict_filename).get());
+  EXPECT_EQ(kDictRows, dict->rows());
+  EXPECT_EQ(kBinaryDictWidth, dict->dim());
+
+  const int crop_height = 3;
+  LayerParameter param;
+  param.set_phase(TEST);
+  TextDataParameter* data_param = param.mutable_text_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_dict_source(dict_filename);
+  data_param->set_batch_size(kNumSamples);
+  data_param->set_channel(1);
+  data_param->set_num_words(crop_height);
+  data_param->set_crop_height(crop_height);
+  data_param->set_shuffle(false);
+  TextDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  // The width comes from the dict header.
+  EXPECT_EQ(kBinaryDictWidth, this->blob_top_data_->width());
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  const Dtype* data = this->blob_top_data_->cpu_data();
+  for (int i = 0; i < kNumSamples; ++i) {
+    const int length = i < kNumSamples - 1 ? i + 1 : 0;
+    for (int h = 0; h < crop_height; ++h) {
+      const int word = length == 0 ? -1 : h % length;
+      for (int w = 0; w < kBinaryDictWidth; ++w) {
+        const Dtype expected = word < 0 ? 0 : table[word * kBinaryDictWidth + w];
+        EXPECT_EQ(expected, data[(i * crop_height + h) * kBinaryDictWidth + w]);
+      }
+    }
+  }
+}
+
+// Word i of the vocabulary, some of them multi-byte UTF-8.
+static const char* const kVocabWords[kDictRows] = {
+  "the", "caf\xc3\xa9", "\xe6\x97\xa5\xe6\x9c\xac", "w3", "w4", "w5", "w6",
+  "w7"
+};
+
+TYPED_TEST(TextDataLayerTest, TestVocabHashTokenize) {
+  const vector<string> words(kVocabWords, kVocabWords + kDictRows);
+  string vocab_filename;
+  MakeTempFilename(&vocab_filename);
+  VocabHash::Write(vocab_filename, words);
+  VocabHash vocab;
+  vocab.Open(vocab_filename);
+  EXPECT_EQ(kDictRows, vocab.num_words());
+  for (int i = 0; i < kDictRows; ++i) {
+    EXPECT_EQ(i, vocab.Find(words[i].data(), words[i].size()));
+  }
+  EXPECT_EQ(-1, vocab.Find("cafe", 4));
+  EXPECT_EQ(-1, vocab.Find("th", 2));
+
+  const string text = "  the\tcaf\xc3\xa9 unknown \xe6\x97\xa5\xe6\x9c\xac w7\n";
+  vector<int32_t> ids;
+  vocab.Tokenize(text.data(), text.size(), -1, &ids);
+  ASSERT_EQ(4, ids.size());
+  EXPECT_EQ(0, ids[0]);
+  EXPECT_EQ(1, ids[1]);
+  EXPECT_EQ(2, ids[2]);
+  EXPECT_EQ(7, ids[3]);
+  ids.clear();
+  vocab.Tokenize(text.data(), text.size(), 5, &ids);
+  ASSERT_EQ(5, ids.size());
+  EXPECT_EQ(5, ids[2]);
+  EXPECT_EQ(2, ids[3]);
+}
+
+TYPED_TEST(TextDataLayerTest, TestTextReadRaw) {
+  typedef typename TypeParam::Dtype Dtype;
+  // The same samples as data_filename_, spelled as words, with a word that
+  // is not in the vocabulary ahead of each.
+  const vector<string> words(kVocabWords, kVocabWords + kDictRows);
+  string vocab_filename, text_filename;
+  MakeTempFilename(&vocab_filename);
+  VocabHash::Write(vocab_filename, words);
+  MakeTempFilename(&text_filename);
+  std::ofstream text_file(text_filename.c_str());
+  for (int i = 0; i < kNumSamples; ++i) {
+    for (int j = 0; j <= i && i < kNumSamples - 1; ++j) {
+      text_file << (j == 0 ? "oov " : "") << words[j] << " ";
+    }
+    text_file << "\n";
+  }
+  text_file.close();
+
+  const int crop_height = 2;
+  LayerParameter param;
+  param.set_phase(TEST);
+  TextDataParameter* data_param = param.mutable_text_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(text_filename);
+  data_param->set_vocab_source(vocab_filename);
+  data_param->set_dict_source(this->dict_filename_);
+  data_param->set_batch_size(kNumSamples);
+  data_param->set_channel(1);
+  data_param->set_num_words(4);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(kDictWidth);
+  data_param->set_shuffle(false);
+  data_param->set_num_workers(2);
+  TextDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int iter = 0; iter < 2; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* data = this->blob_top_data_->cpu_data();
+    for (int i = 0; i < kNumSamples; ++i) {
+      EXPECT_EQ(i, this->blob_top_label_->cpu_data()[i]);
+      const int length = i < kNumSamples - 1 ? i + 1 : 0;
+      for (int h = 0; h < crop_height; ++h) {
+        const int word = length == 0 ? -1 : h % length;
+        for (int w = 0; w < kDictWidth; ++w) {
+          const Dtype expected = word < 0 ? 0 : this->DictValue(word, w);
+          EXPECT_NEAR(expected,
+              data[(i * crop_height + h) * kDictWidth + w], 1e-5);
+        }
+      }
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestVocabRemapByFrequency) {
+  // Reversing the vocabulary gives words 7, 6, 5, 4 the counts 4, 3, 2, 1
+  // and words 0 to 3 none.
+  vector<int32_t> reverse(kDictRows);
+  for (int w = 0; w < kDictRows; ++w) {
+    reverse[w] = kDictRows - 1 - w;
+  }
+  TextCorpus corpus;
+  corpus.LoadText(this->label_filename_, this->data_filename_);
+  corpus.RemapTokens(reverse);
+  EXPECT_EQ(kDictRows - 1, corpus.tokens(0)[0]);
+  VocabRemap remap;
+  remap.ByFrequency(corpus, kDictRows);
+  ASSERT_EQ(kDictRows, remap.num_words());
+  for (int w = 0; w < kDictRows / 2; ++w) {
+    EXPECT_EQ(w, remap(kDictRows - 1 - w));
+    // Unseen words keep their order after the seen ones.
+    EXPECT_EQ(kDictRows / 2 + w, remap(w));
+  }
+  string remap_filename;
+  MakeTempFilename(&remap_filename);
+  remap.Save(remap_filename);
+  VocabRemap loaded;
+  loaded.Load(remap_filename);
+  EXPECT_EQ(remap.new_index(), loaded.new_index());
+}
+
+TYPED_TEST(TextDataLayerTest, TestReadVocabRemap) {
+  typedef typename TypeParam::Dtype Dtype;
+  // Reverse the rows of the dict, and read the unchanged samples through
+  // the matching remap.
+  string remap_filename;
+  MakeTempFilename(&remap_filename);
+  {
+    std::ofstream remap_file(remap_filename.c_str());
+    for (int w = 0; w < kDictRows; ++w) {
+      remap_file << kDictRows - 1 - w << "\n";
+    }
+  }
+  vector<float> table(kDictRows * kBinaryDictWidth);
+  for (int i = 0; i < kDictRows; ++i) {
+    for (int j = 0; j < kBinaryDictWidth; ++j) {
+      table[i * kBinaryDictWidth + j] = this->DictValue(kDictRows - 1 - i, j);
+    }
+  }
+  string dict_filename;
+  MakeTempFilename(&dict_filename);
+  EmbeddingDict::Write(dict_filename, kDictRows, kBinaryDictWidth, &table[0]);
+
+  const int crop_height = 3;
+  LayerParameter param;
+  param.set_phase(TEST);
+  TextDataParameter* data_param = param.mutable_text_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_dict_source(dict_filename);
+  data_param->set_vocab_remap(remap_filename);
+  data_param->set_batch_size(kNumSamples);
+  data_param->set_channel(1);
+  data_param->set_num_words(crop_height);
+  data_param->set_crop_height(crop_height);
+  data_param->set_shuffle(false);
+  TextDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  const Dtype* data = this->blob_top_data_->cpu_data();
+  for (int i = 0; i < kNumSamples; ++i) {
+    const int length = i < kNumSamples - 1 ? i + 1 : 0;
+    for (int h = 0; h < crop_height; ++h) {
+      const int word = length == 0 ? -1 : h % length;
+      for (int w = 0; w < kBinaryDictWidth; ++w) {
+        const Dtype expected = word < 0 ? 0 : this->DictValue(word, w);
+        EXPECT_NEAR(expected,
+            data[(i * crop_height + h) * kBinaryDictWidth + w], 1e-5);
+      }
+    }
+  }
+
+  LayerParameter index_param;
+  DictIndexDataParameter* index_data_param =
+      index_param.mutable_dictindex_data_param();
+  index_data_param->set_label_source(this->label_filename_);
+  index_data_param->set_data_source(this->data_filename_);
+  index_data_param->set_vocab_remap(remap_filename);
+  index_data_param->set_batch_size(kNumSamples);
+  index_data_param->set_channel(1);
+  index_data_param->set_crop_height(crop_height);
+  index_data_param->set_crop_width(1);
+  index_data_param->set_shuffle(false);
+  DictIndexDataLayer<Dtype> index_layer(index_param);
+  index_layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  index_layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  const Dtype* indices = this->blob_top_data_->cpu_data();
+  for (int i = 0; i < kNumSamples - 1; ++i) {
+    for (int h = 0; h < crop_height; ++h) {
+      EXPECT_EQ(kDictRows - 1 - h % (i + 1), indices[i * crop_height + h]);
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestTextCropWindow) {
+  typedef typename TypeParam::Dtype Dtype;
+  const int num_words = 5;
+  LayerParameter param;
+  param.set_phase(TRAIN);
+  TextDataParameter* data_param = param.mutable_text_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_dict_source(this->dict_filename_);
+  data_param->set_batch_size(kNumSamples);
+  data_param->set_channel(1);
+  data_param->set_num_words(num_words);
+  data_param->set_crop_width(kDictWidth);
+  data_param->set_shuffle(false);
+  // A window as tall as num_words leaves a single valid offset.
+  for (int crop_height = 2; crop_height <= num_words; crop_height += 3) {
+    data_param->set_crop_height(crop_height);
+    TextDataLayer<Dtype> layer(param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* data = this->blob_top_data_->cpu_data();
+    for (int i = 0; i < kNumSamples; ++i) {
+      const int length = i < kNumSamples - 1 ? i + 1 : 0;
+      const Dtype* sample = data + i * crop_height * kDictWidth;
+      // The rows must be a window of the sample padded cyclically to
+      // num_words, starting at one of the valid offsets.
+      bool found = false;
+      for (int h_off = 0; h_off < std::max(num_words - crop_height, 1); ++h_off) {
+        bool match = true;
+        for (int h = 0; h < crop_height && match; ++h) {
+          for (int w = 0; w < kDictWidth && match; ++w) {
+            const Dtype expected = length == 0 ? 0 :
+                this->DictValue((h_off + h) % std::min(length, num_words), w);
+            match = std::fabs(expected - sample[h * kDictWidth + w]) < 1e-5;
+          }
+        }
+        found = found || match;
+      }
+      EXPECT_TRUE(found) << "sample " << i;
+    }
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestParallelWorkersReproducible) {
+  typedef typename TypeParam::Dtype Dtype;
+  const int crop_height = 2;
+  LayerParameter param;
+  param.set_phase(TRAIN);
+  TextDataParameter* data_param = param.mutable_text_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_dict_source(this->dict_filename_);
+  data_param->set_batch_size(kNumSamples + 2);
+  data_param->set_channel(1);
+  data_param->set_num_words(4);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(kDictWidth);
+  data_param->set_shuffle(true);
+  data_param->set_num_workers(3);
+  vector<vector<Dtype> > runs;
+  for (int run = 0; run < 2; ++run) {
+    Caffe::set_random_seed(1701);
+    TextDataLayer<Dtype> layer(param);
+    layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+    vector<Dtype> values;
+    for (int iter = 0; iter < 3; ++iter) {
+      layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+      values.insert(values.end(), this->blob_top_data_->cpu_data(),
+          this->blob_top_data_->cpu_data() + this->blob_top_data_->count());
+      values.insert(values.end(), this->blob_top_label_->cpu_data(),
+          this->blob_top_label_->cpu_data() + this->blob_top_label_->count());
+    }
+    runs.push_back(values);
+  }
+  ASSERT_EQ(runs[0].size(), runs[1].size());
+  for (int i = 0; i < runs[0].size(); ++i) {
+    EXPECT_EQ(runs[0][i], runs[1][i]);
+  }
+}
+
+TYPED_TEST(TextDataLayerTest, TestDictIndexParallelWorkers) {
+  typedef typename TypeParam::Dtype Dtype;
+  const int crop_height = 3;
+  LayerParameter param;
+  DictIndexDataParameter* data_param = param.mutable_dictindex_data_param();
+  data_param->set_label_source(this->label_filename_);
+  data_param->set_data_source(this->data_filename_);
+  data_param->set_batch_size(kNumSamples);
+  data_param->set_channel(1);
+  data_param->set_crop_height(crop_height);
+  data_param->set_crop_width(1);
+  data_param->set_shuffle(false);
+  data_param->set_num_workers(2);
+  DictIndexDataLayer<Dtype> layer(param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  for (int iter = 0; iter < 2; ++iter) {
+    layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+    const Dtype* data = this->blob_top_data_->cpu_data();
+    for (int i = 0; i < kNumSamples; ++i) {
+      EXPECT_EQ(i, this->blob_top_label_->cpu_data()[i]);
+      const int length = i < kNumSamples - 1 ? i + 1 : 0;
+      for (int h = 0; h < crop_height; ++h) {
+        const int expected = length == 0 ? 0 : h % length;
+        EXPECT_EQ(expected, data[i * crop_height + h]);
+      }
+    }
+  }
+}
+
+}  // namespace caffe
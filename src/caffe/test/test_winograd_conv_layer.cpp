@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/filler.hpp"
+#include "caffe/layer_factory.hpp"
+#include "caffe/layers/conv_layer.hpp"
+#include "caffe/layers/winograd_conv_layer.hpp"
+#include "caffe/util/math_functions.hpp"
+
+#include "caffe/test/test_caffe_main.hpp"
+#include "caffe/test/test_gradient_check_util.hpp"
+
+namespace caffe {
+
+template <typename TypeParam>
+class WinogradConvolutionLayerTest : public MultiDeviceTest<TypeParam> {
+  typedef typename TypeParam::Dtype Dtype;
+
+ protected:
+  WinogradConvolutionLayerTest()
+      : blob_bottom_(new Blob<Dtype>(2, 4, 7, 9)),
+        blob_top_(new Blob<Dtype>()) {}
+  virtual void SetUp() {
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(blob_bottom_);
+    blob_bottom_vec_.push_back(blob_bottom_);
+    blob_top_vec_.push_back(blob_top_);
+  }
+
+  virtual ~WinogradConvolutionLayerTest() {
+    delete blob_bottom_;
+    delete blob_top_;
+  }
+
+  void SetParam(LayerParameter* layer_param, int tile) {
+    ConvolutionParameter* convolution_param =
+        layer_param->mutable_convolution_param();
+    convolution_param->add_kernel_size(3);
+    convolution_param->add_pad(1);
+    convolution_param->set_num_output(6);
+    convolution_param->set_group(2);
+    convolution_param->set_winograd_tile(tile);
+    convolution_param->mutable_weight_filler()->set_type("gaussian");
+    convolution_param->mutable_bias_filler()->set_type("gaussian");
+  }
+
+  // Runs the forward and backward passes of a set up layer and of a CAFFE
+  // engine layer with the same weights, and compares their results.
+  void CheckAgainstCaffe(Layer<Dtype>* layer, LayerParameter layer_param) {
+    layer_param.mutable_convolution_param()->set_engine(
+        ConvolutionParameter_Engine_CAFFE);
+    ConvolutionLayer<Dtype> reference(layer_param);
+    Blob<Dtype> ref_top;
+    vector<Blob<Dtype>*> ref_top_vec(1, &ref_top);
+    reference.SetUp(blob_bottom_vec_, ref_top_vec);
+    for (int i = 0; i < layer->blobs().size(); ++i) {
+      reference.blobs()[i]->CopyFrom(*layer->blobs()[i]);
+    }
+    layer->Forward(blob_bottom_vec_, blob_top_vec_);
+    reference.Forward(blob_bottom_vec_, ref_top_vec);
+    ExpectNear(ref_top.count(), ref_top.cpu_data(), blob_top_->cpu_data());
+
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(&ref_top);
+    caffe_copy(ref_top.count(), ref_top.cpu_data(),
+        blob_top_->mutable_cpu_diff());
+    caffe_copy(ref_top.count(), ref_top.cpu_data(),
+        ref_top.mutable_cpu_diff());
+    const vector<bool> propagate_down(1, true);
+    Blob<Dtype> bottom_diff;
+    bottom_diff.ReshapeLike(*blob_bottom_);
+    reference.Backward(ref_top_vec, propagate_down, blob_bottom_vec_);
+    caffe_copy(bottom_diff.count(), blob_bottom_->cpu_diff(),
+        bottom_diff.mutable_cpu_diff());
+    layer->Backward(blob_top_vec_, propagate_down, blob_bottom_vec_);
+    ExpectNear(bottom_diff.count(), bottom_diff.cpu_diff(),
+        blob_bottom_->cpu_diff());
+    for (int i = 0; i < layer->blobs().size(); ++i) {
+      ExpectNear(layer->blobs()[i]->count(), reference.blobs()[i]->cpu_diff(),
+          layer->blobs()[i]->cpu_diff());
+    }
+  }
+
+  // A smaller input than blob_bottom_, as the check is exhaustive.
+  void CheckGradient(Layer<Dtype>* layer) {
+    Blob<Dtype> bottom(1, 2, 5, 6);
+    FillerParameter filler_param;
+    GaussianFiller<Dtype> filler(filler_param);
+    filler.Fill(&bottom);
+    vector<Blob<Dtype>*> bottom_vec(1, &bottom);
+    GradientChecker<Dtype> checker(1e-2, 1e-3);
+    checker.CheckGradientExhaustive(layer, bottom_vec, blob_top_vec_);
+  }
+
+  // Winograd rounds differently from im2col; the bound is relative to the
+  // magnitude of the values.
+  void ExpectNear(int count, const Dtype* expected, const Dtype* actual) {
+    for (int i = 0; i < count; ++i) {
+      EXPECT_NEAR(expected[i], actual[i],
+          1e-4 * std::max(Dtype(1), std::fabs(expected[i])));
+    }
+  }
+
+  Blob<Dtype>* const blob_bottom_;
+  Blob<Dtype>* const blob_top_;
+  vector<Blob<Dtype>*> blob_bottom_vec_;
+  vector<Blob<Dtype>*> blob_top_vec_;
+};
+
+TYPED_TEST_CASE(WinogradConvolutionLayerTest, TestDtypesAndDevices);
+
+TYPED_TEST(WinogradConvolutionLayerTest, TestEngine) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  layer_param.set_type("Convolution");
+  this->SetParam(&layer_param, 4);
+  layer_param.mutable_convolution_param()->set_engine(
+      ConvolutionParameter_Engine_WINOGRAD);
+  shared_ptr<Layer<Dtype> > layer =
+      LayerRegistry<Dtype>::CreateLayer(layer_param);
+  EXPECT_TRUE(dynamic_cast<WinogradConvolutionLayer<Dtype>*>(layer.get()));
+  layer->SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  EXPECT_EQ(2, this->blob_top_->num());
+  EXPECT_EQ(6, this->blob_top_->channels());
+  EXPECT_EQ(7, this->blob_top_->height());
+  EXPECT_EQ(9, this->blob_top_->width());
+}
+
+TYPED_TEST(WinogradConvolutionLayerTest, TestTile2MatchesCaffe) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  this->SetParam(&layer_param, 2);
+  WinogradConvolutionLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->CheckAgainstCaffe(&layer, layer_param);
+}
+
+TYPED_TEST(WinogradConvolutionLayerTest, TestTile4MatchesCaffe) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  this->SetParam(&layer_param, 4);
+  WinogradConvolutionLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->CheckAgainstCaffe(&layer, layer_param);
+}
+
+TYPED_TEST(WinogradConvolutionLayerTest, TestUnpaddedMatchesCaffe) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  this->SetParam(&layer_param, 4);
+  layer_param.mutable_convolution_param()->clear_pad();
+  WinogradConvolutionLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->CheckAgainstCaffe(&layer, layer_param);
+}
+
+TYPED_TEST(WinogradConvolutionLayerTest, TestFallbackMatchesCaffe) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  this->SetParam(&layer_param, 4);
+  layer_param.mutable_convolution_param()->add_stride(2);
+  WinogradConvolutionLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  this->CheckAgainstCaffe(&layer, layer_param);
+}
+
+TYPED_TEST(WinogradConvolutionLayerTest, TestWeightUpdate) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  this->SetParam(&layer_param, 4);
+  WinogradConvolutionLayer<Dtype> layer(layer_param);
+  layer.SetUp(this->blob_bottom_vec_, this->blob_top_vec_);
+  layer.Forward(this->blob_bottom_vec_, this->blob_top_vec_);
+  // The transformed filters follow the weights.
+  FillerParameter filler_param;
+  GaussianFiller<Dtype> filler(filler_param);
+  filler.Fill(layer.blobs()[0].get());
+  this->CheckAgainstCaffe(&layer, layer_param);
+}
+
+TYPED_TEST(WinogradConvolutionLayerTest, TestGradientTile2) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  this->SetParam(&layer_param, 2);
+  layer_param.mutable_convolution_param()->set_num_output(2);
+  WinogradConvolutionLayer<Dtype> layer(layer_param);
+  this->CheckGradient(&layer);
+}
+
+TYPED_TEST(WinogradConvolutionLayerTest, TestGradientTile4) {
+  typedef typename TypeParam::Dtype Dtype;
+  LayerParameter layer_param;
+  this->SetParam(&layer_param, 4);
+  layer_param.mutable_convolution_param()->set_num_output(2);
+  WinogradConvolutionLayer<Dtype> layer(layer_param);
+  this->CheckGradient(&layer);
+}
+
+}  // namespace caffe
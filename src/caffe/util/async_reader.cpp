@@ -0,0 +1,143 @@
+#include <boost/bind.hpp>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#ifdef USE_IO_URING
+#include <liburing.h>
+#endif
+
+#include "caffe/util/async_reader.hpp"
+
+namespace caffe {
+
+#ifdef USE_IO_URING
+class AsyncReader::Ring {
+ public:
+  struct io_uring ring_;
+};
+#else
+class AsyncReader::Ring {};
+#endif
+
+AsyncReader::AsyncReader(int depth)
+    : depth_(depth), ring_(NULL) {
+  CHECK_GT(depth_, 0);
+#ifdef USE_IO_URING
+  ring_ = new Ring();
+  const int ret = io_uring_queue_init(depth_, &ring_->ring_, 0);
+  if (ret < 0) {
+    LOG(WARNING) << "io_uring is not available (" << strerror(-ret)
+        << "), reading with " << depth_ << " threads instead";
+    delete ring_;
+    ring_ = NULL;
+  }
+#endif
+  if (!ring_) {
+    pool_.reset(new ThreadPool(depth_));
+  }
+}
+
+AsyncReader::~AsyncReader() {
+#ifdef USE_IO_URING
+  if (ring_) {
+    io_uring_queue_exit(&ring_->ring_);
+  }
+#endif
+  delete ring_;
+}
+
+void AsyncReader::Add(const string& filename, void* dst, size_t size) {
+  Request request;
+  request.filename = filename;
+  request.dst = static_cast<char*>(dst);
+  request.size = size;
+  requests_.push_back(request);
+}
+
+void AsyncReader::Wait() {
+  if (ring_) {
+    WaitRing();
+  } else {
+    pool_->Run(boost::bind(&AsyncReader::ReadRequests, this, _1));
+  }
+  requests_.clear();
+}
+
+void AsyncReader::ReadRequests(int worker_id) {
+  for (int i = worker_id; i < requests_.size(); i += depth_) {
+    const Request& request = requests_[i];
+    const int fd = open(request.filename.c_str(), O_RDONLY);
+    CHECK_GE(fd, 0) << request.filename << " data failed to read!";
+    size_t done = 0;
+    while (done < request.size) {
+      const ssize_t n = pread(fd, request.dst + done, request.size - done,
+          done);
+      if (n < 0 && errno == EINTR) {
+        continue;
+      }
+      CHECK_GE(n, 0) << request.filename << " data failed to read: "
+          << strerror(errno);
+      CHECK_GT(n, 0) << request.filename << " is too small";
+      done += n;
+    }
+    close(fd);
+  }
+}
+
+#ifdef USE_IO_URING
+void AsyncReader::WaitRing() {
+  const size_t num = requests_.size();
+  vector<int> fds(num, -1);
+  vector<size_t> done(num, 0);
+  struct io_uring* ring = &ring_->ring_;
+  size_t next = 0;
+  int in_flight = 0;
+  while (next < num || in_flight > 0) {
+    // Top the ring up to depth_ reads, then take one completion.
+    for (; next < num && in_flight < depth_; ++next, ++in_flight) {
+      fds[next] = open(requests_[next].filename.c_str(), O_RDONLY);
+      CHECK_GE(fds[next], 0) << requests_[next].filename
+          << " data failed to read!";
+      struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+      CHECK(sqe) << "io_uring submission queue is full";
+      io_uring_prep_read(sqe, fds[next], requests_[next].dst,
+          requests_[next].size, 0);
+      io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(next));
+    }
+    CHECK_GE(io_uring_submit(ring), 0);
+    struct io_uring_cqe* cqe;
+    const int ret = io_uring_wait_cqe(ring, &cqe);
+    CHECK_EQ(ret, 0) << "io_uring wait failed: " << strerror(-ret);
+    const size_t i = reinterpret_cast<size_t>(io_uring_cqe_get_data(cqe));
+    const int res = cqe->res;
+    io_uring_cqe_seen(ring, cqe);
+    const Request& request = requests_[i];
+    CHECK_GE(res, 0) << request.filename << " data failed to read: "
+        << strerror(-res);
+    CHECK_GT(res, 0) << request.filename << " is too small";
+    done[i] += res;
+    if (done[i] < request.size) {
+      // Short read: queue the rest, it keeps its slot in the ring.
+      struct io_uring_sqe* sqe = io_uring_get_sqe(ring);
+      CHECK(sqe) << "io_uring submission queue is full";
+      io_uring_prep_read(sqe, fds[i], request.dst + done[i],
+          request.size - done[i], done[i]);
+      io_uring_sqe_set_data(sqe, reinterpret_cast<void*>(i));
+    } else {
+      close(fds[i]);
+      --in_flight;
+    }
+  }
+}
+#else
+void AsyncReader::WaitRing() {
+  LOG(FATAL) << "Built without USE_IO_URING";
+}
+#endif
+
+}  // namespace caffe
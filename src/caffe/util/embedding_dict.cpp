@@ -0,0 +1,397 @@
+#include <boost/thread.hpp>
+#include <boost/weak_ptr.hpp>
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <map>
+#include <string>
+#include <vector>
+
+#include "caffe/util/embedding_dict.hpp"
+
+namespace caffe {
+
+static const char kEmbeddingDictMagic[8] =
+    {'C', 'E', 'M', 'B', 'D', 'I', 'C', 'T'};
+static const uint32_t kEmbeddingDictVersion = 1;
+
+template <typename Dtype> struct EmbeddingDictType;
+template <> struct EmbeddingDictType<float> {
+  static const EmbeddingDict::Type value = EmbeddingDict::FLOAT;
+};
+template <> struct EmbeddingDictType<double> {
+  static const EmbeddingDict::Type value = EmbeddingDict::DOUBLE;
+};
+
+// Bytes of the table that follows the header.
+static uint64_t EmbeddingDictTableSize(uint32_t dtype, uint64_t rows,
+    uint64_t dim) {
+  switch (dtype) {
+  case EmbeddingDict::FLOAT:
+    return sizeof(float) * rows * dim;
+  case EmbeddingDict::DOUBLE:
+    return sizeof(double) * rows * dim;
+  case EmbeddingDict::FLOAT16:
+    return sizeof(uint16_t) * rows * dim;
+  case EmbeddingDict::INT8:
+    return 2 * sizeof(float) * rows + sizeof(int8_t) * rows * dim;
+  default:
+    LOG(FATAL) << "Unknown embedding dict dtype " << dtype;
+  }
+  return 0;
+}
+
+// IEEE 754 half precision, rounding to nearest even.
+static uint16_t FloatToHalf(float value) {
+  uint32_t f;
+  memcpy(&f, &value, sizeof(f));
+  const uint16_t sign = (f >> 16) & 0x8000;
+  const int exponent = static_cast<int>((f >> 23) & 0xff) - 127 + 15;
+  uint32_t mantissa = f & 0x7fffff;
+  if (((f >> 23) & 0xff) == 0xff) {
+    // Inf stays inf, NaN stays a quiet NaN.
+    return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+  }
+  if (exponent >= 31) {
+    return sign | 0x7c00;
+  }
+  if (exponent <= 0) {
+    if (exponent < -10) {
+      return sign;
+    }
+    // Subnormal: shift the implicit leading one in.
+    mantissa |= 0x800000;
+    const int shift = 14 - exponent;
+    uint32_t half = mantissa >> shift;
+    const uint32_t rest = mantissa & ((1u << shift) - 1);
+    const uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1))) {
+      ++half;
+    }
+    return sign | half;
+  }
+  uint32_t half = (exponent << 10) | (mantissa >> 13);
+  const uint32_t rest = mantissa & 0x1fff;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) {
+    // May carry into the exponent, up to inf, which is what rounding gives.
+    ++half;
+  }
+  return sign | half;
+}
+
+static float HalfToFloat(uint16_t half) {
+  const uint32_t sign = uint32_t(half & 0x8000) << 16;
+  int exponent = (half >> 10) & 0x1f;
+  uint32_t mantissa = half & 0x3ff;
+  uint32_t f;
+  if (exponent == 0x1f) {
+    f = sign | 0x7f800000 | (mantissa << 13);
+  } else if (exponent == 0) {
+    if (mantissa == 0) {
+      f = sign;
+    } else {
+      // Subnormal: normalize it.
+      exponent = 1;
+      while (!(mantissa & 0x400)) {
+        mantissa <<= 1;
+        --exponent;
+      }
+      mantissa &= 0x3ff;
+      f = sign | uint32_t(exponent - 15 + 127) << 23 | (mantissa << 13);
+    }
+  } else {
+    f = sign | uint32_t(exponent - 15 + 127) << 23 | (mantissa << 13);
+  }
+  float value;
+  memcpy(&value, &f, sizeof(value));
+  return value;
+}
+
+EmbeddingDict::EmbeddingDict(const string& filename, bool writable)
+    : file_(filename, writable) {
+  CHECK_GE(file_.size(), sizeof(EmbeddingDictHeader))
+      << filename << " is too small to be an embedding dict";
+  const EmbeddingDictHeader* header =
+      reinterpret_cast<const EmbeddingDictHeader*>(file_.data());
+  CHECK_EQ(memcmp(header->magic, kEmbeddingDictMagic, sizeof(header->magic)),
+      0) << filename << " is not a binary embedding dict";
+  CHECK_EQ(header->version, kEmbeddingDictVersion)
+      << "Unsupported embedding dict version in " << filename;
+  CHECK_LE(header->rows * header->dim, uint64_t(INT_MAX))
+      << filename << " is too large for a blob";
+  rows_ = header->rows;
+  dim_ = header->dim;
+  dtype_ = static_cast<Type>(header->dtype);
+  CHECK_EQ(file_.size(), sizeof(EmbeddingDictHeader)
+      + EmbeddingDictTableSize(dtype_, rows_, dim_))
+      << filename << " is truncated or corrupt";
+  table_ = file_.data() + sizeof(EmbeddingDictHeader);
+  LOG(INFO) << "Mapped embedding dict " << filename << " (" << rows_ << " x "
+      << dim_ << ")";
+}
+
+void EmbeddingDict::LoadText(const string& filename, int dim) {
+  CHECK_GT(dim, 0) << "The width of text dict " << filename
+      << " must be given";
+  std::ifstream in(filename.c_str());
+  CHECK(in.good()) << "fail to open " << filename;
+  float value;
+  while (in >> value) {
+    text_table_.push_back(value);
+  }
+  CHECK_EQ(text_table_.size() % dim, 0) << filename
+      << " does not hold rows of " << dim << " values";
+  CHECK_LE(text_table_.size(), size_t(INT_MAX))
+      << filename << " is too large for a blob";
+  rows_ = text_table_.size() / dim;
+  dim_ = dim;
+  dtype_ = FLOAT;
+  table_ = text_table_.empty() ? NULL
+      : reinterpret_cast<const char*>(&text_table_[0]);
+  LOG(INFO) << "Read embedding dict " << filename << " (" << rows_ << " x "
+      << dim_ << ")";
+}
+
+shared_ptr<EmbeddingDict> EmbeddingDict::GetShared(const string& filename,
+    int dim) {
+  static boost::mutex mutex;
+  static std::map<string, boost::weak_ptr<EmbeddingDict> > dicts;
+  boost::mutex::scoped_lock lock(mutex);
+  shared_ptr<EmbeddingDict> dict = dicts[filename].lock();
+  if (!dict) {
+    if (IsBinary(filename)) {
+      dict.reset(new EmbeddingDict(filename));
+    } else {
+      dict.reset(new EmbeddingDict());
+      dict->LoadText(filename, dim);
+    }
+    dicts[filename] = dict;
+  } else if (dim > 0 && !dict->file_.data()) {
+    CHECK_EQ(dict->dim(), dim) << "Text dict " << filename
+        << " is already shared with rows of " << dict->dim() << " values";
+  }
+  return dict;
+}
+
+bool EmbeddingDict::IsBinary(const string& filename) {
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  char magic[sizeof(kEmbeddingDictMagic)];
+  if (!file.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return memcmp(magic, kEmbeddingDictMagic, sizeof(magic)) == 0;
+}
+
+template <typename Dtype>
+void EmbeddingDict::Write(const string& filename, int rows, int dim,
+    const Dtype* data) {
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  CHECK(out.good()) << "Failed to open " << filename << " for writing";
+  EmbeddingDictHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kEmbeddingDictMagic, sizeof(header.magic));
+  header.version = kEmbeddingDictVersion;
+  header.dtype = EmbeddingDictType<Dtype>::value;
+  header.rows = rows;
+  header.dim = dim;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(data),
+      sizeof(Dtype) * size_t(rows) * dim);
+  CHECK(out.good()) << "Failed to write " << filename;
+  out.close();
+}
+
+void EmbeddingDict::Write(const string& filename, int rows, int dim,
+    const float* data, Type dtype) {
+  if (dtype == FLOAT) {
+    Write(filename, rows, dim, data);
+    return;
+  }
+  CHECK(dtype == FLOAT16 || dtype == INT8)
+      << "Unknown embedding dict dtype " << dtype;
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  CHECK(out.good()) << "Failed to open " << filename << " for writing";
+  EmbeddingDictHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kEmbeddingDictMagic, sizeof(header.magic));
+  header.version = kEmbeddingDictVersion;
+  header.dtype = dtype;
+  header.rows = rows;
+  header.dim = dim;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  if (dtype == FLOAT16) {
+    vector<uint16_t> halves(dim);
+    for (int i = 0; i < rows; ++i) {
+      for (int j = 0; j < dim; ++j) {
+        halves[j] = FloatToHalf(data[size_t(i) * dim + j]);
+      }
+      out.write(reinterpret_cast<const char*>(&halves[0]),
+          sizeof(uint16_t) * dim);
+    }
+  } else {
+    // Each row spans its own [min, max] with the 255 steps of an int8.
+    vector<float> scale_offsets(2 * size_t(rows));
+    vector<int8_t> codes(size_t(rows) * dim);
+    for (int i = 0; i < rows; ++i) {
+      const float* row = data + size_t(i) * dim;
+      const float min_value = *std::min_element(row, row + dim);
+      const float max_value = *std::max_element(row, row + dim);
+      const float scale = (max_value - min_value) / 255;
+      const float offset = min_value + 128 * scale;
+      scale_offsets[2 * i] = scale;
+      scale_offsets[2 * i + 1] = offset;
+      for (int j = 0; j < dim; ++j) {
+        const float code = scale > 0 ? (row[j] - offset) / scale : 0;
+        codes[size_t(i) * dim + j] = static_cast<int8_t>(
+            std::max(-128.f, std::min(127.f, std::floor(code + 0.5f))));
+      }
+    }
+    out.write(reinterpret_cast<const char*>(&scale_offsets[0]),
+        sizeof(float) * scale_offsets.size());
+    out.write(reinterpret_cast<const char*>(&codes[0]), codes.size());
+  }
+  CHECK(out.good()) << "Failed to write " << filename;
+  out.close();
+}
+
+void EmbeddingDict::WritePermuted(const string& filename,
+    const vector<int32_t>& new_index) const {
+  CHECK_EQ(new_index.size(), size_t(rows_))
+      << "The permutation must cover the " << rows_ << " rows";
+  vector<int> old_index(rows_, -1);
+  for (int i = 0; i < rows_; ++i) {
+    CHECK_GE(new_index[i], 0);
+    CHECK_LT(new_index[i], rows_);
+    CHECK_EQ(old_index[new_index[i]], -1)
+        << "Rows " << old_index[new_index[i]] << " and " << i
+        << " both move to " << new_index[i];
+    old_index[new_index[i]] = i;
+  }
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  CHECK(out.good()) << "Failed to open " << filename << " for writing";
+  EmbeddingDictHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kEmbeddingDictMagic, sizeof(header.magic));
+  header.version = kEmbeddingDictVersion;
+  header.dtype = dtype_;
+  header.rows = rows_;
+  header.dim = dim_;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  // The rows of every dtype are dim values of one size; INT8 keeps the
+  // scale and offset of each row in a section of their own before them.
+  const char* rows = table_;
+  size_t row_bytes = 0;
+  switch (dtype_) {
+  case FLOAT:
+    row_bytes = sizeof(float) * dim_;
+    break;
+  case DOUBLE:
+    row_bytes = sizeof(double) * dim_;
+    break;
+  case FLOAT16:
+    row_bytes = sizeof(uint16_t) * dim_;
+    break;
+  case INT8:
+    for (int i = 0; i < rows_; ++i) {
+      out.write(table_ + 2 * sizeof(float) * old_index[i],
+          2 * sizeof(float));
+    }
+    rows += 2 * sizeof(float) * rows_;
+    row_bytes = sizeof(int8_t) * dim_;
+    break;
+  }
+  for (int i = 0; i < rows_; ++i) {
+    out.write(rows + row_bytes * old_index[i], row_bytes);
+  }
+  CHECK(out.good()) << "Failed to write " << filename;
+  out.close();
+}
+
+template <typename Dtype>
+const Dtype* EmbeddingDict::data() const {
+  if (dtype_ != EmbeddingDictType<Dtype>::value) {
+    return NULL;
+  }
+  return reinterpret_cast<const Dtype*>(table_);
+}
+
+template <typename Dtype>
+Dtype* EmbeddingDict::mutable_data() {
+  if (dtype_ != EmbeddingDictType<Dtype>::value) {
+    return NULL;
+  }
+  return reinterpret_cast<Dtype*>(
+      file_.mutable_data() + sizeof(EmbeddingDictHeader));
+}
+
+template <typename Dtype>
+void EmbeddingDict::CopyTo(Dtype* out) const {
+  const size_t count = size_t(rows_) * dim_;
+  switch (dtype_) {
+  case FLOAT:
+    std::copy(reinterpret_cast<const float*>(table_),
+        reinterpret_cast<const float*>(table_) + count, out);
+    break;
+  case DOUBLE:
+    std::copy(reinterpret_cast<const double*>(table_),
+        reinterpret_cast<const double*>(table_) + count, out);
+    break;
+  default:
+    for (int i = 0; i < rows_; ++i) {
+      CopyRow(i, out + size_t(i) * dim_);
+    }
+  }
+}
+
+template <typename Dtype>
+void EmbeddingDict::CopyRow(int row, Dtype* out) const {
+  DCHECK_GE(row, 0);
+  DCHECK_LT(row, rows_);
+  const size_t begin = size_t(row) * dim_;
+  switch (dtype_) {
+  case FLOAT:
+    std::copy(reinterpret_cast<const float*>(table_) + begin,
+        reinterpret_cast<const float*>(table_) + begin + dim_, out);
+    break;
+  case DOUBLE:
+    std::copy(reinterpret_cast<const double*>(table_) + begin,
+        reinterpret_cast<const double*>(table_) + begin + dim_, out);
+    break;
+  case FLOAT16: {
+    const uint16_t* halves = reinterpret_cast<const uint16_t*>(table_) + begin;
+    for (int j = 0; j < dim_; ++j) {
+      out[j] = HalfToFloat(halves[j]);
+    }
+    break;
+  }
+  case INT8: {
+    const float* scale_offset = reinterpret_cast<const float*>(table_) + 2 * row;
+    const int8_t* codes = reinterpret_cast<const int8_t*>(
+        table_ + 2 * sizeof(float) * rows_) + begin;
+    const Dtype scale = scale_offset[0];
+    const Dtype offset = scale_offset[1];
+    for (int j = 0; j < dim_; ++j) {
+      out[j] = scale * codes[j] + offset;
+    }
+    break;
+  }
+  }
+}
+
+template void EmbeddingDict::Write<float>(const string& filename, int rows,
+    int dim, const float* data);
+template void EmbeddingDict::Write<double>(const string& filename, int rows,
+    int dim, const double* data);
+template const float* EmbeddingDict::data<float>() const;
+template const double* EmbeddingDict::data<double>() const;
+template float* EmbeddingDict::mutable_data<float>();
+template double* EmbeddingDict::mutable_data<double>();
+template void EmbeddingDict::CopyTo<float>(float* out) const;
+template void EmbeddingDict::CopyTo<double>(double* out) const;
+template void EmbeddingDict::CopyRow<float>(int row, float* out) const;
+template void EmbeddingDict::CopyRow<double>(int row, double* out) const;
+
+}  // namespace caffe
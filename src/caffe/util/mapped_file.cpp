@@ -0,0 +1,39 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+#include "caffe/util/mapped_file.hpp"
+
+namespace caffe {
+
+void MappedFile::Open(const string& filename, bool writable) {
+  Close();
+  int fd = open(filename.c_str(), O_RDONLY);
+  CHECK_GE(fd, 0) << "Failed to open " << filename;
+  struct stat st;
+  CHECK_EQ(fstat(fd, &st), 0) << "Failed to stat " << filename;
+  size_ = st.st_size;
+  CHECK_GT(size_, 0) << "Empty file " << filename;
+  const int prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* addr = mmap(NULL, size_, prot, MAP_PRIVATE, fd, 0);
+  close(fd);
+  CHECK(addr != MAP_FAILED) << "Failed to mmap " << filename;
+  data_ = static_cast<const char*>(addr);
+  writable_ = writable;
+  filename_ = filename;
+}
+
+void MappedFile::Close() {
+  if (data_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+  data_ = NULL;
+  size_ = 0;
+  writable_ = false;
+  filename_.clear();
+}
+
+}  // namespace caffe
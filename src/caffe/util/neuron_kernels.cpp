@@ -0,0 +1,554 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "glog/logging.h"
+
+#include "caffe/util/neuron_kernels.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CAFFE_NEURON_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace caffe {
+
+namespace {
+
+// exp underflows to 0 below log(2^-150) and overflows above log(FLT_MAX).
+const float kExpMin = -103.972076f;
+const float kExpMax = 88.7228394f;
+const float kInfinity = std::numeric_limits<float>::infinity();
+
+// The <cmath> loops of the double kernels, and of the float ones on CPUs
+// without SSE2.
+namespace cmath {
+
+template <typename Dtype>
+void Relu(const int n, const Dtype* x, const Dtype negative_slope,
+    Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = std::max(x[i], Dtype(0))
+        + negative_slope * std::min(x[i], Dtype(0));
+  }
+}
+
+template <typename Dtype>
+void ReluBackward(const int n, const Dtype* x, const Dtype* dy,
+    const Dtype negative_slope, Dtype* dx) {
+  for (int i = 0; i < n; ++i) {
+    dx[i] = dy[i] * ((x[i] > 0) + negative_slope * (x[i] <= 0));
+  }
+}
+
+template <typename Dtype>
+void Sigmoid(const int n, const Dtype* x, Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = 1. / (1. + std::exp(-x[i]));
+  }
+}
+
+template <typename Dtype>
+void SigmoidBackward(const int n, const Dtype* y, const Dtype* dy,
+    Dtype* dx) {
+  for (int i = 0; i < n; ++i) {
+    dx[i] = dy[i] * y[i] * (1. - y[i]);
+  }
+}
+
+template <typename Dtype>
+void TanH(const int n, const Dtype* x, Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = std::tanh(x[i]);
+  }
+}
+
+template <typename Dtype>
+void TanHBackward(const int n, const Dtype* y, const Dtype* dy, Dtype* dx) {
+  for (int i = 0; i < n; ++i) {
+    dx[i] = dy[i] * (1 - y[i] * y[i]);
+  }
+}
+
+template <typename Dtype>
+void Elu(const int n, const Dtype* x, const Dtype alpha, Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = std::max(x[i], Dtype(0))
+        + alpha * (std::exp(std::min(x[i], Dtype(0))) - Dtype(1));
+  }
+}
+
+template <typename Dtype>
+void EluBackward(const int n, const Dtype* x, const Dtype* y,
+    const Dtype* dy, const Dtype alpha, Dtype* dx) {
+  for (int i = 0; i < n; ++i) {
+    dx[i] = dy[i] * ((x[i] > 0) + (alpha + y[i]) * (x[i] <= 0));
+  }
+}
+
+template <typename Dtype>
+void Bnll(const int n, const Dtype* x, Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = x[i] > 0 ? x[i] + std::log(1. + std::exp(-x[i]))
+        : std::log(1. + std::exp(x[i]));
+  }
+}
+
+template <typename Dtype>
+void BnllBackward(const int n, const Dtype* x, const Dtype* dy, Dtype* dx) {
+  for (int i = 0; i < n; ++i) {
+    const Dtype expval = std::exp(std::min(x[i], Dtype(50)));
+    dx[i] = dy[i] * expval / (expval + 1.);
+  }
+}
+
+template <typename Dtype>
+void Exp(const int n, const Dtype* x, Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = std::exp(x[i]);
+  }
+}
+
+template <typename Dtype>
+void Power(const int n, const Dtype* x, const Dtype scale, const Dtype shift,
+    const Dtype power, Dtype* y) {
+  for (int i = 0; i < n; ++i) {
+    y[i] = std::pow(shift + scale * x[i], power);
+  }
+}
+
+}  // namespace cmath
+
+#ifdef CAFFE_NEURON_KERNELS_X86
+
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("sse2"))), \
+    apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("sse2")
+#endif
+
+namespace sse2 {
+
+typedef __m128 Vec;
+typedef __m128 Mask;
+const int kWidth = 4;
+
+inline Vec Load(const float* p) { return _mm_loadu_ps(p); }
+inline void Store(float* p, Vec v) { _mm_storeu_ps(p, v); }
+inline Vec Set(float v) { return _mm_set1_ps(v); }
+inline Vec Add(Vec a, Vec b) { return _mm_add_ps(a, b); }
+inline Vec Sub(Vec a, Vec b) { return _mm_sub_ps(a, b); }
+inline Vec Mul(Vec a, Vec b) { return _mm_mul_ps(a, b); }
+inline Vec Div(Vec a, Vec b) { return _mm_div_ps(a, b); }
+inline Vec Sqrt(Vec a) { return _mm_sqrt_ps(a); }
+inline Vec MulAdd(Vec a, Vec b, Vec c) {
+  return _mm_add_ps(_mm_mul_ps(a, b), c);
+}
+inline Vec Max(Vec a, Vec b) { return _mm_max_ps(a, b); }
+inline Vec Min(Vec a, Vec b) { return _mm_min_ps(a, b); }
+inline Mask Less(Vec a, Vec b) { return _mm_cmplt_ps(a, b); }
+inline Mask Greater(Vec a, Vec b) { return _mm_cmpgt_ps(a, b); }
+inline Mask LessEqual(Vec a, Vec b) { return _mm_cmple_ps(a, b); }
+inline Mask IsNaN(Vec a) { return _mm_cmpunord_ps(a, a); }
+inline Vec Select(Mask m, Vec a, Vec b) {
+  return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+inline Vec Abs(Vec a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+inline Vec CopySign(Vec a, Vec b) {
+  const Vec sign = _mm_set1_ps(-0.f);
+  return _mm_or_ps(_mm_andnot_ps(sign, a), _mm_and_ps(sign, b));
+}
+// Without SSE4.1's round: truncate, and step down where that rounded up.
+// The kernels only floor values far below 2^31.
+inline Vec Floor(Vec a) {
+  const Vec t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+  return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.f)));
+}
+inline Vec Pow2(Vec n) {
+  return _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(
+      _mm_cvttps_epi32(n), _mm_set1_epi32(127)), 23));
+}
+inline Vec Frexp(Vec x, Vec* e) {
+  const __m128i bits = _mm_castps_si128(x);
+  *e = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23),
+      _mm_set1_epi32(126)));
+  return _mm_castsi128_ps(_mm_or_si128(
+      _mm_and_si128(bits, _mm_set1_epi32(0x007fffff)),
+      _mm_set1_epi32(0x3f000000)));
+}
+
+#include "caffe/util/neuron_kernels_impl.hpp"
+
+}  // namespace sse2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push (__attribute__((target("avx2,fma"))), \
+    apply_to = function)
+#else
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx2,fma")
+#endif
+
+namespace avx2 {
+
+typedef __m256 Vec;
+typedef __m256 Mask;
+const int kWidth = 8;
+
+inline Vec Load(const float* p) { return _mm256_loadu_ps(p); }
+inline void Store(float* p, Vec v) { _mm256_storeu_ps(p, v); }
+inline Vec Set(float v) { return _mm256_set1_ps(v); }
+inline Vec Add(Vec a, Vec b) { return _mm256_add_ps(a, b); }
+inline Vec Sub(Vec a, Vec b) { return _mm256_sub_ps(a, b); }
+inline Vec Mul(Vec a, Vec b) { return _mm256_mul_ps(a, b); }
+inline Vec Div(Vec a, Vec b) { return _mm256_div_ps(a, b); }
+inline Vec Sqrt(Vec a) { return _mm256_sqrt_ps(a); }
+inline Vec MulAdd(Vec a, Vec b, Vec c) { return _mm256_fmadd_ps(a, b, c); }
+inline Vec Max(Vec a, Vec b) { return _mm256_max_ps(a, b); }
+inline Vec Min(Vec a, Vec b) { return _mm256_min_ps(a, b); }
+inline Mask Less(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+inline Mask Greater(Vec a, Vec b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+inline Mask LessEqual(Vec a, Vec b) {
+  return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+}
+inline Mask IsNaN(Vec a) { return _mm256_cmp_ps(a, a, _CMP_UNORD_Q); }
+inline Vec Select(Mask m, Vec a, Vec b) { return _mm256_blendv_ps(b, a, m); }
+inline Vec Abs(Vec a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+inline Vec CopySign(Vec a, Vec b) {
+  const Vec sign = _mm256_set1_ps(-0.f);
+  return _mm256_or_ps(_mm256_andnot_ps(sign, a), _mm256_and_ps(sign, b));
+}
+inline Vec Floor(Vec a) { return _mm256_floor_ps(a); }
+inline Vec Pow2(Vec n) {
+  return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_add_epi32(
+      _mm256_cvttps_epi32(n), _mm256_set1_epi32(127)), 23));
+}
+inline Vec Frexp(Vec x, Vec* e) {
+  const __m256i bits = _mm256_castps_si256(x);
+  *e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23),
+      _mm256_set1_epi32(126)));
+  return _mm256_castsi256_ps(_mm256_or_si256(
+      _mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+      _mm256_set1_epi32(0x3f000000)));
+}
+
+#include "caffe/util/neuron_kernels_impl.hpp"
+
+}  // namespace avx2
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#pragma clang attribute push (__attribute__((target("avx512f"))), \
+    apply_to = function)
+#else
+#pragma GCC pop_options
+#pragma GCC push_options
+#pragma GCC target("avx512f")
+#endif
+
+namespace avx512 {
+
+typedef __m512 Vec;
+typedef __mmask16 Mask;
+const int kWidth = 16;
+
+inline Vec Load(const float* p) { return _mm512_loadu_ps(p); }
+inline void Store(float* p, Vec v) { _mm512_storeu_ps(p, v); }
+inline Vec Set(float v) { return _mm512_set1_ps(v); }
+inline Vec Add(Vec a, Vec b) { return _mm512_add_ps(a, b); }
+inline Vec Sub(Vec a, Vec b) { return _mm512_sub_ps(a, b); }
+inline Vec Mul(Vec a, Vec b) { return _mm512_mul_ps(a, b); }
+inline Vec Div(Vec a, Vec b) { return _mm512_div_ps(a, b); }
+inline Vec Sqrt(Vec a) { return _mm512_sqrt_ps(a); }
+inline Vec MulAdd(Vec a, Vec b, Vec c) { return _mm512_fmadd_ps(a, b, c); }
+inline Vec Max(Vec a, Vec b) { return _mm512_max_ps(a, b); }
+inline Vec Min(Vec a, Vec b) { return _mm512_min_ps(a, b); }
+inline Mask Less(Vec a, Vec b) {
+  return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+}
+inline Mask Greater(Vec a, Vec b) {
+  return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+}
+inline Mask LessEqual(Vec a, Vec b) {
+  return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);
+}
+inline Mask IsNaN(Vec a) { return _mm512_cmp_ps_mask(a, a, _CMP_UNORD_Q); }
+inline Vec Select(Mask m, Vec a, Vec b) {
+  return _mm512_mask_blend_ps(m, b, a);
+}
+// AVX-512F has the bitwise operations on integers only.
+inline Vec Abs(Vec a) {
+  return _mm512_castsi512_ps(_mm512_and_epi32(_mm512_castps_si512(a),
+      _mm512_set1_epi32(0x7fffffff)));
+}
+inline Vec CopySign(Vec a, Vec b) {
+  return _mm512_castsi512_ps(_mm512_ternarylogic_epi32(
+      _mm512_set1_epi32(0x7fffffff), _mm512_castps_si512(a),
+      _mm512_castps_si512(b), 0xca));
+}
+inline Vec Floor(Vec a) {
+  return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+inline Vec Pow2(Vec n) {
+  return _mm512_castsi512_ps(_mm512_slli_epi32(_mm512_add_epi32(
+      _mm512_cvttps_epi32(n), _mm512_set1_epi32(127)), 23));
+}
+inline Vec Frexp(Vec x, Vec* e) {
+  const __m512i bits = _mm512_castps_si512(x);
+  *e = _mm512_cvtepi32_ps(_mm512_sub_epi32(_mm512_srli_epi32(bits, 23),
+      _mm512_set1_epi32(126)));
+  return _mm512_castsi512_ps(_mm512_or_epi32(
+      _mm512_and_epi32(bits, _mm512_set1_epi32(0x007fffff)),
+      _mm512_set1_epi32(0x3f000000)));
+}
+
+#include "caffe/util/neuron_kernels_impl.hpp"
+
+}  // namespace avx512
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#endif  // CAFFE_NEURON_KERNELS_X86
+
+// The float kernels of one instruction set.
+struct NeuronKernels {
+  void (*relu)(const int, const float*, const float, float*);
+  void (*relu_backward)(const int, const float*, const float*, const float,
+      float*);
+  void (*sigmoid)(const int, const float*, float*);
+  void (*sigmoid_backward)(const int, const float*, const float*, float*);
+  void (*tanh)(const int, const float*, float*);
+  void (*tanh_backward)(const int, const float*, const float*, float*);
+  void (*elu)(const int, const float*, const float, float*);
+  void (*elu_backward)(const int, const float*, const float*, const float*,
+      const float, float*);
+  void (*bnll)(const int, const float*, float*);
+  void (*bnll_backward)(const int, const float*, const float*, float*);
+  void (*exp)(const int, const float*, float*);
+  void (*power)(const int, const float*, const float, const float,
+      const float, float*);
+};
+
+#define NEURON_KERNELS(isa) { \
+    isa::Relu, isa::ReluBackward, isa::Sigmoid, isa::SigmoidBackward, \
+    isa::TanH, isa::TanHBackward, isa::Elu, isa::EluBackward, isa::Bnll, \
+    isa::BnllBackward, isa::Exp, isa::Power }
+
+// Indexed by SimdLevel.
+const NeuronKernels kNeuronKernels[] = {
+  { cmath::Relu<float>, cmath::ReluBackward<float>, cmath::Sigmoid<float>,
+    cmath::SigmoidBackward<float>, cmath::TanH<float>,
+    cmath::TanHBackward<float>, cmath::Elu<float>, cmath::EluBackward<float>,
+    cmath::Bnll<float>, cmath::BnllBackward<float>, cmath::Exp<float>,
+    cmath::Power<float> },
+#ifdef CAFFE_NEURON_KERNELS_X86
+  NEURON_KERNELS(sse2),
+  NEURON_KERNELS(avx2),
+  NEURON_KERNELS(avx512),
+#endif
+};
+
+SimdLevel DetectSimdLevel() {
+#ifdef CAFFE_NEURON_KERNELS_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f")) {
+    return SIMD_AVX512;
+  }
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) {
+    return SIMD_AVX2;
+  }
+  if (__builtin_cpu_supports("sse2")) {
+    return SIMD_SSE2;
+  }
+#endif
+  return SIMD_SCALAR;
+}
+
+SimdLevel& current_simd_level() {
+  static SimdLevel level = max_simd_level();
+  return level;
+}
+
+inline const NeuronKernels& kernels() {
+  return kNeuronKernels[current_simd_level()];
+}
+
+}  // namespace
+
+SimdLevel max_simd_level() {
+  static const SimdLevel level = DetectSimdLevel();
+  return level;
+}
+
+SimdLevel simd_level() {
+  return current_simd_level();
+}
+
+void set_simd_level(SimdLevel level) {
+  CHECK_LE(level, max_simd_level()) << simd_level_name(level)
+      << " is not supported; the CPU has "
+      << simd_level_name(max_simd_level());
+  current_simd_level() = level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+  switch (level) {
+  case SIMD_SCALAR:
+    return "scalar";
+  case SIMD_SSE2:
+    return "SSE2";
+  case SIMD_AVX2:
+    return "AVX2";
+  case SIMD_AVX512:
+    return "AVX-512";
+  default:
+    LOG(FATAL) << "Unknown SIMD level " << level;
+    return "";
+  }
+}
+
+template <>
+void caffe_cpu_relu<float>(const int n, const float* x,
+    const float negative_slope, float* y) {
+  kernels().relu(n, x, negative_slope, y);
+}
+
+template <>
+void caffe_cpu_relu<double>(const int n, const double* x,
+    const double negative_slope, double* y) {
+  cmath::Relu(n, x, negative_slope, y);
+}
+
+template <>
+void caffe_cpu_relu_backward<float>(const int n, const float* x,
+    const float* dy, const float negative_slope, float* dx) {
+  kernels().relu_backward(n, x, dy, negative_slope, dx);
+}
+
+template <>
+void caffe_cpu_relu_backward<double>(const int n, const double* x,
+    const double* dy, const double negative_slope, double* dx) {
+  cmath::ReluBackward(n, x, dy, negative_slope, dx);
+}
+
+template <>
+void caffe_cpu_sigmoid<float>(const int n, const float* x, float* y) {
+  kernels().sigmoid(n, x, y);
+}
+
+template <>
+void caffe_cpu_sigmoid<double>(const int n, const double* x, double* y) {
+  cmath::Sigmoid(n, x, y);
+}
+
+template <>
+void caffe_cpu_sigmoid_backward<float>(const int n, const float* y,
+    const float* dy, float* dx) {
+  kernels().sigmoid_backward(n, y, dy, dx);
+}
+
+template <>
+void caffe_cpu_sigmoid_backward<double>(const int n, const double* y,
+    const double* dy, double* dx) {
+  cmath::SigmoidBackward(n, y, dy, dx);
+}
+
+template <>
+void caffe_cpu_tanh<float>(const int n, const float* x, float* y) {
+  kernels().tanh(n, x, y);
+}
+
+template <>
+void caffe_cpu_tanh<double>(const int n, const double* x, double* y) {
+  cmath::TanH(n, x, y);
+}
+
+template <>
+void caffe_cpu_tanh_backward<float>(const int n, const float* y,
+    const float* dy, float* dx) {
+  kernels().tanh_backward(n, y, dy, dx);
+}
+
+template <>
+void caffe_cpu_tanh_backward<double>(const int n, const double* y,
+    const double* dy, double* dx) {
+  cmath::TanHBackward(n, y, dy, dx);
+}
+
+template <>
+void caffe_cpu_elu<float>(const int n, const float* x, const float alpha,
+    float* y) {
+  kernels().elu(n, x, alpha, y);
+}
+
+template <>
+void caffe_cpu_elu<double>(const int n, const double* x, const double alpha,
+    double* y) {
+  cmath::Elu(n, x, alpha, y);
+}
+
+template <>
+void caffe_cpu_elu_backward<float>(const int n, const float* x,
+    const float* y, const float* dy, const float alpha, float* dx) {
+  kernels().elu_backward(n, x, y, dy, alpha, dx);
+}
+
+template <>
+void caffe_cpu_elu_backward<double>(const int n, const double* x,
+    const double* y, const double* dy, const double alpha, double* dx) {
+  cmath::EluBackward(n, x, y, dy, alpha, dx);
+}
+
+template <>
+void caffe_cpu_bnll<float>(const int n, const float* x, float* y) {
+  kernels().bnll(n, x, y);
+}
+
+template <>
+void caffe_cpu_bnll<double>(const int n, const double* x, double* y) {
+  cmath::Bnll(n, x, y);
+}
+
+template <>
+void caffe_cpu_bnll_backward<float>(const int n, const float* x,
+    const float* dy, float* dx) {
+  kernels().bnll_backward(n, x, dy, dx);
+}
+
+template <>
+void caffe_cpu_bnll_backward<double>(const int n, const double* x,
+    const double* dy, double* dx) {
+  cmath::BnllBackward(n, x, dy, dx);
+}
+
+template <>
+void caffe_cpu_fast_exp<float>(const int n, const float* x, float* y) {
+  kernels().exp(n, x, y);
+}
+
+template <>
+void caffe_cpu_fast_exp<double>(const int n, const double* x, double* y) {
+  cmath::Exp(n, x, y);
+}
+
+template <>
+void caffe_cpu_power<float>(const int n, const float* x, const float scale,
+    const float shift, const float power, float* y) {
+  kernels().power(n, x, scale, shift, power, y);
+}
+
+template <>
+void caffe_cpu_power<double>(const int n, const double* x,
+    const double scale, const double shift, const double power, double* y) {
+  cmath::Power(n, x, scale, shift, power, y);
+}
+
+}  // namespace caffe
@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/util/sample_pack.hpp"
+
+namespace caffe {
+
+static const char kSamplePackMagic[8] =
+    {'C', 'S', 'M', 'P', 'P', 'A', 'C', 'K'};
+static const uint32_t kSamplePackVersion = 1;
+
+static inline uint64_t AlignTo(uint64_t n, uint64_t alignment) {
+  return (n + alignment - 1) / alignment * alignment;
+}
+
+void SamplePack::Open(const string& filename) {
+  file_.Open(filename);
+  const char* base = file_.data();
+  CHECK_GE(file_.size(), sizeof(SamplePackHeader))
+      << filename << " is too small to be a sample pack";
+  const SamplePackHeader* header =
+      reinterpret_cast<const SamplePackHeader*>(base);
+  CHECK_EQ(memcmp(header->magic, kSamplePackMagic, sizeof(header->magic)), 0)
+      << filename << " is not a sample pack";
+  CHECK_EQ(header->version, kSamplePackVersion)
+      << "Unsupported sample pack version in " << filename;
+  CHECK_LE(header->num_samples, uint64_t(INT_MAX));
+  num_samples_ = header->num_samples;
+  const size_t labels_pos = sizeof(SamplePackHeader);
+  const size_t offsets_pos =
+      labels_pos + AlignTo(sizeof(int32_t) * num_samples_, 8);
+  const size_t sizes_pos = offsets_pos + sizeof(uint64_t) * num_samples_;
+  CHECK_GE(header->data_offset, sizes_pos + sizeof(uint64_t) * num_samples_)
+      << filename << " is truncated or corrupt";
+  labels_ = reinterpret_cast<const int32_t*>(base + labels_pos);
+  offsets_ = reinterpret_cast<const uint64_t*>(base + offsets_pos);
+  sizes_ = reinterpret_cast<const uint64_t*>(base + sizes_pos);
+  data_ = base + header->data_offset;
+  for (int i = 0; i < num_samples_; ++i) {
+    CHECK_LE(header->data_offset + offsets_[i] + sizes_[i], file_.size())
+        << filename << " is truncated or corrupt";
+  }
+  LOG(INFO) << "Mapped sample pack " << filename << " (" << num_samples_
+      << " samples)";
+}
+
+void SamplePack::Write(const string& filename, const vector<int>& labels,
+    const vector<string>& files, int alignment) {
+  CHECK_EQ(labels.size(), files.size());
+  CHECK_GT(alignment, 0);
+  const uint64_t num = files.size();
+  vector<int32_t> labels32(labels.begin(), labels.end());
+  vector<uint64_t> offsets(num), sizes(num);
+  uint64_t end = 0;
+  for (int i = 0; i < num; ++i) {
+    std::ifstream in(files[i].c_str(), std::ios::binary | std::ios::ate);
+    CHECK(in.good()) << files[i] << " data failed to read!";
+    sizes[i] = in.tellg();
+    offsets[i] = AlignTo(end, alignment);
+    end = offsets[i] + sizes[i];
+  }
+
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  CHECK(out.good()) << "Failed to open " << filename << " for writing";
+  SamplePackHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSamplePackMagic, sizeof(header.magic));
+  header.version = kSamplePackVersion;
+  header.alignment = alignment;
+  header.num_samples = num;
+  const uint64_t index_end = sizeof(header)
+      + AlignTo(sizeof(int32_t) * num, 8) + 2 * sizeof(uint64_t) * num;
+  header.data_offset = AlignTo(index_end, alignment);
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  const size_t labels_bytes = sizeof(int32_t) * num;
+  if (num > 0) {
+    out.write(reinterpret_cast<const char*>(&labels32[0]), labels_bytes);
+  }
+  const vector<char> padding(std::max(alignment, 8), 0);
+  out.write(&padding[0], AlignTo(labels_bytes, 8) - labels_bytes);
+  if (num > 0) {
+    out.write(reinterpret_cast<const char*>(&offsets[0]),
+        sizeof(uint64_t) * num);
+    out.write(reinterpret_cast<const char*>(&sizes[0]),
+        sizeof(uint64_t) * num);
+  }
+  out.write(&padding[0], header.data_offset - index_end);
+
+  vector<char> buffer;
+  uint64_t pos = 0;
+  for (int i = 0; i < num; ++i) {
+    out.write(&padding[0], offsets[i] - pos);
+    std::ifstream in(files[i].c_str(), std::ios::binary);
+    CHECK(in.good()) << files[i] << " data failed to read!";
+    buffer.resize(sizes[i]);
+    if (sizes[i] > 0) {
+      CHECK(in.read(&buffer[0], sizes[i])) << files[i] << " changed size";
+      out.write(&buffer[0], sizes[i]);
+    }
+    pos = offsets[i] + sizes[i];
+  }
+  CHECK(out.good()) << "Failed to write " << filename;
+  out.close();
+}
+
+}  // namespace caffe
@@ -0,0 +1,96 @@
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+#include <exception>
+
+#include "caffe/util/rng.hpp"
+#include "caffe/util/sample_permutation.hpp"
+
+namespace caffe {
+
+SamplePermutation::SamplePermutation(int size, bool shuffle,
+    unsigned int seed, int rank, int world_size)
+    : position_(0), epoch_(0), shuffle_(shuffle), total_(size), rank_(rank),
+      world_size_(world_size), seed_(seed), rng_(new Caffe::RNG(seed)) {
+  CHECK_GT(world_size_, 0) << "world_size should be positive";
+  CHECK_GE(rank_, 0) << "rank should not be negative";
+  CHECK_LT(rank_, world_size_) << "rank should be below world_size";
+  const int shard_size = (total_ - rank_ + world_size_ - 1) / world_size_;
+  CHECK_GT(shard_size, 0) << "no samples to visit";
+  current_.resize(shard_size);
+  for (int i = 0; i < shard_size; ++i) {
+    current_[i] = i;
+  }
+  if (shuffle_) {
+    if (world_size_ > 1) {
+      PermuteShard(0, &current_);
+    } else {
+      caffe::rng_t* rng = static_cast<caffe::rng_t*>(rng_->generator());
+      caffe::shuffle(current_.begin(), current_.end(), rng);
+      next_ = current_;
+    }
+    StartNext();
+  }
+}
+
+SamplePermutation::~SamplePermutation() {
+  Join();
+}
+
+void SamplePermutation::ShuffleNext() {
+  caffe::rng_t* rng = static_cast<caffe::rng_t*>(rng_->generator());
+  caffe::shuffle(next_.begin(), next_.end(), rng);
+}
+
+void SamplePermutation::PermuteShard(int epoch,
+    vector<uint32_t>* order) const {
+  // Every (epoch, rank) pair has a seed of its own, so that the shards do
+  // not visit their samples in the same relative order.
+  order->resize(current_.size());
+  for (int i = 0; i < order->size(); ++i) {
+    (*order)[i] = i;
+  }
+  Caffe::RNG epoch_rng(seed_ + unsigned(epoch) * world_size_ + rank_);
+  caffe::rng_t* rng = static_cast<caffe::rng_t*>(epoch_rng.generator());
+  caffe::shuffle(order->begin(), order->end(), rng);
+}
+
+void SamplePermutation::StartNext() {
+  try {
+    if (world_size_ > 1) {
+      thread_.reset(new boost::thread(boost::bind(
+          &SamplePermutation::PermuteShard, this, epoch_ + 1, &next_)));
+    } else {
+      thread_.reset(new boost::thread(&SamplePermutation::ShuffleNext, this));
+    }
+  } catch (std::exception& e) {
+    LOG(FATAL) << "Thread exception: " << e.what();
+  }
+}
+
+void SamplePermutation::Join() {
+  if (thread_) {
+    // The thread owns next_ until it is done, interrupted or not.
+    boost::this_thread::disable_interruption no_interruption;
+    thread_->join();
+    thread_.reset();
+  }
+}
+
+uint32_t SamplePermutation::Next() {
+  const uint32_t index = current_[position_];
+  if (++position_ == current_.size()) {
+    position_ = 0;
+    ++epoch_;
+    if (shuffle_) {
+      // Normally done long ago. The order of the epoch after this one is
+      // computed in the background, reshuffling the finished epoch's order
+      // unless it is drawn from the shared seed.
+      Join();
+      current_.swap(next_);
+      StartNext();
+    }
+  }
+  return index;
+}
+
+}  // namespace caffe
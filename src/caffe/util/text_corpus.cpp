@@ -0,0 +1,227 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/util/text_corpus.hpp"
+
+namespace caffe {
+
+static const char kTextCorpusMagic[8] = {'C', 'T', 'X', 'T', 'C', 'R', 'P', 'S'};
+static const uint32_t kTextCorpusVersion = 1;
+
+static inline size_t AlignTo8(size_t n) { return (n + 7) & ~size_t(7); }
+
+bool TextCorpus::IsBinary(const string& filename) {
+  std::ifstream file(filename.c_str(), std::ios::binary);
+  char magic[sizeof(kTextCorpusMagic)];
+  if (!file.read(magic, sizeof(magic))) {
+    return false;
+  }
+  return memcmp(magic, kTextCorpusMagic, sizeof(magic)) == 0;
+}
+
+// Number of the samples 0, ..., total - 1 that are congruent to rank.
+static inline int ShardSize(int total, int rank, int world_size) {
+  return (total - rank + world_size - 1) / world_size;
+}
+
+static void CheckShard(int rank, int world_size) {
+  CHECK_GT(world_size, 0) << "world_size should be positive";
+  CHECK_GE(rank, 0) << "rank should not be negative";
+  CHECK_LT(rank, world_size) << "rank should be below world_size";
+}
+
+void TextCorpus::Open(const string& filename, int rank, int world_size) {
+  CheckShard(rank, world_size);
+  file_.Open(filename);
+  const char* base = file_.data();
+  CHECK_GE(file_.size(), sizeof(TextCorpusHeader))
+      << filename << " is too small to be a text corpus";
+  const TextCorpusHeader* header =
+      reinterpret_cast<const TextCorpusHeader*>(base);
+  CHECK_EQ(memcmp(header->magic, kTextCorpusMagic, sizeof(header->magic)), 0)
+      << filename << " is not a binary text corpus";
+  CHECK_EQ(header->version, kTextCorpusVersion)
+      << "Unsupported text corpus version in " << filename;
+  CHECK_LE(header->num_samples, uint64_t(INT_MAX));
+  total_samples_ = header->num_samples;
+  num_samples_ = ShardSize(total_samples_, rank, world_size);
+  first_ = rank;
+  stride_ = world_size;
+  num_tokens_ = header->num_tokens;
+  const size_t labels_pos = sizeof(TextCorpusHeader);
+  const size_t offsets_pos =
+      labels_pos + AlignTo8(sizeof(int32_t) * total_samples_);
+  const size_t tokens_pos =
+      offsets_pos + sizeof(uint64_t) * (total_samples_ + 1);
+  CHECK_EQ(file_.size(), tokens_pos + sizeof(int32_t) * num_tokens_)
+      << filename << " is truncated or corrupt";
+  labels_ = reinterpret_cast<const int32_t*>(base + labels_pos);
+  offsets_ = reinterpret_cast<const uint64_t*>(base + offsets_pos);
+  tokens_ = reinterpret_cast<const int32_t*>(base + tokens_pos);
+  // length() and tokens() trust the offsets: increasing up to num_tokens_,
+  // every sample lies in the file.
+  CHECK_EQ(offsets_[total_samples_], num_tokens_)
+      << filename << " has inconsistent offsets";
+  for (int i = 0; i < total_samples_; ++i) {
+    CHECK_LE(offsets_[i], offsets_[i + 1])
+        << filename << " has inconsistent offsets at sample " << i;
+  }
+  LOG(INFO) << "Mapped text corpus " << filename << " (" << total_samples_
+      << " samples, " << num_tokens_ << " tokens)";
+  if (world_size > 1) {
+    LOG(INFO) << "Reading the " << num_samples_ << " samples of shard "
+        << rank << " of " << world_size;
+  }
+}
+
+void ParseTextTokens(const string& line, vector<int32_t>* tokens) {
+  const char* p = line.c_str();
+  char* end = NULL;
+  for (long index = strtol(p, &end, 10); end != p;  // NOLINT(runtime/int)
+       index = strtol(p, &end, 10)) {
+    tokens->push_back(static_cast<int32_t>(index));
+    p = end;
+  }
+}
+
+// Reads the labels of the shard of rank from a label file, which starts
+// with the number of samples. Returns that number.
+static int ReadTextLabels(const string& label_source, int rank,
+    int world_size, vector<int32_t>* labels) {
+  std::ifstream flabel(label_source.c_str());
+  CHECK(flabel.good()) << "file " << label_source << " read error";
+  string line;
+  std::getline(flabel, line);
+  int num = 0;
+  int len = sscanf(line.c_str(), "%d", &num);
+  CHECK_GT(len, 0);
+  labels->clear();
+  labels->reserve(ShardSize(num, rank, world_size));
+  int temp_label = 0;
+  int read = 0;
+  while (flabel >> temp_label) {
+    CHECK_LT(read, num);
+    if (read++ % world_size == rank) {
+      labels->push_back(temp_label);
+    }
+  }
+  flabel.close();
+  CHECK_EQ(read, num);
+  LOG(INFO) << "read label done (" << num << " samples)";
+  return num;
+}
+
+void TextCorpus::LoadText(const string& label_source,
+    const string& data_source, int rank, int world_size) {
+  CheckShard(rank, world_size);
+  const int num = ReadTextLabels(label_source, rank, world_size,
+      &own_labels_);
+  const int shard_size = own_labels_.size();
+  string line;
+
+  // read content, one sample per line
+  std::ifstream fdata(data_source.c_str());
+  CHECK(fdata.good()) << "fail to open " << data_source;
+  own_offsets_.reserve(shard_size + 1);
+  own_offsets_.push_back(0);
+  int read = 0;
+  while (std::getline(fdata, line)) {
+    CHECK_LT(read, num);
+    // The lines of other shards are skipped without tokenizing them.
+    if (read++ % world_size == rank) {
+      ParseTextTokens(line, &own_tokens_);
+      own_offsets_.push_back(own_tokens_.size());
+    }
+  }
+  fdata.close();
+  CHECK_EQ(read, num);
+  LOG(INFO) << "read content done: #" << shard_size << " samples, "
+      << own_tokens_.size() << " tokens.";
+  if (world_size > 1) {
+    LOG(INFO) << "Kept shard " << rank << " of " << world_size << " out of "
+        << num << " samples";
+  }
+
+  num_samples_ = shard_size;
+  total_samples_ = num;
+  first_ = 0;
+  stride_ = 1;
+  num_tokens_ = own_tokens_.size();
+  labels_ = own_labels_.empty() ? NULL : &own_labels_[0];
+  offsets_ = &own_offsets_[0];
+  tokens_ = own_tokens_.empty() ? NULL : &own_tokens_[0];
+}
+
+void RawTextCorpus::Open(const string& label_source,
+    const string& data_source, int rank, int world_size) {
+  CheckShard(rank, world_size);
+  total_samples_ = ReadTextLabels(label_source, rank, world_size, &labels_);
+  file_.Open(data_source);
+  const char* base = file_.data();
+  const char* end = base + file_.size();
+  begins_.clear();
+  lengths_.clear();
+  begins_.reserve(labels_.size());
+  lengths_.reserve(labels_.size());
+  int read = 0;
+  for (const char* line = base; line < end; ++read) {
+    const char* newline = static_cast<const char*>(
+        memchr(line, '\n', end - line));
+    const char* line_end = newline ? newline : end;
+    CHECK_LT(read, total_samples_) << data_source
+        << " has more lines than labels";
+    if (read % world_size == rank) {
+      begins_.push_back(line - base);
+      lengths_.push_back(line_end - line);
+    }
+    line = line_end + 1;
+  }
+  CHECK_EQ(read, total_samples_) << data_source
+      << " has fewer lines than labels";
+  LOG(INFO) << "Mapped raw text " << data_source << " (" << total_samples_
+      << " samples)";
+}
+
+void TextCorpus::Save(const string& filename) const {
+  CHECK_EQ(stride_, 1) << "Cannot save a shard of a mapped corpus";
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  CHECK(out.good()) << "Failed to open " << filename << " for writing";
+  TextCorpusHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kTextCorpusMagic, sizeof(header.magic));
+  header.version = kTextCorpusVersion;
+  header.num_samples = num_samples_;
+  header.num_tokens = num_tokens_;
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  const size_t labels_bytes = sizeof(int32_t) * num_samples_;
+  out.write(reinterpret_cast<const char*>(labels_), labels_bytes);
+  const char padding[8] = {0};
+  out.write(padding, AlignTo8(labels_bytes) - labels_bytes);
+  out.write(reinterpret_cast<const char*>(offsets_),
+      sizeof(uint64_t) * (num_samples_ + 1));
+  out.write(reinterpret_cast<const char*>(tokens_),
+      sizeof(int32_t) * num_tokens_);
+  CHECK(out.good()) << "Failed to write " << filename;
+  out.close();
+}
+
+void TextCorpus::RemapTokens(const vector<int32_t>& new_index) {
+  if (num_tokens_ == 0) {
+    return;
+  }
+  if (own_tokens_.empty() || tokens_ != &own_tokens_[0]) {
+    own_tokens_.assign(tokens_, tokens_ + num_tokens_);
+    tokens_ = &own_tokens_[0];
+  }
+  for (size_t i = 0; i < own_tokens_.size(); ++i) {
+    CHECK_GE(own_tokens_[i], 0) << "Negative word index in the corpus";
+    CHECK_LT(own_tokens_[i], new_index.size())
+        << "Word index " << own_tokens_[i] << " is not remapped";
+    own_tokens_[i] = new_index[own_tokens_[i]];
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,88 @@
+#include <cstdio>
+#include <fstream>  // NOLINT(readability/streams)
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "caffe/util/text_stream.hpp"
+
+namespace caffe {
+
+TextShardReader::TextShardReader(const string& shard_list, int rank,
+    int world_size)
+    : shard_(-1), remaining_(0) {
+  CHECK_GT(world_size, 0) << "world_size should be positive";
+  CHECK_GE(rank, 0) << "rank should not be negative";
+  CHECK_LT(rank, world_size) << "rank should be below world_size";
+  std::ifstream list(shard_list.c_str());
+  CHECK(list.good()) << "fail to open " << shard_list;
+  string line;
+  int listed = 0;
+  while (std::getline(list, line)) {
+    std::istringstream fields(line);
+    string label_file, data_file;
+    if (!(fields >> label_file)) {
+      continue;
+    }
+    fields >> data_file;
+    if (listed++ % world_size == rank) {
+      shards_.push_back(std::make_pair(label_file, data_file));
+    }
+  }
+  CHECK_GT(shards_.size(), 0) << "no shards listed in " << shard_list
+      << " for rank " << rank << " of " << world_size;
+  LOG(INFO) << "Streaming " << shards_.size() << " of the " << listed
+      << " shards listed in " << shard_list;
+}
+
+void TextShardReader::OpenShard(int shard) {
+  const string& label_source = shards_[shard].first;
+  const string& data_source = shards_[shard].second;
+  corpus_.reset();
+  label_file_.close();
+  data_file_.close();
+  if (data_source.empty()) {
+    corpus_.reset(new TextCorpus());
+    corpus_->Open(label_source);
+    remaining_ = corpus_->num_samples();
+  } else {
+    label_file_.clear();
+    label_file_.open(label_source.c_str());
+    CHECK(label_file_.good()) << "file " << label_source << " read error";
+    std::getline(label_file_, line_);
+    int num = 0;
+    CHECK_GT(sscanf(line_.c_str(), "%d", &num), 0);
+    data_file_.clear();
+    data_file_.open(data_source.c_str());
+    CHECK(data_file_.good()) << "fail to open " << data_source;
+    remaining_ = num;
+  }
+  DLOG(INFO) << "Opened shard " << label_source << " (" << remaining_
+      << " samples)";
+}
+
+void TextShardReader::Read(TextSample* sample) {
+  // Skip over empty shards, but not forever.
+  for (int tries = 0; remaining_ == 0; ++tries) {
+    CHECK_LE(tries, shards_.size()) << "all shards are empty";
+    shard_ = (shard_ + 1) % shards_.size();
+    OpenShard(shard_);
+  }
+  sample->tokens.clear();
+  if (corpus_) {
+    const int i = corpus_->num_samples() - remaining_;
+    sample->label = corpus_->label(i);
+    sample->tokens.assign(corpus_->tokens(i),
+        corpus_->tokens(i) + corpus_->length(i));
+  } else {
+    CHECK(label_file_ >> sample->label)
+        << "missing labels in " << shards_[shard_].first;
+    CHECK(std::getline(data_file_, line_))
+        << "missing content in " << shards_[shard_].second;
+    ParseTextTokens(line_, &sample->tokens);
+  }
+  --remaining_;
+}
+
+}  // namespace caffe
@@ -0,0 +1,85 @@
+#include <boost/thread.hpp>
+#include <exception>
+
+#include "caffe/util/thread_pool.hpp"
+
+namespace caffe {
+
+class ThreadPool::sync {
+ public:
+  boost::mutex mutex_;
+  boost::condition_variable start_;
+  boost::condition_variable done_;
+};
+
+ThreadPool::ThreadPool(int num_threads)
+    : num_threads_(num_threads), sync_(new sync()), generation_(0),
+      pending_(0), stop_(false) {
+  CHECK_GT(num_threads_, 0);
+  try {
+    for (int i = 1; i < num_threads_; ++i) {
+      threads_.push_back(shared_ptr<boost::thread>(
+          new boost::thread(&ThreadPool::entry, this, i)));
+    }
+  } catch (std::exception& e) {
+    LOG(FATAL) << "Thread exception: " << e.what();
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    stop_ = true;
+  }
+  sync_->start_.notify_all();
+  for (int i = 0; i < threads_.size(); ++i) {
+    threads_[i]->join();
+  }
+}
+
+void ThreadPool::entry(int worker_id) {
+  size_t seen = 0;
+  while (true) {
+    boost::function<void(int)> task;
+    {
+      boost::mutex::scoped_lock lock(sync_->mutex_);
+      while (!stop_ && generation_ == seen) {
+        sync_->start_.wait(lock);
+      }
+      if (stop_) {
+        return;
+      }
+      seen = generation_;
+      task = task_;
+    }
+    task(worker_id);
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    if (--pending_ == 0) {
+      sync_->done_.notify_one();
+    }
+  }
+}
+
+void ThreadPool::Run(const boost::function<void(int)>& task) {
+  if (num_threads_ == 1) {
+    task(0);
+    return;
+  }
+  // The workers use state owned by the caller until they are done, so the
+  // wait below must not be cut short by a thread interruption.
+  boost::this_thread::disable_interruption no_interruption;
+  {
+    boost::mutex::scoped_lock lock(sync_->mutex_);
+    task_ = task;
+    pending_ = num_threads_ - 1;
+    ++generation_;
+  }
+  sync_->start_.notify_all();
+  task(0);
+  boost::mutex::scoped_lock lock(sync_->mutex_);
+  while (pending_ > 0) {
+    sync_->done_.wait(lock);
+  }
+}
+
+}  // namespace caffe
@@ -0,0 +1,165 @@
+#include <cstring>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "caffe/util/vocab_hash.hpp"
+
+namespace caffe {
+
+static const char kVocabHashMagic[8] = {'C', 'V', 'O', 'C', 'A', 'B', 'H', 'T'};
+static const uint32_t kVocabHashVersion = 1;
+
+// 64-bit FNV-1a.
+static inline uint64_t HashWord(const char* word, size_t length) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (size_t i = 0; i < length; ++i) {
+    hash ^= static_cast<unsigned char>(word[i]);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+// Only ASCII bytes can be whitespace, and they never occur inside the
+// multibyte sequences of UTF-8.
+static inline bool IsSpace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v'
+      || c == '\f';
+}
+
+void VocabHash::Open(const string& filename) {
+  file_.Open(filename);
+  const char* base = file_.data();
+  CHECK_GE(file_.size(), sizeof(VocabHashHeader))
+      << filename << " is too small to be a vocab hash";
+  const VocabHashHeader* header =
+      reinterpret_cast<const VocabHashHeader*>(base);
+  CHECK_EQ(memcmp(header->magic, kVocabHashMagic, sizeof(header->magic)), 0)
+      << filename << " is not a compiled vocabulary";
+  CHECK_EQ(header->version, kVocabHashVersion)
+      << "Unsupported vocab hash version in " << filename;
+  CHECK_GT(header->num_slots, header->num_words);
+  CHECK_EQ(header->num_slots & (header->num_slots - 1), 0)
+      << filename << " is corrupt";
+  CHECK_LE(header->num_slots,
+      (file_.size() - sizeof(VocabHashHeader)) / sizeof(VocabHashSlot))
+      << filename << " is truncated or corrupt";
+  const size_t words_pos =
+      sizeof(VocabHashHeader) + sizeof(VocabHashSlot) * header->num_slots;
+  CHECK_EQ(file_.size() - words_pos, header->word_bytes)
+      << filename << " is truncated or corrupt";
+  slots_ = reinterpret_cast<const VocabHashSlot*>(
+      base + sizeof(VocabHashHeader));
+  words_ = base + words_pos;
+  // Find() trusts the slots: every word it may compare must lie in the file,
+  // and an empty slot must end every probe.
+  uint64_t occupied = 0;
+  for (uint64_t i = 0; i < header->num_slots; ++i) {
+    const VocabHashSlot& slot = slots_[i];
+    if (slot.id < 0) {
+      continue;
+    }
+    CHECK_LT(uint32_t(slot.id), header->num_words)
+        << filename << " is corrupt";
+    CHECK_LE(uint64_t(slot.offset) + slot.length, header->word_bytes)
+        << filename << " is corrupt";
+    ++occupied;
+  }
+  CHECK_EQ(occupied, header->num_words) << filename << " is corrupt";
+  num_words_ = header->num_words;
+  mask_ = header->num_slots - 1;
+  LOG(INFO) << "Mapped vocabulary " << filename << " (" << num_words_
+      << " words)";
+}
+
+void VocabHash::Write(const string& filename, const vector<string>& words) {
+  uint64_t num_slots = 1;
+  while (num_slots < 2 * words.size() + 1) {
+    num_slots *= 2;
+  }
+  const uint64_t mask = num_slots - 1;
+  vector<VocabHashSlot> slots(num_slots);
+  for (uint64_t i = 0; i < num_slots; ++i) {
+    slots[i].hash = 0;
+    slots[i].id = -1;
+    slots[i].offset = 0;
+    slots[i].length = 0;
+  }
+  string word_bytes;
+  for (int i = 0; i < words.size(); ++i) {
+    const string& word = words[i];
+    CHECK(!word.empty()) << "Word " << i << " is empty";
+    const uint64_t hash = HashWord(word.data(), word.size());
+    uint64_t slot = hash & mask;
+    while (slots[slot].id >= 0) {
+      CHECK(!(slots[slot].length == word.size()
+          && word_bytes.compare(slots[slot].offset, word.size(), word) == 0))
+          << "Word " << word << " is listed twice";
+      slot = (slot + 1) & mask;
+    }
+    CHECK_LE(word_bytes.size() + word.size(), uint64_t(0xffffffffu))
+        << "The words take more than 4 GB";
+    slots[slot].hash = static_cast<uint32_t>(hash);
+    slots[slot].id = i;
+    slots[slot].offset = word_bytes.size();
+    slots[slot].length = word.size();
+    word_bytes += word;
+  }
+
+  std::ofstream out(filename.c_str(), std::ios::binary | std::ios::trunc);
+  CHECK(out.good()) << "Failed to open " << filename << " for writing";
+  VocabHashHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kVocabHashMagic, sizeof(header.magic));
+  header.version = kVocabHashVersion;
+  header.num_words = words.size();
+  header.num_slots = num_slots;
+  header.word_bytes = word_bytes.size();
+  out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char*>(&slots[0]),
+      sizeof(VocabHashSlot) * num_slots);
+  out.write(word_bytes.data(), word_bytes.size());
+  CHECK(out.good()) << "Failed to write " << filename;
+  out.close();
+}
+
+int32_t VocabHash::Find(const char* word, size_t length) const {
+  const uint64_t hash = HashWord(word, length);
+  const uint32_t hash32 = static_cast<uint32_t>(hash);
+  for (uint64_t slot = hash & mask_; ; slot = (slot + 1) & mask_) {
+    const VocabHashSlot& entry = slots_[slot];
+    if (entry.id < 0) {
+      return -1;
+    }
+    if (entry.hash == hash32 && entry.length == length
+        && memcmp(words_ + entry.offset, word, length) == 0) {
+      return entry.id;
+    }
+  }
+}
+
+void VocabHash::Tokenize(const char* text, size_t length, int32_t unknown_id,
+    vector<int32_t>* ids) const {
+  const char* end = text + length;
+  const char* p = text;
+  while (true) {
+    while (p < end && IsSpace(*p)) {
+      ++p;
+    }
+    if (p == end) {
+      break;
+    }
+    const char* word = p;
+    while (p < end && !IsSpace(*p)) {
+      ++p;
+    }
+    const int32_t id = Find(word, p - word);
+    if (id >= 0) {
+      ids->push_back(id);
+    } else if (unknown_id >= 0) {
+      ids->push_back(unknown_id);
+    }
+  }
+}
+
+}  // namespace caffe
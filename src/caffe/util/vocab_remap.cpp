@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "caffe/util/vocab_remap.hpp"
+
+namespace caffe {
+
+void VocabRemap::Load(const string& filename) {
+  std::ifstream file(filename.c_str());
+  CHECK(file.good()) << "Failed to open vocab remap " << filename;
+  new_index_.clear();
+  int32_t index;
+  while (file >> index) {
+    new_index_.push_back(index);
+  }
+  CHECK(file.eof()) << filename << " is not a vocab remap";
+  // Every new index is taken exactly once.
+  vector<bool> taken(new_index_.size(), false);
+  for (int i = 0; i < new_index_.size(); ++i) {
+    CHECK_GE(new_index_[i], 0) << "Bad index on line " << i + 1
+        << " of " << filename;
+    CHECK_LT(new_index_[i], new_index_.size()) << "Bad index on line "
+        << i + 1 << " of " << filename;
+    CHECK(!taken[new_index_[i]]) << "Index " << new_index_[i]
+        << " is taken twice in " << filename;
+    taken[new_index_[i]] = true;
+  }
+  LOG(INFO) << "Read vocab remap of " << new_index_.size() << " words from "
+      << filename;
+}
+
+void VocabRemap::Save(const string& filename) const {
+  std::ofstream file(filename.c_str(), std::ios::trunc);
+  CHECK(file.good()) << "Failed to open " << filename << " for writing";
+  for (int i = 0; i < new_index_.size(); ++i) {
+    file << new_index_[i] << "\n";
+  }
+  CHECK(file.good()) << "Failed to write " << filename;
+}
+
+void VocabRemap::ByFrequency(const TextCorpus& corpus, int num_words) {
+  CHECK_GT(num_words, 0);
+  // Sort (-count, word) pairs, which orders by decreasing count and breaks
+  // ties by the old index.
+  vector<std::pair<int64_t, int32_t> > counts(num_words);
+  for (int i = 0; i < num_words; ++i) {
+    counts[i] = std::make_pair(int64_t(0), int32_t(i));
+  }
+  for (int i = 0; i < corpus.num_samples(); ++i) {
+    const int32_t* tokens = corpus.tokens(i);
+    for (int j = 0; j < corpus.length(i); ++j) {
+      CHECK_GE(tokens[j], 0) << "Sample " << i << " has a negative index";
+      CHECK_LT(tokens[j], num_words) << "Sample " << i
+          << " has an index beyond the vocabulary";
+      --counts[tokens[j]].first;
+    }
+  }
+  std::sort(counts.begin(), counts.end());
+  new_index_.resize(num_words);
+  for (int i = 0; i < num_words; ++i) {
+    new_index_[counts[i].second] = i;
+  }
+}
+
+}  // namespace caffe
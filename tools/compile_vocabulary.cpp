@@ -0,0 +1,59 @@
+// This program compiles a vocabulary into the hash table that TextData
+// layers with a vocab_source look raw text up in. Word i of the vocabulary
+// is the first whitespace-separated field of line i, and maps to row i of
+// the dict.
+// Usage:
+//   compile_vocabulary VOCAB_TEXT VOCAB_HASH
+
+#include <fstream>  // NOLINT(readability/streams)
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/util/vocab_hash.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::string;
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Compile a vocabulary into the hash table read\n"
+        "by TextData layers with a vocab_source.\n"
+        "Usage:\n"
+        "    compile_vocabulary VOCAB_TEXT VOCAB_HASH\n"
+        "Word i is the first field of line i of VOCAB_TEXT.\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 3) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/compile_vocabulary");
+    return 1;
+  }
+
+  std::ifstream infile(argv[1]);
+  CHECK(infile.good()) << "Failed to open " << argv[1];
+  vector<string> words;
+  string line;
+  while (std::getline(infile, line)) {
+    std::istringstream fields(line);
+    string word;
+    fields >> word;
+    CHECK(!word.empty()) << argv[1] << ":" << words.size() + 1
+        << " has no word";
+    words.push_back(word);
+  }
+  CHECK_GT(words.size(), 0) << argv[1] << " is empty";
+
+  VocabHash::Write(argv[2], words);
+  LOG(INFO) << "Wrote " << words.size() << " words to " << argv[2];
+  return 0;
+}
@@ -0,0 +1,70 @@
+// This program converts a whitespace-separated text embedding dictionary,
+// as read by the TextData and DictEmbed layers, into the binary format that
+// those layers memory-map.
+// Usage:
+//   convert_embedding_dict [FLAGS] TEXT_DICT BINARY_DICT
+
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/util/embedding_dict.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+DEFINE_int32(dim, 300, "Width of each embedding row");
+DEFINE_string(dtype, "float",
+    "The type {float, double} the table is stored as");
+
+template <typename Dtype>
+int convert(const char* input, const char* output) {
+  std::ifstream fdict(input);
+  CHECK(fdict.good()) << "fail to open " << input;
+  vector<Dtype> table;
+  Dtype value;
+  while (fdict >> value) {
+    table.push_back(value);
+  }
+  CHECK_GT(table.size(), 0) << input << " is empty";
+  CHECK_EQ(table.size() % FLAGS_dim, 0)
+      << "dict size should be a multiple of dim " << FLAGS_dim;
+  const int rows = table.size() / FLAGS_dim;
+  EmbeddingDict::Write(output, rows, FLAGS_dim, &table[0]);
+  LOG(INFO) << "Wrote " << rows << " x " << FLAGS_dim << " " << FLAGS_dtype
+      << " dict to " << output;
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Convert a text embedding dictionary to the\n"
+        "binary format memory-mapped by TextData and DictEmbed layers.\n"
+        "Usage:\n"
+        "    convert_embedding_dict [FLAGS] TEXT_DICT BINARY_DICT\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 3) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0],
+        "tools/convert_embedding_dict");
+    return 1;
+  }
+  CHECK_GT(FLAGS_dim, 0);
+
+  if (FLAGS_dtype == "float") {
+    return convert<float>(argv[1], argv[2]);
+  } else if (FLAGS_dtype == "double") {
+    return convert<double>(argv[1], argv[2]);
+  }
+  LOG(FATAL) << "Unknown dtype " << FLAGS_dtype;
+  return 1;
+}
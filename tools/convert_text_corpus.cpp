@@ -0,0 +1,43 @@
+// This program converts a text corpus in the TextData/DictIndexData format
+// into the binary, memory-mappable corpus read through `corpus_source`.
+// Usage:
+//   convert_text_corpus LABEL_SOURCE DATA_SOURCE CORPUS_FILE
+//
+// where LABEL_SOURCE starts with the number of samples followed by one label
+// per sample, and DATA_SOURCE holds one line of space-separated word indices
+// per sample.
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/util/text_corpus.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Convert a label/content text corpus to the\n"
+        "binary corpus format used by TextData and DictIndexData layers.\n"
+        "Usage:\n"
+        "    convert_text_corpus LABEL_SOURCE DATA_SOURCE CORPUS_FILE\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 4) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/convert_text_corpus");
+    return 1;
+  }
+
+  TextCorpus corpus;
+  corpus.LoadText(argv[1], argv[2]);
+  corpus.Save(argv[3]);
+  LOG(INFO) << "Wrote " << corpus.num_samples() << " samples and "
+      << corpus.num_tokens() << " tokens to " << argv[3];
+  return 0;
+}
@@ -0,0 +1,200 @@
+// This program measures how fast a data layer delivers batches, without the
+// rest of the net. The layer is built alone from a model definition and
+// Forward is called back to back, so the prefetch thread runs at full
+// speed; the report is the throughput it sustains, the latency of its
+// load_batch calls, and how both scale with the number of worker threads.
+// Usage:
+//   data_benchmark [FLAGS] MODEL
+//
+// The worker sweep applies to the layers with a num_workers parameter:
+// TextData, DictIndexData and NlpData. Data and ImageData are measured once.
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "boost/algorithm/string.hpp"
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/common.hpp"
+#include "caffe/layer.hpp"
+#include "caffe/layer_factory.hpp"
+#include "caffe/layers/base_data_layer.hpp"
+#include "caffe/net.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/benchmark.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::string;
+
+DEFINE_string(layer, "",
+    "Name of the data layer to measure; by default the first one");
+DEFINE_string(phase, "TRAIN", "The phase {TRAIN, TEST} the net is built for");
+DEFINE_int32(iterations, 100, "Number of batches measured per run");
+DEFINE_int32(warmup, 5, "Number of batches taken before measuring");
+DEFINE_string(workers, "",
+    "Comma-separated numbers of worker threads to run with, e.g. 1,2,4,8; "
+    "by default the layer's own setting");
+
+// Sets the number of worker threads of param, if its type has one.
+static bool SetNumWorkers(LayerParameter* param, int num_workers) {
+  if (param->type() == "TextData") {
+    param->mutable_text_data_param()->set_num_workers(num_workers);
+  } else if (param->type() == "DictIndexData") {
+    param->mutable_dictindex_data_param()->set_num_workers(num_workers);
+  } else if (param->type() == "NlpData") {
+    param->mutable_nlp_data_param()->set_num_workers(num_workers);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+struct RunResult {
+  double samples_per_s;
+  double mb_per_s;
+  PrefetchStats stats;
+};
+
+static RunResult Run(const LayerParameter& param) {
+  shared_ptr<Layer<float> > layer = LayerRegistry<float>::CreateLayer(param);
+  BasePrefetchingDataLayer<float>* data_layer =
+      dynamic_cast<BasePrefetchingDataLayer<float>*>(layer.get());
+  CHECK(data_layer) << param.name() << " is not a prefetching data layer";
+  vector<Blob<float>*> bottom;
+  vector<shared_ptr<Blob<float> > > top_blobs;
+  vector<Blob<float>*> top;
+  for (int i = 0; i < param.top_size(); ++i) {
+    top_blobs.push_back(shared_ptr<Blob<float> >(new Blob<float>()));
+    top.push_back(top_blobs.back().get());
+  }
+  layer->SetUp(bottom, top);
+
+  for (int i = 0; i < FLAGS_warmup; ++i) {
+    layer->Forward(bottom, top);
+  }
+  // Take the batches prefetched meanwhile, so that the timed Forwards wait
+  // for loads rather than start from a full queue. A layer that loads
+  // faster than Forward takes its batches never lets the queue empty; the
+  // drain then gives up after as many batches as the queue holds.
+  data_layer->ResetPrefetchStats();
+  for (int i = 0; i <= data_layer->prefetch_stats().depth
+       && data_layer->prefetch_stats().starved == 0; ++i) {
+    layer->Forward(bottom, top);
+  }
+  data_layer->ResetPrefetchStats();
+  size_t samples = 0, bytes = 0;
+  CPUTimer timer;
+  timer.Start();
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    layer->Forward(bottom, top);
+    samples += top[0]->shape(0);
+    for (int j = 0; j < top.size(); ++j) {
+      bytes += top[j]->count() * sizeof(float);
+    }
+  }
+  const double seconds = timer.MicroSeconds() / 1e6;
+  RunResult result;
+  result.samples_per_s = samples / seconds;
+  result.mb_per_s = bytes / seconds / (1 << 20);
+  result.stats = data_layer->prefetch_stats();
+  return result;
+}
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Measure the throughput of a data layer alone.\n"
+        "Usage:\n"
+        "    data_benchmark [FLAGS] MODEL\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 2) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/data_benchmark");
+    return 1;
+  }
+  CHECK_GT(FLAGS_iterations, 0);
+  CHECK_GE(FLAGS_warmup, 0);
+
+  Phase phase = TRAIN;
+  if (FLAGS_phase == "TRAIN") {
+    phase = TRAIN;
+  } else if (FLAGS_phase == "TEST") {
+    phase = TEST;
+  } else {
+    LOG(FATAL) << "Unknown phase " << FLAGS_phase;
+  }
+  Caffe::set_mode(Caffe::CPU);
+
+  NetParameter model;
+  ReadNetParamsFromTextFileOrDie(argv[1], &model);
+  model.mutable_state()->set_phase(phase);
+  NetParameter filtered;
+  Net<float>::FilterNet(model, &filtered);
+  int layer_id = 0;
+  for (; layer_id < filtered.layer_size(); ++layer_id) {
+    const LayerParameter& layer = filtered.layer(layer_id);
+    if (FLAGS_layer.empty() ? layer.bottom_size() == 0 && layer.top_size() > 0
+        : layer.name() == FLAGS_layer) {
+      break;
+    }
+  }
+  CHECK_LT(layer_id, filtered.layer_size()) << "No data layer "
+      << FLAGS_layer << " in " << argv[1] << " for phase " << FLAGS_phase;
+  LayerParameter param = filtered.layer(layer_id);
+  param.set_phase(phase);
+
+  vector<int> workers;
+  if (!FLAGS_workers.empty()) {
+    vector<string> fields;
+    boost::split(fields, FLAGS_workers, boost::is_any_of(","));
+    for (int i = 0; i < fields.size(); ++i) {
+      workers.push_back(atoi(fields[i].c_str()));
+      CHECK_GT(workers.back(), 0) << "Bad number of workers " << fields[i];
+    }
+    if (!SetNumWorkers(&param, workers[0])) {
+      LOG(WARNING) << param.type() << " has no worker threads to sweep";
+      workers.clear();
+    }
+  }
+  if (workers.empty()) {
+    workers.push_back(0);
+  }
+
+  LOG(INFO) << "Measuring " << param.type() << " layer " << param.name()
+      << " over " << FLAGS_iterations << " batches";
+  double base_samples_per_s = 0;
+  for (int i = 0; i < workers.size(); ++i) {
+    if (workers[i] > 0) {
+      SetNumWorkers(&param, workers[i]);
+    }
+    const RunResult result = Run(param);
+    if (i == 0) {
+      base_samples_per_s = result.samples_per_s;
+    }
+    std::ostringstream run;
+    if (workers[i] > 0) {
+      run << workers[i] << " workers: ";
+    }
+    LOG(INFO) << run.str() << result.samples_per_s << " samples/s, "
+        << result.mb_per_s << " MB/s, x"
+        << result.samples_per_s / base_samples_per_s;
+    LOG(INFO) << "    load_batch p50/p90/p99 = " << result.stats.load_ms_p50
+        << "/" << result.stats.load_ms_p90 << "/"
+        << result.stats.load_ms_p99 << " ms over " << result.stats.loads
+        << " batches; Forward waited " << result.stats.wait_ms << " ms in "
+        << result.stats.starved << " of " << result.stats.forwards
+        << " calls";
+  }
+  return 0;
+}
@@ -0,0 +1,72 @@
+// This program packs the per-sample files read by NlpDataLayer into one
+// aligned container, read through `pack_source` instead of opening every
+// file.
+// Usage:
+//   pack_nlp_data [FLAGS] LABEL_SOURCE DATA_SOURCE PACK_FILE
+//
+// where LABEL_SOURCE and DATA_SOURCE are the label_source and data_source
+// of the layer, and --image_prefix is its image_prefix.
+
+#include <cstdio>
+#include <fstream>  // NOLINT(readability/streams)
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/util/sample_pack.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+
+DEFINE_string(image_prefix, "",
+    "Directory the files of DATA_SOURCE are relative to");
+DEFINE_int32(alignment, 4096,
+    "Byte boundary every sample starts on");
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Pack the per-sample files of an NlpData layer\n"
+        "into one container.\n"
+        "Usage:\n"
+        "    pack_nlp_data [FLAGS] LABEL_SOURCE DATA_SOURCE PACK_FILE\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 4) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/pack_nlp_data");
+    return 1;
+  }
+
+  std::ifstream flabel(argv[1]);
+  CHECK(flabel.good()) << "file " << argv[1] << " read error";
+  string line;
+  std::getline(flabel, line);
+  int num = 0;
+  CHECK_GT(sscanf(line.c_str(), "%d", &num), 0);
+  vector<int> labels;
+  int label;
+  while (flabel >> label) {
+    labels.push_back(label);
+  }
+  CHECK_EQ(labels.size(), num);
+
+  std::ifstream fdata(argv[2]);
+  CHECK(fdata.good()) << "fail to open " << argv[2];
+  vector<string> files;
+  string image_fn;
+  while (fdata >> image_fn) {
+    files.push_back(FLAGS_image_prefix + "/" + image_fn);
+  }
+  CHECK_EQ(files.size(), num);
+
+  SamplePack::Write(argv[3], labels, files, FLAGS_alignment);
+  LOG(INFO) << "Packed " << num << " samples into " << argv[3];
+  return 0;
+}
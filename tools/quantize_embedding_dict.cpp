@@ -0,0 +1,113 @@
+// This program stores an embedding table as a quantized binary dictionary,
+// which frozen DictEmbed layers and TextData layers dequantize row by row
+// as they look it up. The table is read from an embedding dictionary, or
+// from the weights of an Embed or DictEmbed layer of a trained model.
+// Usage:
+//   quantize_embedding_dict [FLAGS] INPUT BINARY_DICT
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/blob.hpp"
+#include "caffe/proto/caffe.pb.h"
+#include "caffe/util/embedding_dict.hpp"
+#include "caffe/util/upgrade_proto.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::string;
+
+DEFINE_string(dtype, "int8",
+    "The type {float16, int8, float} the table is stored as");
+DEFINE_string(layer, "",
+    "Read the table from the weights of this layer of the model INPUT");
+DEFINE_int32(dim, 0, "Width of each row when INPUT is a text dict");
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Store an embedding table as a quantized\n"
+        "binary dict, read by frozen DictEmbed and TextData layers.\n"
+        "Usage:\n"
+        "    quantize_embedding_dict [FLAGS] INPUT BINARY_DICT\n"
+        "INPUT is an embedding dict, or a model with --layer.\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 3) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0],
+        "tools/quantize_embedding_dict");
+    return 1;
+  }
+
+  EmbeddingDict::Type dtype = EmbeddingDict::FLOAT;
+  if (FLAGS_dtype == "float16") {
+    dtype = EmbeddingDict::FLOAT16;
+  } else if (FLAGS_dtype == "int8") {
+    dtype = EmbeddingDict::INT8;
+  } else if (FLAGS_dtype == "float") {
+    dtype = EmbeddingDict::FLOAT;
+  } else {
+    LOG(FATAL) << "Unknown dtype " << FLAGS_dtype;
+  }
+
+  int rows, dim;
+  vector<float> table;
+  if (!FLAGS_layer.empty()) {
+    NetParameter net_param;
+    ReadNetParamsFromBinaryFileOrDie(argv[1], &net_param);
+    int layer_id = 0;
+    while (layer_id < net_param.layer_size()
+        && net_param.layer(layer_id).name() != FLAGS_layer) {
+      ++layer_id;
+    }
+    CHECK_LT(layer_id, net_param.layer_size())
+        << "No layer " << FLAGS_layer << " in " << argv[1];
+    const LayerParameter& layer = net_param.layer(layer_id);
+    CHECK_GT(layer.blobs_size(), 0) << "Layer " << FLAGS_layer
+        << " has no weights";
+    Blob<float> weights;
+    weights.FromProto(layer.blobs(0));
+    CHECK_EQ(weights.num_axes(), 2) << "Layer " << FLAGS_layer
+        << " weights are not an embedding table";
+    rows = weights.shape(0);
+    dim = weights.shape(1);
+    table.assign(weights.cpu_data(), weights.cpu_data() + weights.count());
+  } else {
+    shared_ptr<EmbeddingDict> dict =
+        EmbeddingDict::GetShared(argv[1], FLAGS_dim);
+    rows = dict->rows();
+    dim = dict->dim();
+    table.resize(size_t(rows) * dim);
+    dict->CopyTo(&table[0]);
+  }
+  CHECK_GT(table.size(), 0) << argv[1] << " is empty";
+
+  EmbeddingDict::Write(argv[2], rows, dim, &table[0], dtype);
+
+  // Report how far the stored table is from the input.
+  EmbeddingDict stored(argv[2]);
+  vector<float> row(dim);
+  double max_error = 0, sum_error = 0;
+  for (int i = 0; i < rows; ++i) {
+    stored.CopyRow(i, &row[0]);
+    for (int j = 0; j < dim; ++j) {
+      const double error = std::fabs(row[j] - table[size_t(i) * dim + j]);
+      max_error = std::max(max_error, error);
+      sum_error += error;
+    }
+  }
+  LOG(INFO) << "Wrote " << rows << " x " << dim << " " << FLAGS_dtype
+      << " dict to " << argv[2] << "; max abs error " << max_error
+      << ", mean abs error " << sum_error / table.size();
+  return 0;
+}
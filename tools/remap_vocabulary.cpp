@@ -0,0 +1,70 @@
+// This program renumbers the vocabulary of a text corpus by decreasing word
+// frequency, so that the embedding rows of the frequent words share a small
+// slice at the start of the table. It rewrites the corpus and reorders the
+// rows of the embedding dict to match, and writes the remap itself for data
+// that is read through vocab_remap instead of being rewritten.
+// Usage:
+//   remap_vocabulary [FLAGS] CORPUS DICT OUT_CORPUS OUT_DICT OUT_REMAP
+//
+// where CORPUS is a binary corpus, or the DATA_SOURCE of a text corpus given
+// with --label_source. OUT_CORPUS is a binary corpus and OUT_DICT a binary
+// dict of the same type as DICT (float for a text DICT).
+
+#include <string>
+#include <vector>
+
+#include "gflags/gflags.h"
+#include "glog/logging.h"
+
+#include "caffe/util/embedding_dict.hpp"
+#include "caffe/util/text_corpus.hpp"
+#include "caffe/util/vocab_remap.hpp"
+
+using namespace caffe;  // NOLINT(build/namespaces)
+using std::string;
+
+DEFINE_string(label_source, "",
+    "Label file of CORPUS when CORPUS is a text DATA_SOURCE");
+DEFINE_int32(dim, 0, "Width of each row when DICT is a text dict");
+
+int main(int argc, char** argv) {
+  ::google::InitGoogleLogging(argv[0]);
+  // Print output to stderr (while still logging)
+  FLAGS_alsologtostderr = 1;
+
+#ifndef GFLAGS_GFLAGS_H_
+  namespace gflags = google;
+#endif
+
+  gflags::SetUsageMessage("Renumber the vocabulary of a corpus by word\n"
+        "frequency, reordering the rows of its embedding dict to match.\n"
+        "Usage:\n"
+        "    remap_vocabulary [FLAGS] CORPUS DICT OUT_CORPUS OUT_DICT "
+        "OUT_REMAP\n");
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+
+  if (argc != 6) {
+    gflags::ShowUsageWithFlagsRestrict(argv[0], "tools/remap_vocabulary");
+    return 1;
+  }
+
+  TextCorpus corpus;
+  if (FLAGS_label_source.empty()) {
+    corpus.Open(argv[1]);
+  } else {
+    corpus.LoadText(FLAGS_label_source, argv[1]);
+  }
+  shared_ptr<EmbeddingDict> dict =
+      EmbeddingDict::GetShared(argv[2], FLAGS_dim);
+
+  VocabRemap remap;
+  remap.ByFrequency(corpus, dict->rows());
+  corpus.RemapTokens(remap.new_index());
+  corpus.Save(argv[3]);
+  dict->WritePermuted(argv[4], remap.new_index());
+  remap.Save(argv[5]);
+  LOG(INFO) << "Renumbered " << remap.num_words() << " words of "
+      << corpus.num_samples() << " samples; wrote " << argv[3] << ", "
+      << argv[4] << " and " << argv[5];
+  return 0;
+}